@@ -0,0 +1,154 @@
+#pragma once
+
+#include <any>
+#include <vector>
+
+#include "bevarmejo/wds/utility/global_times.hpp"
+#include "bevarmejo/wds/utility/epanet/results_buffer.hpp"
+#include "bevarmejo/wds/utility/epanet/results_profile.hpp"
+
+#include "bevarmejo/wds/water_distribution_system.hpp"
+#include "bevarmejo/simulation/solvers/epanet/step_accumulator.hpp"
+
+namespace bevarmejo::eval::metrics
+{
+
+// Time integral of a value known at the committed steps, with the value at t
+// holding until the next step (same as QuantitySeries::integrate_forward).
+class ForwardIntegral
+{
+/*------- Member objects -------*/
+private:
+    double m__integral = 0.0;
+    double m__first_value = 0.0;
+    double m__last_value = 0.0;
+    time::Instant m__first_t = 0;
+    time::Instant m__last_t = 0;
+    bool m__empty = true;
+
+/*------- Element access -------*/
+public:
+    auto empty() const noexcept -> bool;
+    auto first() const noexcept -> double; // Value at the first step
+    auto integral() const noexcept -> double;
+    auto duration() const noexcept -> time::Instant;
+    // Average over the simulation, or the only value of a snapshot simulation.
+    auto mean() const noexcept -> double;
+
+/*------- Modifiers -------*/
+public:
+    void reset() noexcept;
+    void add(const time::Instant t, const double a_value) noexcept;
+};
+
+// Online version of bevarmejo::pressure_deficiency(const WDS&, ...).
+class OnlinePressureDeficiency final : public sim::solvers::epanet::StepAccumulator
+{
+/*------- Member objects -------*/
+private:
+    double m__min_pressure;
+    bool m__relative;
+    double m__weight;
+    std::vector<int> m__junctions;
+    ForwardIntegral m__deficiency;
+
+/*------- Member functions -------*/
+public:
+    OnlinePressureDeficiency() = delete;
+    OnlinePressureDeficiency(const double a_min_pressure, const bool a_relative);
+
+/*------- Element access -------*/
+public:
+    auto required_results() const -> bevarmejo::epanet::ResultsProfile override;
+    auto deficiency() const noexcept -> const ForwardIntegral&;
+
+/*------- Modifiers -------*/
+public:
+    void reset(const WaterDistributionSystem& a_wds) override;
+    void accumulate(const WaterDistributionSystem& a_wds, const bevarmejo::epanet::ResultsBuffer& a_results, const time::Instant t) override;
+    auto save_state() const -> std::any override;
+    void restore_state(const std::any& a_state) override;
+};
+
+// Online version of bevarmejo::resilience_index_from_min_pressure.
+class OnlineResilienceIndex final : public sim::solvers::epanet::StepAccumulator
+{
+/*------- Member objects -------*/
+private:
+    double m__min_pressure;
+    std::vector<const WDS::Junction*> m__junctions;
+    std::vector<int> m__sources;
+    std::vector<int> m__pumps;
+
+    // Pre-allocated inputs of the resilience index for a single step.
+    std::vector<double> m__req_flows_dnodes;
+    std::vector<double> m__heads_dnodes;
+    std::vector<double> m__req_heads_dnodes;
+    std::vector<double> m__flows_sources;
+    std::vector<double> m__heads_sources;
+    std::vector<double> m__powers_pumps;
+
+    ForwardIntegral m__index;
+
+/*------- Member functions -------*/
+public:
+    OnlineResilienceIndex() = delete;
+    explicit OnlineResilienceIndex(const double a_min_pressure);
+
+/*------- Element access -------*/
+public:
+    auto required_results() const -> bevarmejo::epanet::ResultsProfile override;
+    auto index() const noexcept -> const ForwardIntegral&;
+
+/*------- Modifiers -------*/
+public:
+    void reset(const WaterDistributionSystem& a_wds) override;
+    void accumulate(const WaterDistributionSystem& a_wds, const bevarmejo::epanet::ResultsBuffer& a_results, const time::Instant t) override;
+    auto save_state() const -> std::any override;
+    void restore_state(const std::any& a_state) override;
+};
+
+// Maximum velocity over all the pipes and all the steps.
+class OnlineMaxPipeVelocity final : public sim::solvers::epanet::StepAccumulator
+{
+/*------- Member objects -------*/
+private:
+    std::vector<int> m__pipes;
+    double m__max_velocity = 0.0;
+
+/*------- Element access -------*/
+public:
+    auto required_results() const -> bevarmejo::epanet::ResultsProfile override;
+    auto value() const noexcept -> double; // m/s
+
+/*------- Modifiers -------*/
+public:
+    void reset(const WaterDistributionSystem& a_wds) override;
+    void accumulate(const WaterDistributionSystem& a_wds, const bevarmejo::epanet::ResultsBuffer& a_results, const time::Instant t) override;
+    auto save_state() const -> std::any override;
+    void restore_state(const std::any& a_state) override;
+};
+
+// Energy used by all the pumps during the simulation.
+class OnlinePumpEnergy final : public sim::solvers::epanet::StepAccumulator
+{
+/*------- Member objects -------*/
+private:
+    std::vector<int> m__pumps;
+    ForwardIntegral m__power; // kW
+
+/*------- Element access -------*/
+public:
+    auto required_results() const -> bevarmejo::epanet::ResultsProfile override;
+    auto energy__kWh() const noexcept -> double;
+    auto mean_power__kW() const noexcept -> double;
+
+/*------- Modifiers -------*/
+public:
+    void reset(const WaterDistributionSystem& a_wds) override;
+    void accumulate(const WaterDistributionSystem& a_wds, const bevarmejo::epanet::ResultsBuffer& a_results, const time::Instant t) override;
+    auto save_state() const -> std::any override;
+    void restore_state(const std::any& a_state) override;
+};
+
+} // namespace bevarmejo::eval::metrics
@@ -16,6 +16,23 @@ static constexpr bevarmejo::io::AliasedKey type{ "Type" }; // "Type"
 static constexpr bevarmejo::io::AliasedKey name{"Name"}; // "Name"
 static constexpr bevarmejo::io::AliasedKey params{"Parameters", "Params"}; // "Parameters"
 
+static constexpr bevarmejo::io::AliasedKey fitness_cache{"Fitness cache"}; // "Fitness cache"
+static constexpr bevarmejo::io::AliasedKey eval_budget{"Evaluation budget"}; // "Evaluation budget"
+
+static constexpr bevarmejo::io::AliasedKey coarse_screening{"Coarse screening"}; // "Coarse screening"
+static constexpr bevarmejo::io::AliasedKey step_multiplier{"Step multiplier"}; // "Step multiplier"
+static constexpr bevarmejo::io::AliasedKey coarse_horizon{"Horizon"}; // "Horizon"
+static constexpr bevarmejo::io::AliasedKey margin{"Margin"}; // "Margin"
+static constexpr bevarmejo::io::AliasedKey margin_schedule{"Margin schedule"}; // "Margin schedule"
+
+static constexpr bevarmejo::io::AliasedKey surrogate{"Surrogate"}; // "Surrogate"
+static constexpr bevarmejo::io::AliasedKey n_neighbours{"Neighbours", "k"}; // "Neighbours", "k"
+static constexpr bevarmejo::io::AliasedKey min_samples{"Min samples"}; // "Min samples"
+static constexpr bevarmejo::io::AliasedKey capacity{"Capacity"}; // "Capacity"
+static constexpr bevarmejo::io::AliasedKey exploration{"Exploration"}; // "Exploration"
+static constexpr bevarmejo::io::AliasedKey confidence{"Confidence"}; // "Confidence"
+static constexpr bevarmejo::io::AliasedKey exploration_seed{"Seed"}; // "Seed"
+
 static constexpr bevarmejo::io::AliasedKey lookup_paths{"Lookup paths", "Paths"}; // "Lookup paths", "Paths"
 
 }   // namespace bevarmejo::io::key
\ No newline at end of file
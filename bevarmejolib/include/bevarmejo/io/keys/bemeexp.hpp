@@ -18,6 +18,10 @@ static constexpr bevarmejo::io::AliasedKey fevals{"Fitness evaluations", "Fevals
 static constexpr bevarmejo::io::AliasedKey gevals{"Gradient evaluations", "Gevals"}; // "Gradient evaluations", "Gevals"
 static constexpr bevarmejo::io::AliasedKey hevals{"Hessian evaluations", "Hevals"}; // "Hessian evaluations", "Hevals"
 static constexpr bevarmejo::io::AliasedKey individuals{"Individuals"}; // "Individuals"
+static constexpr bevarmejo::io::AliasedKey fcache_hits{"Fitness cache hits"}; // "Fitness cache hits"
+static constexpr bevarmejo::io::AliasedKey fcache_misses{"Fitness cache misses"}; // "Fitness cache misses"
+static constexpr bevarmejo::io::AliasedKey fcache_hit_rate{"Fitness cache hit rate"}; // "Fitness cache hit rate"
+static constexpr bevarmejo::io::AliasedKey timeouts{"Timeouts"}; // "Timeouts"
 
 static constexpr bevarmejo::io::AliasedKey id{"ID"}; // "ID"
 static constexpr bevarmejo::io::AliasedKey dv{"Decision vector", "DV"}; // "Decision vector", "DV"
@@ -13,6 +13,9 @@ static constexpr bevarmejo::io::AliasedKey typconfig{"Typical configuration"}; /
 static constexpr bevarmejo::io::AliasedKey islandname{"Island name", "Isl name", "Name"}; // "Island name", "Isl name", "Name"
 static constexpr bevarmejo::io::AliasedKey island{"Island", "UDI"}; // "Island", "UDI"
 static constexpr bevarmejo::io::AliasedKey algorithm{"Algorithm", "UDA"}; // "Algorithm", "UDA"
+static constexpr bevarmejo::io::AliasedKey threads{"Threads"}; // "Threads"
+static constexpr bevarmejo::io::AliasedKey processes{"Processes"}; // "Processes"
+static constexpr bevarmejo::io::AliasedKey process_timeout{"Process timeout"}; // "Process timeout"
 static constexpr bevarmejo::io::AliasedKey r_policy{"Replacement policy", "R policy", "UDRP"}; // "Replacement policy", "R policy", "UDRP"
 static constexpr bevarmejo::io::AliasedKey s_policy{"Selection policy", "S policy", "UDSP"}; // "Selection policy", "S policy", "UDSP"
 
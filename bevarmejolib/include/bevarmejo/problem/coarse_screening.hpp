@@ -0,0 +1,113 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+#include "bevarmejo/io/json.hpp"
+#include "bevarmejo/simulation/solvers/epanet/hydraulic.hpp"
+#include "bevarmejo/problem/pareto_archive.hpp"
+
+namespace bevarmejo {
+
+// Two-level (multi-fidelity) evaluation: every candidate is first simulated
+// with coarse settings and only the promising ones are simulated again at full
+// fidelity. The others keep the fitness of the coarse simulation.
+// A candidate is promising when the coarse fitness is within the margin of
+// feasibility (as in the problems of this library, a positive second objective
+// is a constraint violation) and it is not dominated, by more than the margin,
+// by the front of the candidates evaluated at full fidelity so far. The margin
+// is relative on the first objective (the cost) and absolute on the second one.
+// When the coarse second objective is only a feasibility measure (e.g., a
+// perspective that needs its own simulations), the front test is skipped and
+// every candidate within the margin of feasibility is promoted.
+// Note that EPANET stops anyway at each pattern step, so the step multiplier
+// pays off only when the hydraulic step is finer than the patterns; the
+// shortened horizon always does.
+class CoarseScreening final
+{
+/*------- Member types -------*/
+public:
+    using time_t = sim::solvers::epanet::HydSimSettings::time_t;
+
+    struct Config
+    {
+        std::size_t step_multiplier = 1; // Of the hydraulic and report steps
+        time_t horizon__s = 0; // Of the coarse simulation, 0 keeps the full one
+        double margin = 0.1;
+        // Pairs (number of evaluations, margin): once the problem and its
+        // copies have evaluated that many candidates the margin is used
+        // instead (sorted by number of evaluations).
+        std::vector<std::pair<std::size_t, double>> margin_schedule;
+    };
+
+    struct Stats
+    {
+        std::atomic<std::size_t> n_coarse{0}; // Candidates screened
+        std::atomic<std::size_t> n_promoted{0}; // Of which simulated at full fidelity
+    };
+
+/*------- Member objects -------*/
+private:
+    Config m__config;
+    ParetoArchive m__front; // Of the full fidelity evaluations
+    Stats m__stats;
+
+/*------- Member functions -------*/
+// (constructor)
+public:
+    CoarseScreening() = delete;
+    explicit CoarseScreening(Config a_config);
+    CoarseScreening(const CoarseScreening&) = delete;
+    CoarseScreening(CoarseScreening&&) = delete;
+
+// (destructor)
+public:
+    ~CoarseScreening() = default;
+
+// operator=
+public:
+    CoarseScreening& operator=(const CoarseScreening&) = delete;
+    CoarseScreening& operator=(CoarseScreening&&) = delete;
+
+/*------- Element access -------*/
+public:
+    auto config() const noexcept -> const Config&;
+    auto stats() const noexcept -> const Stats&;
+
+    // Margin for the current number of evaluations (see Config::margin_schedule).
+    auto margin() const noexcept -> double;
+
+/*------- Operations -------*/
+public:
+    // Coarse version of the full fidelity settings.
+    auto coarsen(const sim::solvers::epanet::HydSimSettings& a_settings) const -> sim::solvers::epanet::HydSimSettings;
+
+    // Evaluate the coarse fitness and, if the candidate is promising, the
+    // full fidelity one. Without a_front_test only the feasibility is screened.
+    template <typename CoarseEvaluate, typename FullEvaluate>
+    auto evaluate(CoarseEvaluate&& a_coarse, FullEvaluate&& a_full, const bool a_front_test = true) -> std::vector<double>
+    {
+        auto fv = std::forward<CoarseEvaluate>(a_coarse)();
+        const bool promising = is_promising(fv, a_front_test);
+        m__stats.n_coarse.fetch_add(1, std::memory_order_relaxed);
+        if (!promising)
+            return fv;
+
+        m__stats.n_promoted.fetch_add(1, std::memory_order_relaxed);
+        fv = std::forward<FullEvaluate>(a_full)();
+        if (fv.size() >= 2)
+            m__front.insert(fv[0], fv[1]);
+        return fv;
+    }
+
+private:
+    auto is_promising(const std::vector<double>& a_coarse_fv, const bool a_front_test) const -> bool;
+
+}; // class CoarseScreening
+
+void to_json(Json& j, const CoarseScreening::Config& config);
+void from_json(const Json& j, CoarseScreening::Config& config);
+
+} // namespace bevarmejo
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace bevarmejo {
+
+// Bounded (LRU) map from a decision vector, in the beme ordering, to its
+// fitness vector. The simulations are deterministic, so an individual that
+// survives many generations (or that migrates to another island) does not need
+// to be simulated again.
+// The entries are split in stripes, each one with its own lock and its own
+// LRU list, so that the threads of different islands rarely contend.
+// The key is a 64-bit hash of the decision vector, seeded with the hash of the
+// problem configuration; the full vector is stored too, so a collision is
+// treated as a miss and never returns the fitness of another individual.
+class FitnessCache final
+{
+/*------- Member types -------*/
+public:
+    using Vector = std::vector<double>;
+
+    struct Stats
+    {
+        std::atomic<std::size_t> hits{0};
+        std::atomic<std::size_t> misses{0};
+
+        auto hit_rate() const noexcept -> double;
+    };
+
+private:
+    struct Entry
+    {
+        std::uint64_t hash;
+        Vector dv;
+        Vector fv;
+    };
+
+    struct Stripe
+    {
+        mutable std::mutex mutex;
+        std::list<Entry> lru; // Most recently used at the front.
+        std::unordered_multimap<std::uint64_t, std::list<Entry>::iterator> index;
+    };
+
+    static constexpr std::size_t n_stripes = 16;
+
+/*------- Member objects -------*/
+private:
+    std::uint64_t m__seed;
+    std::size_t m__capacity;
+    std::size_t m__stripe_capacity;
+    std::array<Stripe, n_stripes> m__stripes;
+    Stats m__stats; // Over all the users of the cache.
+
+/*------- Member functions -------*/
+// (constructor)
+public:
+    FitnessCache() = delete;
+    FitnessCache(const std::string& a_problem_key, const std::size_t a_capacity);
+    FitnessCache(const FitnessCache&) = delete;
+    FitnessCache(FitnessCache&&) = delete;
+
+    // Cache shared by all the problems with the same key in this process, e.g.,
+    // the islands of an archipelago built from the same problem settings.
+    // It lives as long as one of the problems holds it.
+    static auto shared(const std::string& a_problem_key, const std::size_t a_capacity) -> std::shared_ptr<FitnessCache>;
+
+// (destructor)
+public:
+    ~FitnessCache() = default;
+
+// operator=
+public:
+    FitnessCache& operator=(const FitnessCache&) = delete;
+    FitnessCache& operator=(FitnessCache&&) = delete;
+
+/*------- Element access -------*/
+public:
+    // Fitness of the decision vector, if it has been evaluated already.
+    auto find(const Vector& a_dv) -> std::optional<Vector>;
+
+    auto stats() const noexcept -> const Stats&;
+
+/*------- Capacity -------*/
+public:
+    auto size() const -> std::size_t;
+    auto capacity() const noexcept -> std::size_t;
+
+/*------- Modifiers -------*/
+public:
+    // Store the fitness, evicting the least recently used entry of the stripe
+    // when it is full.
+    void insert(const Vector& a_dv, const Vector& a_fv);
+
+private:
+    auto hash(const Vector& a_dv) const noexcept -> std::uint64_t;
+    auto stripe(const std::uint64_t a_hash) noexcept -> Stripe&;
+
+}; // class FitnessCache
+
+} // namespace bevarmejo
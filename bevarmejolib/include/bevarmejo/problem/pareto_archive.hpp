@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+
+namespace bevarmejo {
+
+// Non-dominated front of the solutions evaluated so far, for problems with
+// two objectives to be minimised. It gives the problems a bound to stop the
+// evaluation of an individual early, as soon as it is known to be dominated
+// by a solution already in the archive.
+// The points are kept sorted by the first objective, so along the front the
+// second objective is strictly decreasing.
+class ParetoArchive final
+{
+/*------- Member objects -------*/
+private:
+    mutable std::mutex m__mutex;
+    std::map<double, double> m__front; // f0 -> f1
+
+/*------- Member functions -------*/
+// (constructor)
+public:
+    ParetoArchive() = default;
+    ParetoArchive(const ParetoArchive&) = delete;
+    ParetoArchive(ParetoArchive&&) = delete;
+
+    // Archive shared by all the problems with the same key in this process,
+    // e.g., the islands of an archipelago built from the same problem settings.
+    // It lives as long as one of the problems holds it.
+    static auto shared(const std::string& a_problem_key) -> std::shared_ptr<ParetoArchive>;
+
+// (destructor)
+public:
+    ~ParetoArchive() = default;
+
+// operator=
+public:
+    ParetoArchive& operator=(const ParetoArchive&) = delete;
+    ParetoArchive& operator=(ParetoArchive&&) = delete;
+
+/*------- Element access -------*/
+public:
+    // Best (lowest) second objective among the archived points whose first
+    // objective is not worse than a_f0. A solution with first objective a_f0
+    // and second objective greater than this is dominated.
+    auto best_f1_up_to(double a_f0) const -> std::optional<double>;
+
+/*------- Capacity -------*/
+public:
+    auto size() const -> std::size_t;
+
+/*------- Modifiers -------*/
+public:
+    // Add the point if no archived point dominates it (or is equal to it) and
+    // remove the points it dominates. Returns true if the point was added.
+    auto insert(double a_f0, double a_f1) -> bool;
+
+}; // class ParetoArchive
+
+} // namespace bevarmejo
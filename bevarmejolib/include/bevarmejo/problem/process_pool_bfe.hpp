@@ -0,0 +1,80 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <memory>
+#include <string>
+
+#include <pagmo/problem.hpp>
+#include <pagmo/types.hpp>
+
+namespace bevarmejo {
+
+// User-defined batch fitness evaluator (pagmo::bfe) that evaluates the
+// decision vectors in long-lived child processes, for hard isolation between
+// the evaluations: a crash of EPANET (or of the problem) kills only one
+// worker and not the whole optimisation.
+// The workers are forked at the first batch, so each one gets its own copy of
+// the problem (and of its networks) without loading it again. Decision and
+// fitness vectors are exchanged over pipes. A worker that dies is restarted
+// and the decision vector it was evaluating is reported on std::cerr and
+// given the worst fitness (std::numeric_limits<double>::max()), as the
+// problems do for the solutions they cannot simulate. The same happens when
+// the fitness throws in a worker, and when a worker does not reply within the
+// timeout (it is then killed and restarted).
+// Only available on POSIX systems. Since fork() duplicates only the calling
+// thread, the process must not run other threads when the workers are
+// started: a single island per process and no thread pool in the problem
+// (e.g., no "Fireflow threads"), otherwise a worker would wait forever for
+// threads that do not exist in it or for a mutex that another thread held.
+// Only the fitness vectors come back from the workers: the memory a problem
+// shares between its copies (fitness cache, coarse screening, surrogate,
+// pruning front and their counters) is updated in the worker only, so these
+// features can not be combined with the workers.
+// Copies of the evaluator (pagmo copies the algorithm at every evolve) share
+// the same workers.
+class ProcessPoolBFE final
+{
+/*------- Member types -------*/
+private:
+    class Workers;
+
+/*------- Member objects -------*/
+private:
+    std::size_t m__n_processes;
+    std::chrono::duration<double> m__timeout; // Zero for no timeout
+    std::shared_ptr<Workers> m__workers;
+
+/*------- Member functions -------*/
+// (constructor)
+public:
+    // Time a worker has to reply to a decision vector, unless specified.
+    static constexpr double k__default_timeout__s = 600.0;
+
+    // One worker per hardware thread.
+    ProcessPoolBFE();
+    // A non-positive timeout lets the workers take as long as they need.
+    explicit ProcessPoolBFE(std::size_t a_n_processes, double a_timeout__s = k__default_timeout__s);
+
+/*------- Element access -------*/
+public:
+    auto n_processes() const noexcept -> std::size_t;
+
+    // Zero when the workers have no timeout.
+    auto timeout__s() const noexcept -> double;
+
+    // Evaluations lost because the worker died, timed out or the fitness threw.
+    auto n_failures() const noexcept -> std::size_t;
+
+    auto get_name() const -> std::string;
+    auto get_extra_info() const -> std::string;
+
+/*------- Operations -------*/
+public:
+    // Mandatory in pagmo, evaluate the batch of decision vectors (stored
+    // contiguously) and return the fitness vectors in the same order.
+    auto operator()(pagmo::problem& a_prob, const pagmo::vector_double& a_dvs) const -> pagmo::vector_double;
+
+}; // class ProcessPoolBFE
+
+} // namespace bevarmejo
@@ -0,0 +1,132 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <shared_mutex>
+#include <utility>
+#include <vector>
+
+#include "bevarmejo/io/json.hpp"
+#include "bevarmejo/problem/pareto_archive.hpp"
+
+namespace bevarmejo {
+
+// k-nearest neighbours regression of the fitness over the decision vector (beme
+// ordering), trained online with the fitness of the candidates that are
+// actually simulated. A candidate is not simulated when the prediction is
+// confidently (mean +/- confidence*spread of the neighbours) infeasible (a
+// positive second objective, as in the problems of this library) or dominated
+// by the front of the simulated candidates. In that case the predicted mean is
+// returned as its fitness.
+// A fraction of the candidates (exploration) is always simulated, chosen by a
+// hash of the decision vector, so that the same candidate gets the same
+// decision. Failed simulations (fitness at std::numeric_limits<double>::max())
+// are not used for training.
+class Surrogate final
+{
+/*------- Member types -------*/
+public:
+    using Vector = std::vector<double>;
+
+    struct Config
+    {
+        std::size_t n_neighbours = 5;
+        std::size_t min_samples = 50; // Below this, every candidate is simulated
+        std::size_t capacity = 2000; // Samples kept, the oldest are replaced
+        double exploration = 0.1; // Share of the candidates always simulated
+        double confidence = 1.0; // Multiplier of the spread of the neighbours
+        std::uint64_t seed = 0; // Of the exploration choice
+    };
+
+    struct Stats
+    {
+        std::atomic<std::size_t> n_queries{0};
+        std::atomic<std::size_t> n_replaced{0}; // Simulations skipped
+    };
+
+    struct Prediction
+    {
+        Vector mean;
+        Vector spread; // Standard deviation of the neighbours
+    };
+
+/*------- Member objects -------*/
+private:
+    Config m__config;
+    mutable std::shared_mutex m__mutex;
+    std::vector<std::pair<Vector, Vector>> m__samples; // (dv, fv)
+    std::size_t m__next; // Sample to replace once the capacity is reached
+    Vector m__dv_min; // Range of each decision variable, to scale the distances
+    Vector m__dv_max;
+    ParetoArchive m__front; // Of the simulated candidates
+    Stats m__stats;
+
+/*------- Member functions -------*/
+// (constructor)
+public:
+    Surrogate() = delete;
+    explicit Surrogate(Config a_config);
+    Surrogate(const Surrogate&) = delete;
+    Surrogate(Surrogate&&) = delete;
+
+// (destructor)
+public:
+    ~Surrogate() = default;
+
+// operator=
+public:
+    Surrogate& operator=(const Surrogate&) = delete;
+    Surrogate& operator=(Surrogate&&) = delete;
+
+/*------- Element access -------*/
+public:
+    auto config() const noexcept -> const Config&;
+    auto stats() const noexcept -> const Stats&;
+
+    // Nothing until min_samples candidates have been simulated.
+    auto predict(const Vector& a_dv) const -> std::optional<Prediction>;
+
+/*------- Capacity -------*/
+public:
+    auto size() const -> std::size_t;
+
+/*------- Modifiers -------*/
+public:
+    void train(const Vector& a_dv, const Vector& a_fv);
+
+/*------- Operations -------*/
+public:
+    // Predicted fitness if the candidate can be discarded, otherwise evaluate
+    // it and train the model with the result. An evaluation that throws (e.g.,
+    // a provisional fitness) is not learnt.
+    template <typename Evaluate>
+    auto evaluate(const Vector& a_dv, Evaluate&& a_evaluate) -> Vector
+    {
+        m__stats.n_queries.fetch_add(1, std::memory_order_relaxed);
+
+        if (!explores(a_dv))
+        {
+            if (auto prediction = predict(a_dv); prediction && is_discarded(*prediction))
+            {
+                m__stats.n_replaced.fetch_add(1, std::memory_order_relaxed);
+                return std::move(prediction->mean);
+            }
+        }
+
+        auto fv = std::forward<Evaluate>(a_evaluate)();
+        train(a_dv, fv);
+        return fv;
+    }
+
+private:
+    auto explores(const Vector& a_dv) const noexcept -> bool;
+    auto is_discarded(const Prediction& a_prediction) const -> bool;
+
+}; // class Surrogate
+
+void to_json(Json& j, const Surrogate::Config& config);
+void from_json(const Json& j, Surrogate::Config& config);
+
+} // namespace bevarmejo
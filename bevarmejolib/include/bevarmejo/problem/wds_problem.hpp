@@ -1,8 +1,19 @@
 #pragma once 
 
+#include <atomic>
+#include <cstddef>
+#include <limits>
+#include <memory>
 #include <string>
+#include <utility>
+#include <vector>
 
+#include "bevarmejo/problem/coarse_screening.hpp"
 #include "bevarmejo/problem/decision_variable.hpp"
+#include "bevarmejo/problem/fitness_cache.hpp"
+#include "bevarmejo/problem/surrogate.hpp"
+#include "bevarmejo/problem/wds_replica_pool.hpp"
+#include "bevarmejo/simulation/solvers/epanet/hydraulic.hpp"
 
 namespace bevarmejo {
 
@@ -28,7 +39,8 @@ public:
     // Name of the problem
     std::string get_name() const;
 
-    // Extra information about the problem
+    // Extra information about the problem (and about the evaluations replaced
+    // by the surrogate, when enabled)
     std::string get_extra_info() const;
 
 /*----------------------*/
@@ -66,6 +78,170 @@ public:
     WDSProblem& enable_save_metrics(std::string a_metrics_filename);
     WDSProblem& disable_save_metrics() noexcept;
 
+    // Look up the fitness of the decision vectors in a cache shared by all the
+    // problems with the same key (e.g., the islands of an archipelago) before
+    // simulating them. A capacity of zero disables the cache.
+    WDSProblem& enable_fitness_cache(const std::string& a_problem_key, std::size_t a_capacity);
+    WDSProblem& disable_fitness_cache() noexcept;
+
+    // Null when the cache is disabled.
+    auto fitness_cache() const noexcept -> const FitnessCache*;
+    // Hits and misses of this problem (and its copies) only, while the stats
+    // of the cache are over all the problems sharing it.
+    auto fitness_cache_stats() const noexcept -> const FitnessCache::Stats*;
+
+    // Simulate every candidate with coarse settings first, and at full fidelity
+    // only the promising ones (see CoarseScreening).
+    WDSProblem& enable_coarse_screening(CoarseScreening::Config a_config);
+    WDSProblem& disable_coarse_screening() noexcept;
+
+    // Null when the screening is disabled.
+    auto coarse_screening() const noexcept -> const CoarseScreening*;
+
+    // Skip the evaluation of the candidates that a model trained on the
+    // evaluated ones predicts to be infeasible or dominated (see Surrogate).
+    WDSProblem& enable_surrogate(Surrogate::Config a_config);
+    WDSProblem& disable_surrogate() noexcept;
+
+    // Null when the surrogate is disabled.
+    auto surrogate() const noexcept -> const Surrogate*;
+
+    // Give up the evaluations whose simulations are still running after
+    // a_budget__s seconds of wall-clock time and return the failure penalty
+    // instead. A non-positive budget disables it.
+    WDSProblem& enable_eval_budget(double a_budget__s);
+    WDSProblem& disable_eval_budget() noexcept;
+
+    // Zero when the budget is disabled.
+    auto eval_budget__s() const noexcept -> double;
+    // Evaluations of this problem (and its copies) that ran out of time.
+    auto n_timeouts() const noexcept -> std::size_t;
+
+protected:
+    // Thrown by an evaluation whose fitness is good enough to rank the
+    // individual but is not its exact value (e.g., a bound), so that it must
+    // not be reused. See provisional_fitness.
+    struct ProvisionalFitness
+    {
+        std::vector<double> fitness;
+    };
+
+    // Return the fitness of the evaluation, also when it ends with a
+    // ProvisionalFitness. Put it outside the cache, the surrogate and the
+    // screening, so that provisional values (coarse, pruned or predicted) are
+    // neither stored in the cache nor learnt by the surrogate.
+    template <typename Evaluate>
+    auto provisional_fitness(Evaluate&& a_evaluate) const -> std::vector<double>
+    {
+        try
+        {
+            return std::forward<Evaluate>(a_evaluate)();
+        }
+        catch (ProvisionalFitness& provisional)
+        {
+            return std::move(provisional.fitness);
+        }
+    }
+
+    // Return the cached fitness of the decision vector (beme ordering) or
+    // evaluate and store it. The cache is bypassed when the inp or the metrics
+    // are saved, as these are side effects of the evaluation.
+    template <typename Evaluate>
+    auto cached_fitness(const std::vector<double>& a_beme_dv, Evaluate&& a_evaluate) const -> std::vector<double>
+    {
+        if (m__fitness_cache == nullptr || !m__inp_base_filename.empty() || !m__metrics_filename.empty())
+            return std::forward<Evaluate>(a_evaluate)();
+
+        if (auto fv = m__fitness_cache->find(a_beme_dv))
+        {
+            m__fitness_cache_stats->hits.fetch_add(1, std::memory_order_relaxed);
+            return std::move(*fv);
+        }
+
+        m__fitness_cache_stats->misses.fetch_add(1, std::memory_order_relaxed);
+        auto fv = std::forward<Evaluate>(a_evaluate)();
+        m__fitness_cache->insert(a_beme_dv, fv);
+        return fv;
+    }
+
+    // Return the fitness of the full fidelity evaluation for the promising
+    // candidates, or throw the coarse one as a ProvisionalFitness: a candidate
+    // discarded now may be promoted later (the margin tightens and the front
+    // moves), so its coarse fitness must not be cached. Hence, put it inside
+    // provisional_fitness and cached_fitness. Without a_front_test only the
+    // feasibility is screened (see CoarseScreening). The screening is bypassed
+    // when the inp or the metrics are saved, so that they are always the full
+    // fidelity ones.
+    template <typename CoarseEvaluate, typename FullEvaluate>
+    auto screened_fitness(CoarseEvaluate&& a_coarse, FullEvaluate&& a_full, const bool a_front_test = true) const -> std::vector<double>
+    {
+        if (m__coarse_screening == nullptr || !m__inp_base_filename.empty() || !m__metrics_filename.empty())
+            return std::forward<FullEvaluate>(a_full)();
+
+        bool promoted = false;
+        auto fv = m__coarse_screening->evaluate(
+            std::forward<CoarseEvaluate>(a_coarse),
+            [&promoted, &a_full]() {
+                promoted = true;
+                return std::forward<FullEvaluate>(a_full)();
+            },
+            a_front_test);
+
+        if (!promoted)
+            throw ProvisionalFitness{std::move(fv)};
+
+        return fv;
+    }
+
+    // Return the fitness of the evaluation, or throw the one predicted by the
+    // surrogate as a ProvisionalFitness for the candidates it can discard.
+    // Put it inside provisional_fitness and cached_fitness, directly around the
+    // full fidelity evaluation: the cache hits never reach the surrogate, the
+    // predictions are never cached, and the coarse or pruned fitness (thrown
+    // from inside) is never learnt. It is bypassed when the inp or the metrics
+    // are saved.
+    template <typename Evaluate>
+    auto surrogate_fitness(const std::vector<double>& a_beme_dv, Evaluate&& a_evaluate) const -> std::vector<double>
+    {
+        if (m__surrogate == nullptr || !m__inp_base_filename.empty() || !m__metrics_filename.empty())
+            return std::forward<Evaluate>(a_evaluate)();
+
+        bool evaluated = false;
+        auto fv = m__surrogate->evaluate(a_beme_dv, [&evaluated, &a_evaluate]() {
+            evaluated = true;
+            return std::forward<Evaluate>(a_evaluate)();
+        });
+
+        if (!evaluated)
+            throw ProvisionalFitness{std::move(fv)};
+
+        return fv;
+    }
+
+    // Return the fitness of the evaluation, or the failure penalty (every
+    // objective and constraint at the max, a_fitness_size values) when its
+    // simulations run out of the time budget. Put it outside the others, so
+    // that a timeout is neither stored in the cache nor learnt by the surrogate.
+    template <typename Evaluate>
+    auto budgeted_fitness(const std::size_t a_fitness_size, Evaluate&& a_evaluate) const -> std::vector<double>
+    {
+        using sim::solvers::epanet::DeadlineScope;
+
+        if (m__n_timeouts == nullptr)
+            return std::forward<Evaluate>(a_evaluate)();
+
+        auto deadline = DeadlineScope(DeadlineScope::Clock::now() + m__eval_budget);
+        try
+        {
+            return std::forward<Evaluate>(a_evaluate)();
+        }
+        catch (const sim::solvers::epanet::SimulationTimeout&)
+        {
+            m__n_timeouts->fetch_add(1, std::memory_order_relaxed);
+            return std::vector<double>(a_fitness_size, std::numeric_limits<double>::max());
+        }
+    }
+
 protected:
     std::string m__name;
     std::string m__extra_info;
@@ -79,6 +255,24 @@ protected:
     // Filename to save the metrics
     std::string m__metrics_filename;
 
+    // Per-thread copies of the network on which the fitness is evaluated.
+    // Shared between the copies of the problem made by pagmo.
+    std::shared_ptr<WDSReplicaPool> m__replicas;
+
+    // Fitness already evaluated, shared between problems with the same key.
+    std::shared_ptr<FitnessCache> m__fitness_cache;
+    std::shared_ptr<FitnessCache::Stats> m__fitness_cache_stats;
+
+    // Two-level evaluation, shared between the copies of the problem made by pagmo.
+    std::shared_ptr<CoarseScreening> m__coarse_screening;
+
+    // Model of the fitness, shared between the copies of the problem made by pagmo.
+    std::shared_ptr<Surrogate> m__surrogate;
+
+    // Time budget of an evaluation, the counter is null when it is disabled.
+    sim::solvers::epanet::DeadlineScope::Clock::duration m__eval_budget;
+    std::shared_ptr<std::atomic<std::size_t>> m__n_timeouts;
+
 }; // class WDSProblem
 
 
@@ -0,0 +1,112 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "bevarmejo/simulation/solvers/epanet/hydraulic.hpp"
+
+namespace bevarmejo {
+
+// Pool of independent copies of the same WaterDistributionSystem (each one
+// with its own EN_Project). Every thread calling lease() gets its own replica,
+// built lazily the first time the thread asks for it and then reused for all
+// the following calls. This allows to evaluate the fitness of a problem from
+// many threads (thread islands, batch evaluators, ...) without racing on a
+// single EPANET project.
+// The pool is meant to be shared (std::shared_ptr) between the copies of the
+// same problem that pagmo makes, so that the replicas are built only once.
+class WDSReplicaPool final
+{
+/*------- Member types -------*/
+public:
+    using WDS = WaterDistributionSystem;
+    using Factory = std::function<std::unique_ptr<WDS> ()>;
+
+private:
+    struct Slot
+    {
+        std::unique_ptr<WDS> wds;
+        // Declared after the network, so that it is closed before the network is destroyed.
+        std::unique_ptr<sim::solvers::epanet::HydSimSession> session;
+        std::vector<double> applied_dv; // Empty while the replica is as the prototype.
+        bool in_use = false; // Only touched by the thread owning the slot.
+    };
+
+public:
+    // RAII handle to the replica of the calling thread. The replica is given
+    // back to the pool when the lease goes out of scope.
+    class Lease final
+    {
+    private:
+        Slot* m__slot;
+
+    public:
+        Lease() = delete;
+        explicit Lease(Slot& a_slot) noexcept;
+        Lease(const Lease&) = delete;
+        Lease(Lease&& other) noexcept;
+        Lease& operator=(const Lease&) = delete;
+        Lease& operator=(Lease&&) = delete;
+        ~Lease();
+
+        WDS& operator*() const noexcept;
+        WDS* operator->() const noexcept;
+        WDS& get() const noexcept;
+
+        // Hydraulic session on the replica, kept open across the leases.
+        sim::solvers::epanet::HydSimSession& session() const;
+
+        // Decision vector currently applied to the replica, kept across the
+        // leases so that the next one can apply only the genes that differ.
+        // Empty when the replica is as the prototype.
+        std::vector<double>& applied_dv() const noexcept;
+    }; // class Lease
+
+/*------- Member objects -------*/
+private:
+    Factory m__factory;
+    mutable std::mutex m__mutex;
+    std::unordered_map<std::thread::id, Slot> m__slots;
+
+/*------- Member functions -------*/
+// (constructor)
+public:
+    WDSReplicaPool() = delete;
+    explicit WDSReplicaPool(Factory a_factory);
+    WDSReplicaPool(const WDSReplicaPool&) = delete;
+    WDSReplicaPool(WDSReplicaPool&&) = delete;
+
+// (destructor)
+public:
+    ~WDSReplicaPool() = default;
+
+// operator=
+public:
+    WDSReplicaPool& operator=(const WDSReplicaPool&) = delete;
+    WDSReplicaPool& operator=(WDSReplicaPool&&) = delete;
+
+/*------- Element access -------*/
+public:
+    // Get the replica of the calling thread (building it if necessary).
+    // A thread can hold only one lease at a time on the same pool.
+    auto lease() -> Lease;
+
+/*------- Capacity -------*/
+public:
+    // Number of replicas built so far.
+    auto size() const -> std::size_t;
+
+/*------- Factories -------*/
+public:
+    // Deep copies of the prototype (see WaterDistributionSystem::clone()), so
+    // any change done to the prototype before building the pool is kept.
+    static auto replicate(std::shared_ptr<const WDS> a_prototype) -> Factory;
+
+}; // class WDSReplicaPool
+
+} // namespace bevarmejo
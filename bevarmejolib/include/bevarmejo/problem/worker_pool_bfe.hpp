@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <string>
+
+#include <pagmo/problem.hpp>
+#include <pagmo/types.hpp>
+
+#include "bevarmejo/utility/worker_pool.hpp"
+
+namespace bevarmejo {
+
+// User-defined batch fitness evaluator (pagmo::bfe) that splits the decision
+// vectors of a batch over a fixed pool of threads. The workers outlive the
+// batches, so each one keeps leasing the same replica of the networks from
+// the WDSReplicaPool of the problem and no network is rebuilt between two
+// generations.
+// Copies of the evaluator (pagmo copies the algorithm at every evolve) share
+// the same workers.
+class WorkerPoolBFE final
+{
+/*------- Member objects -------*/
+private:
+    std::shared_ptr<WorkerPool> m__workers;
+
+/*------- Member functions -------*/
+// (constructor)
+public:
+    // One worker per hardware thread.
+    WorkerPoolBFE();
+    explicit WorkerPoolBFE(std::size_t a_n_threads);
+
+/*------- Element access -------*/
+public:
+    auto n_threads() const noexcept -> std::size_t;
+
+    auto get_name() const -> std::string;
+    auto get_extra_info() const -> std::string;
+
+/*------- Operations -------*/
+public:
+    // Mandatory in pagmo, evaluate the batch of decision vectors (stored
+    // contiguously) and return the fitness vectors in the same order.
+    auto operator()(pagmo::problem& a_prob, const pagmo::vector_double& a_dvs) const -> pagmo::vector_double;
+
+}; // class WorkerPoolBFE
+
+} // namespace bevarmejo
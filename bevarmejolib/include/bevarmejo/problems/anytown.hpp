@@ -30,6 +30,7 @@ namespace bevarmejo {
 
 namespace label {
 static const std::string __temp_elems = "TEs";
+static const std::string __prov_elems = "PEs"; // Pre-provisioned elements, installed once and toggled by the dvs
 } // namespace label 
 
 // Beginning the definition of the Anytown data and problem.
@@ -197,18 +198,22 @@ void apply_dv__exis_pipes(
     std::vector<double>::const_iterator end_dv,
     const std::vector<bevarmejo::anytown::exi_pipe_option> &ep_opts
 );
-auto cost__exis_pipes(
-    const WDS& anytown,
-    std::vector<double>::const_iterator start_dv,
-    std::vector<double>::const_iterator end_dv,
-    const std::vector<bevarmejo::anytown::exi_pipe_option> &ep_opts
-) -> double;
 void reset_dv__exis_pipes(
     WDS& anytown,
     std::vector<double>::const_iterator start_dv,
     std::vector<double>::const_iterator end_dv,
     const std::unordered_map<std::string, double> &old_HW_coeffs
 );
+// Go from the applied decision vector to the new one touching only the pipes
+// whose genes differ. The duplicates must be pre-provisioned (see fep).
+void update_dv__exis_pipes(
+    WDS& anytown,
+    const std::unordered_map<std::string, double> &orig_HW_coeffs,
+    std::vector<double>::const_iterator applied_dv,
+    std::vector<double>::const_iterator start_dv,
+    std::vector<double>::const_iterator end_dv,
+    const std::vector<bevarmejo::anytown::exi_pipe_option> &ep_opts
+);
 } // fep1
 
 // ExistingPipesFormulation: "Combined"
@@ -228,20 +233,46 @@ void apply_dv__exis_pipes(
     std::vector<double>::const_iterator end_dv,
     const std::vector<bevarmejo::anytown::exi_pipe_option> &ep_opts
 );
-auto cost__exis_pipes(
-    const WDS& anytown,
-    std::vector<double>::const_iterator start_dv,
-    std::vector<double>::const_iterator end_dv,
-    const std::vector<bevarmejo::anytown::exi_pipe_option> &ep_opts
-) -> double;
 void reset_dv__exis_pipes(
     WDS& anytown,
     std::vector<double>::const_iterator start_dv,
     std::vector<double>::const_iterator end_dv,
     const std::unordered_map<std::string, double> &old_HW_coeffs
 );
+// Go from the applied decision vector to the new one touching only the pipes
+// whose genes differ. The duplicates must be pre-provisioned (see fep).
+void update_dv__exis_pipes(
+    WDS& anytown,
+    const std::unordered_map<std::string, double> &orig_HW_coeffs,
+    std::vector<double>::const_iterator applied_dv,
+    std::vector<double>::const_iterator start_dv,
+    std::vector<double>::const_iterator end_dv,
+    const std::vector<bevarmejo::anytown::exi_pipe_option> &ep_opts
+);
 } // fep2
 
+// Pre-provisioned duplicates (both formulations):
+// all the candidate duplicates are installed once, closed, before the
+// optimisation. Then, duplicating a pipe only opens its duplicate and sets its
+// diameter (the roughness of new pipes is fixed), so that the topology of the network (and the sparse
+// structure of the EPANET solver) never changes. apply_dv and reset_dv of fep1
+// and fep2 switch to this behaviour for every duplicate in label::__prov_elems.
+namespace fep {
+auto dup_pipe_id(const std::string& exis_pipe_id) -> std::string;
+void provision__dup_pipes(
+    WDS& anytown
+);
+void open__dup_pipe(
+    WDS& anytown,
+    const std::string& dup_pipe_id,
+    double diameter__in
+);
+void close__dup_pipe(
+    WDS& anytown,
+    const std::string& dup_pipe_id
+);
+} // fep
+
 // New pipes:
 //  - select diameter (mandatory)
 static const std::string new_pipes__subnet_name = "new_pipes";
@@ -284,17 +315,58 @@ void apply_dv__new_pipes(
     std::vector<double>::const_iterator end_dv,
     const std::vector<bevarmejo::anytown::new_pipe_option> &np_opts
 );
-auto cost__new_pipes(
-    const WDS& anytown,
+void reset_dv__new_pipes(
+    WDS& anytown,
+    std::vector<double>::const_iterator start_dv,
+    std::vector<double>::const_iterator end_dv
+);
+// Same as apply_dv__new_pipes, only for the pipes whose gene differs from the applied one.
+void update_dv__new_pipes(
+    WDS& anytown,
+    std::vector<double>::const_iterator applied_dv,
     std::vector<double>::const_iterator start_dv,
     std::vector<double>::const_iterator end_dv,
     const std::vector<bevarmejo::anytown::new_pipe_option> &np_opts
+);
+} // fnp1
+
+// Capital cost of every pipe gene for every option, compiled once from the
+// network (lengths, diameters and city flags never change), so that the cost
+// of a decision vector is a sum of table lookups instead of a network search.
+struct PipesCostPlan {
+    std::size_t n_exis_options = 0;
+    std::vector<double> exis_clean; // Cleaning each existing pipe (NaN if its diameter is not an option)
+    std::vector<double> exis_dup; // Duplicating each existing pipe with each option (row major)
+    std::size_t n_new_options = 0;
+    std::vector<double> new_pipes; // Installing each new pipe with each option (row major)
+};
+auto compile__pipes_cost_plan(
+    const WDS& anytown,
+    const std::vector<bevarmejo::anytown::exi_pipe_option> &ep_opts,
+    const std::vector<bevarmejo::anytown::new_pipe_option> &np_opts
+) -> PipesCostPlan;
+
+// Capital cost of the pipe genes of each formulation, from the compiled plan.
+namespace fep1 {
+auto cost__exis_pipes(
+    const PipesCostPlan& plan,
+    std::vector<double>::const_iterator start_dv,
+    std::vector<double>::const_iterator end_dv
 ) -> double;
-void reset_dv__new_pipes(
-    WDS& anytown,
+} // fep1
+namespace fep2 {
+auto cost__exis_pipes(
+    const PipesCostPlan& plan,
     std::vector<double>::const_iterator start_dv,
     std::vector<double>::const_iterator end_dv
-);
+) -> double;
+} // fep2
+namespace fnp1 {
+auto cost__new_pipes(
+    const PipesCostPlan& plan,
+    std::vector<double>::const_iterator start_dv,
+    std::vector<double>::const_iterator end_dv
+) -> double;
 } // fnp1
 
 // Pumps:
@@ -332,6 +404,13 @@ void reset_dv__pumps(
     std::vector<double>::const_iterator start_dv,
     std::vector<double>::const_iterator end_dv
 );
+// Same as apply_dv__pumps, only for the hours whose gene differs from the applied one.
+void update_dv__pumps(
+    WDS& anytown,
+    std::vector<double>::const_iterator applied_dv,
+    std::vector<double>::const_iterator start_dv,
+    std::vector<double>::const_iterator end_dv
+);
 } // pgo_dv
 
 // New tanks:
@@ -473,6 +552,46 @@ void reset_dv__tanks(
 );
 }
 
+// Pre-provisioned tank slots (all formulations):
+// the max_n_installable_tanks candidate tanks, each one with a closed riser to
+// every possible location, are installed once before the optimisation. An
+// unused slot is an isolated tank. Installing a tank only edits the data of its
+// slot and opens the riser to the selected location, so that no node or link
+// is ever added or deleted during the optimisation. apply_dv and reset_dv of
+// fnt1, fnt2 and fnt3 switch to this behaviour when the slots are in
+// label::__prov_elems. Installed slots are listed in label::__temp_elems
+// as the tanks installed the usual way.
+namespace fnt {
+struct tank_slot_data {
+    double elevation__m;
+    double diameter__m;
+    double initial_level__m;
+    double min_level__m;
+    double max_level__m;
+    double min_volume__m3;
+    double riser_diameter__in;
+};
+
+auto tank_id(std::size_t slot) -> std::string;
+auto riser_id(std::size_t slot, const std::string& junction_id) -> std::string;
+auto has_provisioned_tanks(
+    const WDS& anytown
+) -> bool;
+void provision__tanks(
+    WDS& anytown
+);
+void install__tank_slot(
+    WDS& anytown,
+    std::size_t slot,
+    const std::string& junction_id,
+    const tank_slot_data& data
+);
+void uninstall__tank_slot(
+    WDS& anytown,
+    std::size_t slot
+);
+} // fnt
+
 // Definition of all possible problem formulations, based on the individual parts formulations.
 enum class Formulation {
     rehab_f1,
@@ -551,26 +670,54 @@ protected:
     bool m__has_operations;
     double m__additional_capital_cost; // Optional value for the initial infrastructure interventions (usually for operations problems)
     double m__max_velocity__m_per_s; // Maximum velocity for the reliability function
-    mutable std::unordered_map<std::string, double> __old_HW_coeffs; // Store the old HW coefficients for reset_dv__exis_pipes
+    bool m__prov_dup_pipes; // Duplicates of the existing pipes are pre-provisioned (see fep)
+    bool m__prov_tanks; // Slots for the new tanks are pre-provisioned (see fnt)
+    bool m__early_abort; // Stop the EPS at the first constraint violation (Hierarchical only)
+    std::unordered_map<std::string, double> m__exis_pipes_HW_coeffs; // HW coefficients of the existing pipes in the inp file
+    PipesCostPlan m__pipes_cost_plan; // Cost of the pipe genes, compiled once from the prototype
     // internal operation optimisation problem:
     pagmo::algorithm m_algo;
     mutable pagmo::population m_pop; // I need this to be mutable, so that I can invoke non-const functions on it. In particular, change the problem pointer.
 
-    struct CachedMetrics{
-        double capital_cost;
-        double energy_cost_per_day;
-    };
-    mutable CachedMetrics m__cached_metrics;
 
     // For constructor:
     void load_network(const Json& settings, const bemeio::Paths& lookup_paths);
     void load_other_data(const Json& settings, const bemeio::Paths& lookup_paths);
 
     // For fitness function:
-    double cost(const std::vector<double>& dv) const;
+    // Simulate the decision vector (beme ordering), fitness looks it up in the cache first.
+    std::vector<double> evaluate(const std::vector<double>& dvs) const;
+
+    // The evaluation is staged from the cheapest to the most expensive part,
+    // and each stage can return the penalty of the formulation:
+    // 1. the analytic checks and the capital cost, no simulation needed;
+    // 2. the EPS, stopped at the first constraint violation with early abort;
+    // 3. the operational cost and the reliability, only after it succeeded.
+    // False if the decision vector (beme ordering) can not be priced: outside
+    // the bounds, a fractional discrete gene or cleaning an existing pipe whose
+    // diameter has no cleaning cost. It is penalised as a failed simulation.
+    bool is_feasible__analytic(const std::vector<double>& dvs) const;
+    double capital_cost(const WDS& anytown, const std::vector<double>& dv) const;
+    // The terms of the cost of one evaluation. They are returned and not stored
+    // in the problem, as fitness can run concurrently (see the metrics file).
+    struct CostMetrics{
+        double capital_cost;
+        double energy_cost_per_day;
+    };
+    // Energy of the simulated day, next to the given capital cost.
+    CostMetrics cost_metrics(const WDS& anytown, const double a_capital_cost) const;
+    // Net present cost of the capital cost plus the energy of the simulated day.
+    double cost(const CostMetrics& a_metrics) const;
     
-    void apply_dv(const std::vector<double>& dvs) const;
-    void reset_dv(const std::vector<double>& dvs) const;
+    // The old HW coefficients are filled by apply_dv and used by reset_dv to restore the cleaned pipes.
+    void apply_dv(WDS& anytown, const std::vector<double>& dvs, std::unordered_map<std::string, double>& old_HW_coeffs) const;
+    void reset_dv(WDS& anytown, const std::vector<double>& dvs, const std::unordered_map<std::string, double>& old_HW_coeffs) const;
+
+    // Bring a replica from the applied decision vector (empty if the replica is
+    // as the prototype) to the new one, touching only the genes that differ.
+    // When the change would add or delete elements (duplicates or tanks that
+    // are not pre-provisioned), the replica is fully reset and applied again.
+    void update_dv(WDS& anytown, std::vector<double>& applied_dvs, const std::vector<double>& dvs) const;
 
     // Helper to transform the decision variables from pagmo to beme format
     // We override because some options of the decision variable are discrete.
@@ -1,15 +1,24 @@
 #ifndef PROBLEMS__ANYTOWN_SYSTOL25_HPP
 #define PROBLEMS__ANYTOWN_SYSTOL25_HPP
 
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <optional>
+#include <string>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
 #include "bevarmejo/utility/exceptions.hpp"
 #include "bevarmejo/utility/io.hpp"
+#include "bevarmejo/utility/worker_pool.hpp"
 namespace bemeio = bevarmejo::io;
 
 #include "bevarmejo/wds/water_distribution_system.hpp"
 #include "bevarmejo/simulation/solvers/epanet/hydraulic.hpp"
+#include "bevarmejo/evaluation/metrics/accumulators.hpp"
+#include "bevarmejo/problem/pareto_archive.hpp"
 #include "bevarmejo/problem/wds_problem.hpp"
 
 #include "bevarmejo/problems/anytown.hpp"
@@ -49,6 +58,31 @@ private:
     void load_other_data(const Json& settings, const bemeio::Paths& lookup_paths);
 
 public:
+    // True when the fireflow scenarios are pruned with the front of the
+    // simulated individuals ("Fireflow pruning").
+    auto prunes_fireflow() const noexcept -> bool;
+
+    // Number of fitness evaluations stopped early by the fireflow pruning.
+    auto n_pruned_evaluations() const noexcept -> std::size_t;
+
+    // Threads simulating the fireflow scenarios, zero when they run on the
+    // calling thread.
+    auto n_ff_threads() const noexcept -> std::size_t;
+
+    // Multi-perspective evaluation: the EPS and its constraints are evaluated
+    // once and then every requested perspective (see the "Perspectives" key)
+    // is computed on the same individual, the ones needing extra simulations
+    // concurrently. Nothing is cached and the fireflow pruning is not applied.
+    // The result is the cost followed by the second objective of each
+    // perspective, in the order of perspectives(). Infeasible individuals get
+    // the same penalty in all of them.
+    auto perspectives() const -> std::vector<std::string>;
+
+    auto evaluate_perspectives(const std::vector<double>& pagmo_dv) const -> std::vector<double>;
+
+    // Batch version, the individuals are evaluated on the pool (if any).
+    auto evaluate_perspectives(const std::vector<std::vector<double>>& pagmo_dvs, WorkerPool* a_pool = nullptr) const -> std::vector<std::vector<double>>;
+
     // Number of objective functions
     std::vector<double>::size_type get_nobj() const;
 
@@ -67,14 +101,21 @@ public:
 
 protected:
     Formulation m__formulation; // Track the problem formulation
+    std::vector<Formulation> m__perspectives; // Perspectives computed by evaluate_perspectives
 
     // All problems formulation:
     std::shared_ptr<bevarmejo::WaterDistributionSystem> m__anytown;
     std::string m__anytown_filename;
-        
-    mutable std::unordered_map<std::string, double> __old_HW_coeffs; // Store the old HW coefficients for reset_dv__exis_pipes
+
 
     sim::solvers::epanet::HydSimSettings m__eps_settings; // Settings for the main 24-hour EPS simulation
+    sim::solvers::epanet::HydSimSettings m__coarse_eps_settings; // Same, for the coarse screening (if enabled)
+    bool m__early_abort = false; // Stop the EPS at the first constraint violation
+    std::shared_ptr<sim::solvers::epanet::HydCheckpointCache> m__eps_checkpoints; // Shared EPS prefixes of the pump schedules (optional)
+    bool m__prov_dup_pipes = false; // Duplicates of the existing pipes are pre-provisioned (see anytown::fep)
+    bool m__prov_tanks = false; // Slots for the new tanks are pre-provisioned (see anytown::fnt)
+    std::unordered_map<std::string, double> m__exis_pipes_HW_coeffs; // HW coefficients of the existing pipes in the inp file
+    anytown::PipesCostPlan m__pipes_cost_plan; // Cost of the pipe genes, compiled once from the prototype
     
     // Mechanical reliability formulation
     sim::solvers::epanet::HydSimSettings m__mrsim__settings; // Settings for the mechanical reliability simulation
@@ -82,22 +123,83 @@ protected:
     // Firefighting reliability formulation
     std::shared_ptr<bevarmejo::WaterDistributionSystem> m__ff_anytown; // Anytown network to simulate the fire flows...
     std::string m__ff_anytown_filename;
+    std::shared_ptr<WDSReplicaPool> m__ff_replicas; // Per-thread copies of the fireflow network
+    std::unordered_map<std::string, double> m__ff_exis_pipes_HW_coeffs; // Same, in the fireflow inp file
+    std::shared_ptr<WorkerPool> m__ff_workers; // Threads simulating the fireflow scenarios concurrently (optional)
+    std::shared_ptr<ParetoArchive> m__ff_archive; // Front used to stop simulating dominated individuals (optional)
+    std::shared_ptr<std::atomic<std::size_t>> m__ff_n_pruned; // Evaluations stopped by the pruning (and their copies)
 
     sim::solvers::epanet::HydSimSettings m__ffsim_settings; // Settings to simulate the fireflows
 
 protected:
     // Methods 
     // For fitness function:
-    auto cost(const std::vector<double>& dv) const -> double;
-
-    auto hydraulic_reliability_perspective() const -> double;
-
-    auto mechanical_reliability_perspective() const -> double;
-
-    auto firefighting_reliability_perspective() const -> double;
+    // Simulate the decision vector (beme ordering), fitness looks it up in the cache first.
+    // The coarse evaluation simulates the EPS with the coarse settings and does
+    // not run the mr and fr perspectives: a feasible candidate gets the best
+    // reliability (-1), so that it is always simulated at full fidelity.
+    auto evaluate(const std::vector<double>& dvs, const bool a_coarse = false) const -> std::vector<double>;
+
+    // Stages 1 and 2 (see below) on a network with the decision vector
+    // applied. The penalty is set when the individual fails the EPS or its
+    // constraints, otherwise any perspective can be computed on top of it.
+    struct EPSOutcome
+    {
+        double cost;
+        std::optional<double> penalty;
+        double hydraulic_reliability; // Only if the resilience index was requested
+    };
+    auto simulate_eps(WDS& anytown, const std::vector<double>& dvs, const bool a_coarse, const bool a_resilience) const -> EPSOutcome;
+
+    // The evaluation is staged from the cheapest to the most expensive part,
+    // each stage returning the penalty as soon as it decides it:
+    // 1. capital cost (no simulation needed),
+    // 2. EPS (with the optional early abort) and its constraints,
+    // 3. reliability perspective, only for the solutions satisfying them.
+    auto capital_cost(const WDS& anytown, const std::vector<double>& dv) const -> double;
+
+    // Net present cost of the capital cost plus the daily energy cost.
+    auto cost(const double a_capital_cost, const double energy_cost_per_day) const -> double;
+
+    auto hydraulic_reliability_perspective(const eval::metrics::OnlineResilienceIndex& a_resilience_index) const -> double;
+
+    auto mechanical_reliability_perspective(WDS& anytown) const -> double;
+
+    // Each scenario runs on a replica of the fireflow network leased by the
+    // thread simulating it, so the decision vector is applied there.
+    // With the pruning enabled, the scenarios stop as soon as the individual
+    // (whose cost is a_cost) is dominated by the archive even if it scored
+    // full reliability in the remaining ones. The value is then that upper
+    // bound and the result is flagged as pruned (only if a_prunable).
+    // The pruned values are not deterministic: they depend on the archive,
+    // i.e., on the order of the evaluations, and with the fireflow threads on
+    // which scenarios had finished when the bound was crossed. So, unlike the
+    // exact values, they change with the number of threads and are never
+    // cached nor used to train the surrogate.
+    struct FireflowReliability
+    {
+        double value;
+        bool pruned;
+    };
+    auto firefighting_reliability_perspective(const std::vector<double>& dvs, const double a_cost, const bool a_prunable) const -> FireflowReliability;
+
+    // Supply over demand of a single fireflow scenario (0 if the simulation fails).
+    // The simulation starts from the state of the network before the fire, if any.
+    auto fireflow_scenario(WDS& ff_anytown, std::size_t a_scenario, const std::optional<sim::solvers::epanet::HydCheckpoint>& a_pre_event) const -> double;
     
-    void apply_dv(const std::vector<double>& dvs) const;
-    void reset_dv(const std::vector<double>& dvs) const;
+    void apply_dv(WDS& anytown, const std::vector<double>& dvs, std::unordered_map<std::string, double>& old_HW_coeffs) const;
+    void reset_dv(WDS& anytown, const std::vector<double>& dvs, const std::unordered_map<std::string, double>& old_HW_coeffs) const;
+
+    // Same, for the network used to simulate the fireflows (fr perspective only).
+    void apply_dv__fireflow(WDS& ff_anytown, const std::vector<double>& dvs, std::unordered_map<std::string, double>& old_HW_coeffs) const;
+    void reset_dv__fireflow(WDS& ff_anytown, const std::vector<double>& dvs, const std::unordered_map<std::string, double>& old_HW_coeffs) const;
+
+    // Bring a replica from applied_dvs (empty if it is as the prototype) to dvs,
+    // touching only the elements whose genes changed. Falls back to a full
+    // reset and apply when elements that are not pre-provisioned must be added
+    // or removed.
+    void update_dv(WDS& anytown, std::vector<double>& applied_dvs, const std::vector<double>& dvs) const;
+    void update_dv__fireflow(WDS& ff_anytown, std::vector<double>& applied_dvs, const std::vector<double>& dvs) const;
 
     // Helper to transform the decision variables from pagmo to beme format
     std::vector<bool> get_continuous_dvs_mask() const override;
@@ -1,6 +1,7 @@
 #ifndef HANOI__PROBLEM_HANOI_F1_HPP
 #define HANOI__PROBLEM_HANOI_F1_HPP
 
+#include <array>
 #include <cmath>
 #include <iostream>
 #include <filesystem>
@@ -12,6 +13,7 @@ namespace fsys = std::filesystem;
 #include "bevarmejo/io/json.hpp"
 
 #include "bevarmejo/wds/water_distribution_system.hpp"
+#include "bevarmejo/simulation/solvers/epanet/hydraulic.hpp"
 
 #include "bevarmejo/problem/wds_problem.hpp"
 
@@ -56,6 +58,13 @@ private:
 private:
     std::shared_ptr<bevarmejo::WaterDistributionSystem> m_hanoi;
     std::array<double, n_available_diams> m_diams_cost; // This is a * D_i^b so it can be computed offline once.
+    std::array<double, n_available_diams> m_diams_mm; // Same, the diameters in the units of EPANET.
+    sim::solvers::epanet::HydSimSettings m_sim_settings; // Read once from the inp file, zero horizon means a snapshot simulation.
+    // Decision plan compiled once from the prototype: gene i changes the EPANET
+    // link m_plan_EN_index[i] and option j costs m_plan_costs[i*n_available_diams+j].
+    // Every replica has the same indices as the prototype (Hanoi never adds elements).
+    std::array<int, n_dv> m_plan_EN_index;
+    std::array<double, n_dv*n_available_diams> m_plan_costs;
 
 /*------- Member functions -------*/
 // (constructor)
@@ -97,7 +106,12 @@ public:
 
     double cost(const std::vector<double>& dv) const;
 
-    void apply_dv(WaterDistributionSystem& a_wds, const std::vector<double>& dv) const;
+    // Simulate the decision vector, fitness looks it up in the cache first.
+    std::vector<double> evaluate(const std::vector<double>& dv) const;
+
+    // Only the diameters whose gene differs from a_applied_dv (what the network
+    // currently has, empty for all of them) are written, then a_applied_dv = dv.
+    void apply_dv(WaterDistributionSystem& a_wds, std::vector<double>& a_applied_dv, const std::vector<double>& dv) const;
 
     // No need to use reset as at every run the same design variables are for sure overwritten.
 
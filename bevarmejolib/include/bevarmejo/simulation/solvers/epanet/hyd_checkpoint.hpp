@@ -0,0 +1,141 @@
+#pragma once
+
+#include <any>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "bevarmejo/wds/utility/global_times.hpp"
+
+namespace bevarmejo::sim::solvers::epanet
+{
+
+// State of an extended period simulation right before the step at time t is
+// solved: what EPANET carries from one step to the next, the steps committed so
+// far and what the accumulators have aggregated. A simulation resumed from it
+// gives the same steps as the original one, provided the network and the
+// settings are the same (only what drives the steps from t onward may differ).
+// The energy report of EPANET (EN_getlinkvalue with EN_ENERGY is the current
+// power, not the report) is not part of the state.
+// solve_initial_state gives instead the state right after the step at t = 0
+// is solved, the starting point of the simulations of similar networks.
+struct HydCheckpoint
+{
+    time::Instant t = 0;
+
+    // Steps committed before t, with their EPANET error code.
+    std::vector<std::pair<time::Instant, int>> results;
+
+    // EPANET clocks and arrays (1-based, as in the EN_Project).
+    long next_report_t = 0;
+    std::vector<double> node_heads;
+    std::vector<double> node_demands;
+    std::vector<double> node_full_demands;
+    std::vector<double> node_demand_flows;
+    std::vector<double> node_emitter_flows;
+    std::vector<double> link_flows;
+    std::vector<double> link_settings;
+    std::vector<int> link_status;
+    std::vector<int> link_old_status; // Links and then tanks
+    std::vector<double> tank_volumes;
+
+    // In the order of the accumulators given to solve_hydraulics.
+    std::vector<std::any> accumulators;
+};
+
+// Bounded (LRU) store of the checkpoints of the simulations of one
+// HydSimSettings. A checkpoint is keyed by the design (everything that changes
+// the hydraulics at every step, e.g., the other genes) and by the schedule
+// simulated so far. Both are compared in full, the hash only finds the
+// candidates. a_schedule[i] drives the period [i*period, (i+1)*period) of the
+// simulation (e.g., the hourly pump-group genes), so two individuals with the
+// same design and the same first k values share the simulation up to k*period.
+// Thread safe, it can be shared by all the replicas of a problem.
+class HydCheckpointCache final
+{
+/*------- Member types -------*/
+public:
+    using Schedule = std::vector<double>;
+
+    struct Stats
+    {
+        std::atomic<std::size_t> resumed{0}; // Simulations that did not start from t = 0
+        std::atomic<std::size_t> periods_skipped{0};
+    };
+
+private:
+    struct Entry
+    {
+        std::uint64_t hash;
+        std::vector<double> design;
+        Schedule prefix;
+        std::shared_ptr<const HydCheckpoint> checkpoint;
+    };
+
+/*------- Member objects -------*/
+private:
+    time::Instant m__period__s;
+    std::size_t m__capacity;
+    mutable std::mutex m__mutex;
+    std::list<Entry> m__lru; // Most recently used at the front.
+    std::unordered_multimap<std::uint64_t, std::list<Entry>::iterator> m__index;
+    Stats m__stats;
+
+/*------- Member functions -------*/
+// (constructor)
+public:
+    HydCheckpointCache() = delete;
+    HydCheckpointCache(const time::Instant a_period__s, const std::size_t a_capacity);
+    HydCheckpointCache(const HydCheckpointCache&) = delete;
+    HydCheckpointCache(HydCheckpointCache&&) = delete;
+
+// (destructor)
+public:
+    ~HydCheckpointCache() = default;
+
+// operator=
+public:
+    HydCheckpointCache& operator=(const HydCheckpointCache&) = delete;
+    HydCheckpointCache& operator=(HydCheckpointCache&&) = delete;
+
+/*------- Element access -------*/
+public:
+    auto period() const noexcept -> time::Instant;
+
+    // Checkpoint of the design with the longest prefix of the schedule, with
+    // the length of the prefix. {nullptr, 0} if there is none.
+    auto find_longest(const std::vector<double>& a_design, const Schedule& a_schedule) -> std::pair<std::shared_ptr<const HydCheckpoint>, std::size_t>;
+
+    auto contains(const std::vector<double>& a_design, const Schedule& a_schedule, const std::size_t a_prefix_size) const -> bool;
+
+    auto stats() const noexcept -> const Stats&;
+
+/*------- Capacity -------*/
+public:
+    auto size() const -> std::size_t;
+    auto capacity() const noexcept -> std::size_t;
+
+/*------- Modifiers -------*/
+public:
+    // Store the checkpoint taken at a_prefix_size*period, evicting the least
+    // recently used one when full.
+    void insert(const std::vector<double>& a_design, const Schedule& a_schedule, const std::size_t a_prefix_size, std::shared_ptr<const HydCheckpoint> a_checkpoint);
+
+/*------- Hash -------*/
+public:
+    // Hash of a range of values (e.g., the genes of the design).
+    static auto hash(std::vector<double>::const_iterator a_first, std::vector<double>::const_iterator a_last, std::uint64_t a_seed = 0) noexcept -> std::uint64_t;
+
+private:
+    // Entry of the index with the same design and prefix, m__index.end() if none.
+    auto find(const std::uint64_t a_hash, const std::vector<double>& a_design, const Schedule& a_schedule, const std::size_t a_prefix_size) const -> decltype(m__index)::const_iterator;
+
+}; // class HydCheckpointCache
+
+} // namespace bevarmejo::sim::solvers::epanet
@@ -1,8 +1,17 @@
 #pragma once
 
+#include <chrono>
+#include <functional>
+#include <optional>
+#include <stdexcept>
+#include <vector>
+
 #include "bevarmejo/wds/water_distribution_system.hpp"
+#include "bevarmejo/wds/utility/epanet/results_profile.hpp"
 #include "bevarmejo/simulation/hyd_sim_settings.hpp"
 
+#include "bevarmejo/simulation/solvers/epanet/hyd_checkpoint.hpp"
+#include "bevarmejo/simulation/solvers/epanet/step_accumulator.hpp"
 #include "bevarmejo/simulation/solvers/epanet/water_demand_modelling.hpp"
 
 namespace bevarmejo::sim::solvers::epanet
@@ -24,6 +33,8 @@ private:
 
     double m__demand_multiplier = 1.; // Global water demand multiplier (applied when preparing the matrices to solve).
 
+    bevarmejo::epanet::ResultsProfile m__results_profile; // Results to retrieve and store at each step (default: all).
+
 /*------- Member functions -------*/
 // (constructor)
 public:
@@ -46,6 +57,8 @@ public:
 
     auto demand_multiplier() const noexcept -> double;
 
+    auto results_profile() const noexcept -> const bevarmejo::epanet::ResultsProfile&;
+
 /*--- Modifiers ---*/
 public:
     auto report_resolution(time_t a_resolution) -> HydSimSettings&;
@@ -59,14 +72,148 @@ public:
 
     auto demand_multiplier(double a_multiplier) -> HydSimSettings&;
 
+    auto results_profile(const bevarmejo::epanet::ResultsProfile& a_profile) -> HydSimSettings&;
+
 /*--- Methods ---*/
 public:
     auto apply_water_demand_model(EN_Project a_ph) const -> void;
 
+    // True if applying the other settings to the solver would change nothing
+    // (time parameters, water demand model and demand multiplier).
+    auto has_same_solver_setup(const HydSimSettings& other) const noexcept -> bool;
+
 }; // class HydSimSettings
 
+// Hydraulic solver of a WDS kept open across simulations. EN_openH (allocation
+// of the matrices and symbolic factorisation) is called only the first time,
+// the settings are re-applied only when they change, and each simulation just
+// re-initialises the solver (EN_initH).
+// EPANET refuses to add or delete elements while the solver is open, so close()
+// the session before changing the topology of the network: the next simulation
+// opens it again.
+class HydSimSession final
+{
+/*------- Member objects -------*/
+private:
+    bevarmejo::WaterDistributionSystem* m__wds;
+    std::optional<HydSimSettings> m__applied_settings; // Settings currently set in the EN_Project.
+
+/*------- Member functions -------*/
+// (constructor)
+public:
+    HydSimSession() = delete;
+    explicit HydSimSession(bevarmejo::WaterDistributionSystem& a_wds) noexcept;
+    HydSimSession(const HydSimSession&) = delete;
+    HydSimSession(HydSimSession&&) = delete;
+
+// (destructor)
+public:
+    ~HydSimSession();
+
+// operator=
+public:
+    HydSimSession& operator=(const HydSimSession&) = delete;
+    HydSimSession& operator=(HydSimSession&&) = delete;
+
+/*--- Element access ---*/
+public:
+    auto wds() const noexcept -> bevarmejo::WaterDistributionSystem&;
+
+    auto is_open() const noexcept -> bool;
+
+/*--- Modifiers ---*/
+public:
+    // Open the solver if needed, apply the settings if they changed and
+    // initialise a new simulation.
+    void prepare(const HydSimSettings& a_settings);
+
+    void close() noexcept;
+
+}; // class HydSimSession
+
+// Thrown by solve_hydraulics when the simulation is still running after the
+// deadline of the calling thread (see DeadlineScope).
+class SimulationTimeout : public std::runtime_error
+{
+public:
+    using std::runtime_error::runtime_error;
+};
+
+// Wall-clock deadline of the simulations of the calling thread while the scope
+// is alive (e.g., the time budget of a fitness evaluation). solve_hydraulics
+// checks it between two steps, as EPANET can not be interrupted within one.
+// The previous deadline is restored at the end of the scope. The tasks handed
+// to other threads must open their own scope with current().
+class DeadlineScope final
+{
+/*------- Member types -------*/
+public:
+    using Clock = std::chrono::steady_clock;
+    using Deadline = std::optional<Clock::time_point>;
+
+/*------- Member objects -------*/
+private:
+    Deadline m__previous;
+
+/*------- Member functions -------*/
+// (constructor)
+public:
+    DeadlineScope() = delete;
+    explicit DeadlineScope(const Deadline a_deadline) noexcept;
+    DeadlineScope(const DeadlineScope&) = delete;
+    DeadlineScope(DeadlineScope&&) = delete;
+
+// (destructor)
+public:
+    ~DeadlineScope();
+
+// operator=
+public:
+    DeadlineScope& operator=(const DeadlineScope&) = delete;
+    DeadlineScope& operator=(DeadlineScope&&) = delete;
+
+/*--- Element access ---*/
+public:
+    // Deadline of the calling thread, empty if there is none.
+    static auto current() noexcept -> Deadline;
+
+}; // class DeadlineScope
+
 using HydSimResults = bevarmejo::wds::aux::QuantitySeries<int>;
+
+// Checked after each committed step, once the accumulators have been fed. When
+// it returns true the simulation stops, and the results (of the elements, of the
+// accumulators and the returned ones) contain only the steps simulated so far.
+using StepPredicate = std::function<bool(const bevarmejo::WaterDistributionSystem&, const bevarmejo::epanet::ResultsBuffer&, const bevarmejo::time::Instant)>;
+
 HydSimResults solve_hydraulics(bevarmejo::WaterDistributionSystem& a_wds, const bevarmejo::sim::solvers::epanet::HydSimSettings& a_settings);
+// Same, feeding the accumulators with the results of each committed step.
+HydSimResults solve_hydraulics(bevarmejo::WaterDistributionSystem& a_wds, const bevarmejo::sim::solvers::epanet::HydSimSettings& a_settings, const StepAccumulators& a_accumulators);
+// Same, stopping as soon as the predicate is true.
+HydSimResults solve_hydraulics(bevarmejo::WaterDistributionSystem& a_wds, const bevarmejo::sim::solvers::epanet::HydSimSettings& a_settings, const StepAccumulators& a_accumulators, const StepPredicate& a_should_stop);
+// Same, resuming from the checkpoint of the cache with the longest prefix of
+// a_schedule (for a_design) and saving a checkpoint at each period boundary not
+// yet in the cache. The cache must be used only with these settings, which
+// must store no results in the elements (ResultsProfile::none()): the outcome
+// is in the accumulators and in the returned results.
+HydSimResults solve_hydraulics(bevarmejo::WaterDistributionSystem& a_wds, const bevarmejo::sim::solvers::epanet::HydSimSettings& a_settings, const StepAccumulators& a_accumulators, const StepPredicate& a_should_stop, HydCheckpointCache& a_cache, const std::vector<double>& a_design, const std::vector<double>& a_schedule);
+// Same as the first, with the first step converging from a state solved at
+// t = 0 with the same settings (see solve_initial_state) instead of from the
+// default initial flows. The state must come from a network with the same
+// elements, e.g. before an event changes its demands.
+HydSimResults solve_hydraulics(bevarmejo::WaterDistributionSystem& a_wds, const bevarmejo::sim::solvers::epanet::HydSimSettings& a_settings, const HydCheckpoint& a_initial_state);
+// Same, on the network of the session without closing its solver at the end.
+HydSimResults solve_hydraulics(HydSimSession& a_session, const bevarmejo::sim::solvers::epanet::HydSimSettings& a_settings, const StepAccumulators& a_accumulators = {}, const StepPredicate& a_should_stop = {});
+
+// Steady-state (snapshot) simulation on the network of the session: a single
+// hydraulic solution at the start time, no time stepping. The results are only
+// fed to the accumulators (at t = 0), so neither the elements nor the result
+// time series of the network are touched. Returns the EPANET error code.
+int solve_snapshot(HydSimSession& a_session, const bevarmejo::sim::solvers::epanet::HydSimSettings& a_settings, const StepAccumulators& a_accumulators);
+
+// Solve only the first step (t = 0) and return the hydraulic state it reached,
+// without committing any result. Empty if EPANET failed.
+auto solve_initial_state(bevarmejo::WaterDistributionSystem& a_wds, const bevarmejo::sim::solvers::epanet::HydSimSettings& a_settings) -> std::optional<HydCheckpoint>;
 
 bool is_successful(const HydSimResults& a_results) noexcept;
 bool is_successful_with_warnings(const HydSimResults& a_results) noexcept;
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <any>
+#include <functional>
+#include <vector>
+
+#include "bevarmejo/wds/utility/global_times.hpp"
+#include "bevarmejo/wds/utility/epanet/results_buffer.hpp"
+#include "bevarmejo/wds/utility/epanet/results_profile.hpp"
+
+namespace bevarmejo {
+
+// Forward definition of the WDS class.
+class WaterDistributionSystem;
+
+namespace sim::solvers::epanet {
+
+// A metric computed online by solve_hydraulics. At each committed step, it is
+// fed with the results straight from the columns of the ResultsBuffer, so the
+// elements do not need to store the full series when only an aggregate
+// (integral, maximum, count, ...) of the simulation is needed.
+// The duration of a step is the time until the next committed step, thus an
+// accumulator integrating over time must keep the value of the previous step
+// (see eval::metrics::ForwardIntegral), as QuantitySeries::integrate_forward.
+class StepAccumulator
+{
+/*------- Member functions -------*/
+// (destructor)
+public:
+    virtual ~StepAccumulator() = default;
+
+/*------- Element access -------*/
+public:
+    // Quantities read from the results buffer. They are retrieved even when
+    // the profile of the simulation settings does not store them.
+    virtual auto required_results() const -> bevarmejo::epanet::ResultsProfile = 0;
+
+/*------- Modifiers -------*/
+public:
+    // Called by solve_hydraulics before the first step.
+    virtual void reset(const WaterDistributionSystem& a_wds) = 0;
+
+    // Called by solve_hydraulics at each committed step, after the elements.
+    virtual void accumulate(const WaterDistributionSystem& a_wds, const bevarmejo::epanet::ResultsBuffer& a_results, const time::Instant t) = 0;
+
+/*------- Checkpoints -------*/
+public:
+    // What has been accumulated so far, without what reset() binds to the
+    // network, so that a simulation resumed from a checkpoint (even on another
+    // replica) continues the aggregates (see HydCheckpoint).
+    virtual auto save_state() const -> std::any = 0;
+    // Called after reset(), with a state saved by an accumulator of the same type.
+    virtual void restore_state(const std::any& a_state) = 0;
+
+}; // class StepAccumulator
+
+using StepAccumulators = std::vector<std::reference_wrapper<StepAccumulator>>;
+
+} // namespace sim::solvers::epanet
+} // namespace bevarmejo
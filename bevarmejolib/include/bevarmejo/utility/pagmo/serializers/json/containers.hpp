@@ -4,6 +4,7 @@
 #include <iostream>
 
 #include <pagmo/algorithm.hpp>
+#include <pagmo/bfe.hpp>
 #include <pagmo/island.hpp>
 #include <pagmo/problem.hpp>
 #include <pagmo/r_policy.hpp>
@@ -12,6 +13,7 @@
 
 #include "bevarmejo/io/json.hpp"
 #include "bevarmejo/io/keys/beme.hpp"
+#include "bevarmejo/io/keys/bemeopt.hpp"
 #include "bevarmejo/utility/exceptions.hpp"
 
 // Pagmo objects that can be serialized
@@ -19,6 +21,8 @@
 #include "bevarmejo/utility/pagmo/serializers/json/default_objects.hpp"
 
 // Bevarmejo objects that can be serialized
+#include "bevarmejo/problem/process_pool_bfe.hpp"
+#include "bevarmejo/problem/worker_pool_bfe.hpp"
 #include "bevarmejo/problems/anytown.hpp"
 #include "bevarmejo/problems/hanoi.hpp"
 #include "bevarmejo/problems/anytown_systol25.hpp"
@@ -54,6 +58,17 @@ struct adl_serializer<pagmo::algorithm>
         // The key "type" is mandatory, describes the algorithm class to be used.
         // The key "params" is optional, contains the parameters for the algorithm.
         // If not present, an empty object is used so that the default parameters are used.
+        // The key "threads" is optional, if present and greater than zero the
+        // algorithms supporting a batch fitness evaluator evaluate each
+        // generation in parallel on that many threads (see WorkerPoolBFE).
+        // The key "processes" is optional, the same but each evaluation runs
+        // in one of that many worker processes (see ProcessPoolBFE), so that
+        // a crash in EPANET does not end the optimisation. It can not be used
+        // together with "threads", nor with a problem that learns from its
+        // evaluations (fitness cache, surrogate, etc., see ProcessPoolBFE).
+        // The key "process timeout" is optional, the seconds a worker process
+        // has to evaluate a solution before it is killed and restarted
+        // (default ProcessPoolBFE::k__default_timeout__s, zero for no timeout).
         beme_throw_if(!bevarmejo::io::key::type.exists_in(j),
             std::runtime_error,
             "Cannot build the pagmo::algorithm",
@@ -63,6 +78,21 @@ struct adl_serializer<pagmo::algorithm>
 
         auto algo_params = j.value(bevarmejo::io::key::params.as_in(j), Json{});
 
+        auto n_threads = j.value(bevarmejo::io::key::threads.as_in(j), std::size_t{0});
+        auto n_processes = j.value(bevarmejo::io::key::processes.as_in(j), std::size_t{0});
+        auto process_timeout__s = j.value(bevarmejo::io::key::process_timeout.as_in(j), bevarmejo::ProcessPoolBFE::k__default_timeout__s);
+
+        beme_throw_if(n_threads > 0 && n_processes > 0,
+            std::runtime_error,
+            "Cannot build the pagmo::algorithm",
+            "The keys 'threads' and 'processes' can not be used together.");
+
+        beme_throw_if(process_timeout__s < 0.0,
+            std::runtime_error,
+            "Cannot build the pagmo::algorithm",
+            "The process timeout can not be negative.",
+            "Process timeout : ", process_timeout__s);
+
         // Based on the algo_type, I have to build the algorithm
 #if BEME_VERSION < 240601
         if (algo_type == "nsga2") // TODO: transform into a key
@@ -70,7 +100,13 @@ struct adl_serializer<pagmo::algorithm>
         if (algo_type == "pagmo::nsga2")
 #endif
         {
-            algo = algo_params.get<pagmo::nsga2>();
+            auto uda = algo_params.get<pagmo::nsga2>();
+            if (n_threads > 0)
+                uda.set_bfe(pagmo::bfe{bevarmejo::WorkerPoolBFE(n_threads)});
+            else if (n_processes > 0)
+                uda.set_bfe(pagmo::bfe{bevarmejo::ProcessPoolBFE(n_processes, process_timeout__s)});
+
+            algo = std::move(uda);
         }
         else
         {
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace bevarmejo {
+
+// Fixed set of threads, started once and kept alive until the pool is
+// destroyed. Long-lived workers matter here because the replicas of the
+// networks (see WDSReplicaPool) are bound to the thread that leased them:
+// the same worker reuses the same replica at every batch.
+class WorkerPool final
+{
+/*------- Member types -------*/
+public:
+    using Task = std::function<void (std::size_t)>;
+
+/*------- Member objects -------*/
+private:
+    std::vector<std::thread> m__workers;
+    std::mutex m__mutex;
+    std::condition_variable m__cv;
+    std::deque<std::function<void ()>> m__jobs;
+    bool m__stop;
+
+/*------- Member functions -------*/
+// (constructor)
+public:
+    WorkerPool() = delete;
+    // Zero workers means one per hardware thread.
+    explicit WorkerPool(std::size_t a_n_workers);
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool(WorkerPool&&) = delete;
+
+// (destructor)
+public:
+    // Waits for the queued jobs and joins the workers.
+    ~WorkerPool();
+
+// operator=
+public:
+    WorkerPool& operator=(const WorkerPool&) = delete;
+    WorkerPool& operator=(WorkerPool&&) = delete;
+
+/*------- Capacity -------*/
+public:
+    auto size() const noexcept -> std::size_t;
+
+/*------- Operations -------*/
+public:
+    // Call a_task(i) for each i in [0, a_n_tasks) on the workers and wait for
+    // all of them. The indices are handed out one at a time, so tasks with
+    // different durations are balanced. If a task throws, the remaining ones
+    // are skipped and the first exception is rethrown here.
+    // When called from one of the workers of this pool, the tasks are run
+    // sequentially on the calling thread instead of deadlocking.
+    void parallel_for(std::size_t a_n_tasks, const Task& a_task);
+
+private:
+    void work();
+
+}; // class WorkerPool
+
+} // namespace bevarmejo
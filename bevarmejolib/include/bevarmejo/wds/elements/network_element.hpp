@@ -7,6 +7,11 @@
 
 #include "bevarmejo/wds/element.hpp"
 
+namespace bevarmejo::epanet
+{
+class ResultsBuffer;
+} // namespace bevarmejo::epanet
+
 namespace bevarmejo::wds
 {
 
@@ -69,6 +74,9 @@ public:
     virtual void clear_results();
 
     virtual void retrieve_EN_results();
+    // Same as above, but reading the values from the columns already retrieved
+    // for the whole network (see bevarmejo::epanet::ResultsBuffer).
+    virtual void retrieve_EN_results(const epanet::ResultsBuffer& a_results);
 };
 
 } // namespace bevarmejo::wds
@@ -90,9 +90,11 @@ public:
     void retrieve_EN_index() override final;
     virtual void retrieve_EN_properties() override;
     virtual void retrieve_EN_results() override;
+    virtual void retrieve_EN_results(const epanet::ResultsBuffer& a_results) override;
 private:
     void __retrieve_EN_properties();
     void __retrieve_EN_results();
+    void __retrieve_EN_results(const epanet::ResultsBuffer& a_results);
 public:
     void from_node(Node_ptr a_node);
 
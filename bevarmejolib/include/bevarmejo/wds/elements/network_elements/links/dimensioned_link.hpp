@@ -99,9 +99,11 @@ public:
 
     virtual void retrieve_EN_properties() override;
     virtual void retrieve_EN_results() override;
+    virtual void retrieve_EN_results(const epanet::ResultsBuffer& a_results) override;
 private:
     void __retrieve_EN_properties();
     void __retrieve_EN_results();
+    void __retrieve_EN_results(const epanet::ResultsBuffer& a_results);
 
 }; // class DimensionedLink
 
@@ -120,9 +120,11 @@ public:
 
     void retrieve_EN_properties() override;
     void retrieve_EN_results() override;
+    void retrieve_EN_results(const epanet::ResultsBuffer& a_results) override;
 private:
     void __retrieve_EN_properties();
     void __retrieve_EN_results();
+    void __retrieve_EN_results(const epanet::ResultsBuffer& a_results);
 
 }; // class Pump
 
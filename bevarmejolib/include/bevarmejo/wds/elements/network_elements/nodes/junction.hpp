@@ -3,6 +3,7 @@
 
 #include <string>
 #include <unordered_map>
+#include <utility>
 
 #include "bevarmejo/wds/utility/quantity_series.hpp"
 
@@ -88,6 +89,8 @@ public:
     const FlowSeries& demand_delivered() const; // Share of the total demand that was delivered (consumption)
     const FlowSeries& consumption() const; // Share of the total demand that was delivered (consumption)
     const FlowSeries& demand_undelivered() const; // Share of the total demand that was not delivered
+    // Total demand at the current step, read directly from the results buffer (not stored).
+    auto demand_requested(const epanet::ResultsBuffer& a_results) const -> double;
     
 /*------- Capacity -------*/
 public:
@@ -98,9 +101,13 @@ public:
 
     void retrieve_EN_properties() override;
     void retrieve_EN_results() override;
+    void retrieve_EN_results(const epanet::ResultsBuffer& a_results) override;
 private:
     void __retrieve_EN_properties();
     void __retrieve_EN_results();
+    void __retrieve_EN_results(const epanet::ResultsBuffer& a_results);
+    void __commit_EN_demand_results(const time::Instant t, const double undeliv, const double emitter_flow, const double leakage_flow);
+    auto __split_EN_outflow(const double outflow, const double head, const double undeliv, const double emitter_flow, const double leakage_flow) const -> std::pair<double, double>; // consumption, undelivered
 
 }; // class Junction
 
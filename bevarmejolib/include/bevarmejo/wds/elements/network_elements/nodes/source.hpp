@@ -81,8 +81,11 @@ public:
     virtual void clear_results() override;
 
     virtual void retrieve_EN_results() override;
+
+    virtual void retrieve_EN_results(const epanet::ResultsBuffer& a_results) override;
 private:
     void __retrieve_EN_results();
+    void __retrieve_EN_results(const epanet::ResultsBuffer& a_results);
 }; // class Source
     
 } // namespace bevarmejo::wds
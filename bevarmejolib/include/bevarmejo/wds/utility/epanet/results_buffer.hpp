@@ -0,0 +1,111 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <vector>
+
+#include "epanet2_2.h"
+
+#include "bevarmejo/wds/utility/epanet/results_profile.hpp"
+
+namespace bevarmejo {
+
+// Forward definition of the WDS class.
+class WaterDistributionSystem;
+
+namespace epanet {
+
+// Columnar copy of the hydraulic results of an EPANET project at the current
+// hydraulic step. Each quantity is retrieved for all the nodes (or links) at
+// once (EN_getnodevalues/EN_getlinkvalues) into a contiguous column, already
+// converted to the units used in bevarmejo with a factor computed only once.
+// The elements then read their value from the column with their EN index,
+// instead of asking EPANET for each quantity of each element.
+// Only the columns needed by the ResultsProfile are allocated and retrieved.
+// Extra columns can be retrieved without the elements storing them (e.g., for
+// metrics computed online during the simulation).
+class ResultsBuffer final
+{
+/*------- Member types -------*/
+public:
+    using Column = std::vector<double>;
+
+    enum class NodeQuantity : std::size_t
+    {
+        Head,           // m
+        Outflow,        // L/s (EN_DEMAND)
+        Pressure,       // m
+        DemandDeficit,  // L/s
+        EmitterFlow,    // L/s
+        LeakageFlow,    // L/s
+        TankLevel,      // m
+        TankVolume,     // m^3
+        Count
+    };
+
+    enum class LinkQuantity : std::size_t
+    {
+        Flow,           // L/s
+        Velocity,       // m/s
+        Energy,         // kW
+        Status,         // dimensionless
+        Efficiency,     // dimensionless
+        Count
+    };
+
+/*------- Member objects -------*/
+private:
+    EN_Project m__ph;
+    int m__n_nodes;
+    int m__n_links;
+    bool m__has_tanks;
+    bool m__has_pumps;
+    ResultsProfile m__profile;
+
+    std::array<Column, static_cast<std::size_t>(NodeQuantity::Count)> m__nodes;
+    std::array<Column, static_cast<std::size_t>(LinkQuantity::Count)> m__links;
+
+    std::array<double, static_cast<std::size_t>(NodeQuantity::Count)> m__node_factors;
+    std::array<double, static_cast<std::size_t>(LinkQuantity::Count)> m__link_factors;
+
+/*------- Member functions -------*/
+// (constructor)
+public:
+    ResultsBuffer() = delete;
+    explicit ResultsBuffer(const WaterDistributionSystem& a_wds);
+    ResultsBuffer(const WaterDistributionSystem& a_wds, const ResultsProfile& a_profile);
+    ResultsBuffer(const WaterDistributionSystem& a_wds, const ResultsProfile& a_profile, const ResultsProfile& a_extra_columns);
+    ResultsBuffer(const ResultsBuffer&) = default;
+    ResultsBuffer(ResultsBuffer&&) noexcept = default;
+
+// (destructor)
+public:
+    ~ResultsBuffer() = default;
+
+// operator=
+public:
+    ResultsBuffer& operator=(const ResultsBuffer&) = default;
+    ResultsBuffer& operator=(ResultsBuffer&&) noexcept = default;
+
+/*------- Element access -------*/
+public:
+    // Value of the quantity for the element with the given EN index (1-based).
+    auto node(NodeQuantity a_quantity, int a_en_index) const -> double;
+    auto link(LinkQuantity a_quantity, int a_en_index) const -> double;
+
+    auto column(NodeQuantity a_quantity) const noexcept -> const Column&;
+    auto column(LinkQuantity a_quantity) const noexcept -> const Column&;
+
+    auto profile() const noexcept -> const ResultsProfile&;
+    // Shortcut for the elements: should they commit this quantity?
+    auto records(unsigned int a_type_code, ResultsProfile::Quantity a_quantity) const noexcept -> bool;
+
+/*------- Modifiers -------*/
+public:
+    // Fill all the allocated columns with the results of the current hydraulic step.
+    void retrieve();
+
+}; // class ResultsBuffer
+
+} // namespace epanet
+} // namespace bevarmejo
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <array>
+#include <bitset>
+#include <cstddef>
+#include <initializer_list>
+
+namespace bevarmejo::epanet {
+
+// Declares which hydraulic results must be retrieved from EPANET and stored in
+// the elements during a simulation, per element type and per quantity.
+// Quantities that are not recorded are neither retrieved nor committed, so
+// their series stay empty and any attempt to read them fails loudly.
+class ResultsProfile final
+{
+/*------- Member types -------*/
+public:
+    enum class Element : std::size_t
+    {
+        Junction,
+        Reservoir,
+        Tank,
+        Pipe,
+        Pump,
+        Count
+    };
+
+    enum class Quantity : std::size_t
+    {
+        Head,           // Nodes (source elevation for reservoirs and tanks)
+        Pressure,       // Nodes
+        Outflow,        // Nodes
+        Demand,         // Junctions (demand, consumption and undelivered demand)
+        Inflow,         // Reservoirs and tanks
+        Level,          // Tanks
+        Volume,         // Tanks
+        Flow,           // Links
+        Velocity,       // Pipes
+        Energy,         // Pumps
+        State,          // Pumps
+        Efficiency,     // Pumps
+        Count
+    };
+
+private:
+    using Quantities = std::bitset<static_cast<std::size_t>(Quantity::Count)>;
+
+/*------- Member objects -------*/
+private:
+    std::array<Quantities, static_cast<std::size_t>(Element::Count)> m__quantities;
+
+/*------- Member functions -------*/
+// (constructor)
+public:
+    // Default profile records everything, as it was before profiles existed.
+    ResultsProfile();
+    ResultsProfile(const ResultsProfile&) = default;
+    ResultsProfile(ResultsProfile&&) noexcept = default;
+
+    static auto all() -> ResultsProfile;
+    static auto none() -> ResultsProfile;
+
+// (destructor)
+public:
+    ~ResultsProfile() = default;
+
+// operator=
+public:
+    ResultsProfile& operator=(const ResultsProfile&) = default;
+    ResultsProfile& operator=(ResultsProfile&&) noexcept = default;
+
+/*------- Element access -------*/
+public:
+    auto records(Element a_element, Quantity a_quantity) const noexcept -> bool;
+    // Same as above, but with the type code of the wds element (TypeTraits<T>::code).
+    auto records(unsigned int a_type_code, Quantity a_quantity) const noexcept -> bool;
+
+    // True if at least one element type records the quantity.
+    auto any(Quantity a_quantity) const noexcept -> bool;
+
+    // True if nothing is recorded (as none()).
+    auto empty() const noexcept -> bool;
+
+/*------- Modifiers -------*/
+public:
+    // Record the quantities for the element type. The demands of the junctions
+    // are split using head and outflow, so these are recorded too.
+    auto record(Element a_element, std::initializer_list<Quantity> a_quantities) -> ResultsProfile&;
+
+    // Record also everything recorded by the other profile.
+    auto merge(const ResultsProfile& a_other) -> ResultsProfile&;
+
+}; // class ResultsProfile
+
+} // namespace bevarmejo::epanet
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <algorithm>
 #include <cassert>
 #include <cstddef>
 #include <initializer_list>
@@ -620,13 +621,31 @@ public:
         if (time__s == 0)
             return 0;
 
-        size_type pos = 0;
-        while (pos < m__time_steps.size() ) {
-            if (m__time_steps[pos] == time__s)
-                return pos+1;
-            ++pos;
+        if (m__time_steps.empty() || time__s > m__time_steps.back())
+            return this->size();
+
+        // Position in the container (without the zero), so the position in the
+        // time series is always one more.
+        // 1. The last committed time step is by far the most requested one 
+        // (e.g., elements reading their results during the simulation).
+        if (m__time_steps.back() == time__s)
+            return m__time_steps.size();
+
+        // 2. With a constant step (e.g., the patterns or a simulation without 
+        // intermediate events), the k-th time step is at (k+1)*step.
+        const auto step = m__time_steps.front();
+        if (time__s % step == 0)
+        {
+            const auto guess = static_cast<size_type>(time__s / step) - 1;
+            if (guess < m__time_steps.size() && m__time_steps[guess] == time__s)
+                return guess+1;
         }
 
+        // 3. Otherwise, the time steps are sorted so binary search.
+        auto it = std::lower_bound(m__time_steps.begin(), m__time_steps.end(), time__s);
+        if (it != m__time_steps.end() && *it == time__s)
+            return static_cast<size_type>(it - m__time_steps.begin())+1;
+
         return this->size();
     }
 
@@ -655,14 +674,11 @@ public:
         if (time__s <= 0)
             return this->size();
 
-        size_type pos = 0;
-        while (pos < m__time_steps.size() ) {
-            if (m__time_steps[pos] >= time__s)
-                return pos; // No plus one because I want the first time that is not less than the given time. And the previous is less one, but plus one of the zero.
-            ++pos;
-        }
-
-        return pos; // If I reach the end, the lower bound is the last.   
+        // First time that is not less than the given time. No plus one because the
+        // previous is the one less, but plus one of the zero.
+        // If I reach the end, the lower bound is the last.
+        auto it = std::lower_bound(m__time_steps.begin(), m__time_steps.end(), time__s);
+        return static_cast<size_type>(it - m__time_steps.begin());
     }
             
     // Upper_bound, returns an iterator to the first time that is greater than the given time
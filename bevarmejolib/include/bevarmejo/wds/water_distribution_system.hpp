@@ -162,6 +162,9 @@ public:
 
 // clone()
 public:
+    // Deep copy of the system: a new EPANET project in the same state of this one
+    // (including the elements added or modified at runtime), its own registries,
+    // ID sequences and time series. The results are not copied.
     std::unique_ptr<WaterDistributionSystem> clone() const;
     
 /*------- Element access -------*/
@@ -508,6 +511,12 @@ private:
     void load_EN_links();
     void load_EN_controls();
     void load_EN_rules();
+
+    // Equivalent of clone() for the EPANET project: build a new project through
+    // the API (no file involved) with the same options, components, network,
+    // controls and rules (enabled or not). Limitation: projects with positional
+    // control valves are rejected (std::runtime_error) before anything is built.
+    auto clone_EN_project() const -> EN_Project;
 public:
     // Cache the indices of the elements in the network.
     // This is useful to avoid calling the ENgetnodeindex and ENgetlinkindex functions every time.
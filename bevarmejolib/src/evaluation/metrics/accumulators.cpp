@@ -0,0 +1,312 @@
+#include <algorithm>
+#include <any>
+#include <cassert>
+#include <stdexcept>
+#include <vector>
+
+#include "bevarmejo/utility/exceptions.hpp"
+#include "bevarmejo/constants.hpp"
+#include "bevarmejo/hydraulic_functions.hpp"
+#include "bevarmejo/wds/water_distribution_system.hpp"
+
+#include "bevarmejo/evaluation/metrics/accumulators.hpp"
+
+namespace bevarmejo::eval::metrics
+{
+
+using RP = bevarmejo::epanet::ResultsProfile;
+using NQ = bevarmejo::epanet::ResultsBuffer::NodeQuantity;
+using LQ = bevarmejo::epanet::ResultsBuffer::LinkQuantity;
+
+/*----------------------------------------------------------------------------*/
+/*------- ForwardIntegral -------*/
+auto ForwardIntegral::empty() const noexcept -> bool
+{
+    return m__empty;
+}
+
+auto ForwardIntegral::first() const noexcept -> double
+{
+    return m__first_value;
+}
+
+auto ForwardIntegral::integral() const noexcept -> double
+{
+    return m__integral;
+}
+
+auto ForwardIntegral::duration() const noexcept -> time::Instant
+{
+    return m__last_t - m__first_t;
+}
+
+auto ForwardIntegral::mean() const noexcept -> double
+{
+    return duration() == 0 ? m__last_value : m__integral / duration();
+}
+
+void ForwardIntegral::reset() noexcept
+{
+    *this = ForwardIntegral();
+}
+
+void ForwardIntegral::add(const time::Instant t, const double a_value) noexcept
+{
+    if (m__empty)
+    {
+        m__first_value = a_value;
+        m__first_t = t;
+        m__empty = false;
+    }
+    else
+    {
+        assert(t >= m__last_t);
+        m__integral += m__last_value * (t - m__last_t);
+    }
+
+    m__last_value = a_value;
+    m__last_t = t;
+}
+
+/*----------------------------------------------------------------------------*/
+/*------- OnlinePressureDeficiency -------*/
+OnlinePressureDeficiency::OnlinePressureDeficiency(const double a_min_pressure, const bool a_relative) :
+    m__min_pressure(a_min_pressure),
+    m__relative(a_relative),
+    m__weight(1.0),
+    m__junctions(),
+    m__deficiency()
+{
+    beme_throw_if(m__min_pressure <= 0.0, std::invalid_argument,
+        "Impossible to build the pressure deficiency metric.",
+        "The minimum pressure must be greater than zero.",
+        "Minimum pressure: ", a_min_pressure);
+}
+
+auto OnlinePressureDeficiency::required_results() const -> RP
+{
+    return RP::none().record(RP::Element::Junction, {RP::Quantity::Pressure});
+}
+
+auto OnlinePressureDeficiency::deficiency() const noexcept -> const ForwardIntegral&
+{
+    return m__deficiency;
+}
+
+void OnlinePressureDeficiency::reset(const WaterDistributionSystem& a_wds)
+{
+    m__junctions.clear();
+    m__junctions.reserve(a_wds.n_junctions());
+    for (const auto& [id, junction] : a_wds.junctions())
+        m__junctions.push_back(junction.EN_index());
+
+    m__weight = m__relative ? 1.0/m__min_pressure/m__junctions.size() : 1.0;
+    m__deficiency.reset();
+}
+
+void OnlinePressureDeficiency::accumulate(const WaterDistributionSystem& a_wds, const bevarmejo::epanet::ResultsBuffer& a_results, const time::Instant t)
+{
+    double deficiency = 0.0;
+    for (const auto en_index : m__junctions)
+    {
+        const double pressure = a_results.node(NQ::Pressure, en_index);
+        if (pressure < m__min_pressure)
+            deficiency += (m__min_pressure - pressure)*m__weight;
+    }
+
+    m__deficiency.add(t, deficiency);
+}
+
+auto OnlinePressureDeficiency::save_state() const -> std::any
+{
+    return m__deficiency;
+}
+
+void OnlinePressureDeficiency::restore_state(const std::any& a_state)
+{
+    m__deficiency = std::any_cast<const ForwardIntegral&>(a_state);
+}
+
+/*----------------------------------------------------------------------------*/
+/*------- OnlineResilienceIndex -------*/
+OnlineResilienceIndex::OnlineResilienceIndex(const double a_min_pressure) :
+    m__min_pressure(a_min_pressure),
+    m__junctions(),
+    m__sources(),
+    m__pumps(),
+    m__req_flows_dnodes(),
+    m__heads_dnodes(),
+    m__req_heads_dnodes(),
+    m__flows_sources(),
+    m__heads_sources(),
+    m__powers_pumps(),
+    m__index()
+{ }
+
+auto OnlineResilienceIndex::required_results() const -> RP
+{
+    return RP::none()
+        .record(RP::Element::Junction, {RP::Quantity::Demand})
+        .record(RP::Element::Reservoir, {RP::Quantity::Head, RP::Quantity::Inflow})
+        .record(RP::Element::Tank, {RP::Quantity::Head, RP::Quantity::Inflow})
+        .record(RP::Element::Pump, {RP::Quantity::Energy});
+}
+
+auto OnlineResilienceIndex::index() const noexcept -> const ForwardIntegral&
+{
+    return m__index;
+}
+
+void OnlineResilienceIndex::reset(const WaterDistributionSystem& a_wds)
+{
+    // Same order of resilience_index_from_min_pressure: junctions, then
+    // reservoirs and tanks, then pumps.
+    m__junctions.clear();
+    m__req_heads_dnodes.clear();
+    for (const auto& [id, junction] : a_wds.junctions())
+    {
+        m__junctions.push_back(&junction);
+        m__req_heads_dnodes.push_back(junction.elevation() + m__min_pressure);
+    }
+
+    m__sources.clear();
+    for (const auto& [id, reservoir] : a_wds.reservoirs())
+        m__sources.push_back(reservoir.EN_index());
+    for (const auto& [id, tank] : a_wds.tanks())
+        m__sources.push_back(tank.EN_index());
+
+    m__pumps.clear();
+    for (const auto& [id, pump] : a_wds.pumps())
+        m__pumps.push_back(pump.EN_index());
+
+    m__req_flows_dnodes.resize(m__junctions.size());
+    m__heads_dnodes.resize(m__junctions.size());
+    m__flows_sources.resize(m__sources.size());
+    m__heads_sources.resize(m__sources.size());
+    m__powers_pumps.resize(m__pumps.size());
+
+    m__index.reset();
+}
+
+void OnlineResilienceIndex::accumulate(const WaterDistributionSystem& a_wds, const bevarmejo::epanet::ResultsBuffer& a_results, const time::Instant t)
+{
+    for (std::size_t i = 0; i < m__junctions.size(); ++i)
+    {
+        m__req_flows_dnodes[i] = m__junctions[i]->demand_requested(a_results);
+        m__heads_dnodes[i] = a_results.node(NQ::Head, m__junctions[i]->EN_index());
+    }
+    for (std::size_t i = 0; i < m__sources.size(); ++i)
+    {
+        m__flows_sources[i] = a_results.node(NQ::Outflow, m__sources[i]);
+        m__heads_sources[i] = a_results.node(NQ::Head, m__sources[i]);
+    }
+    for (std::size_t i = 0; i < m__pumps.size(); ++i)
+    {
+        m__powers_pumps[i] = a_results.link(LQ::Energy, m__pumps[i]);
+    }
+
+    m__index.add(t, resilience_index(
+        m__req_flows_dnodes,
+        m__heads_dnodes,
+        m__req_heads_dnodes,
+        m__flows_sources,
+        m__heads_sources,
+        m__powers_pumps
+    ));
+}
+
+auto OnlineResilienceIndex::save_state() const -> std::any
+{
+    return m__index;
+}
+
+void OnlineResilienceIndex::restore_state(const std::any& a_state)
+{
+    m__index = std::any_cast<const ForwardIntegral&>(a_state);
+}
+
+/*----------------------------------------------------------------------------*/
+/*------- OnlineMaxPipeVelocity -------*/
+auto OnlineMaxPipeVelocity::required_results() const -> RP
+{
+    return RP::none().record(RP::Element::Pipe, {RP::Quantity::Velocity});
+}
+
+auto OnlineMaxPipeVelocity::value() const noexcept -> double
+{
+    return m__max_velocity;
+}
+
+void OnlineMaxPipeVelocity::reset(const WaterDistributionSystem& a_wds)
+{
+    m__pipes.clear();
+    m__pipes.reserve(a_wds.n_pipes());
+    for (const auto& [id, pipe] : a_wds.pipes())
+        m__pipes.push_back(pipe.EN_index());
+
+    m__max_velocity = 0.0;
+}
+
+void OnlineMaxPipeVelocity::accumulate(const WaterDistributionSystem& a_wds, const bevarmejo::epanet::ResultsBuffer& a_results, const time::Instant t)
+{
+    for (const auto en_index : m__pipes)
+        m__max_velocity = std::max(m__max_velocity, a_results.link(LQ::Velocity, en_index));
+}
+
+auto OnlineMaxPipeVelocity::save_state() const -> std::any
+{
+    return m__max_velocity;
+}
+
+void OnlineMaxPipeVelocity::restore_state(const std::any& a_state)
+{
+    m__max_velocity = std::any_cast<double>(a_state);
+}
+
+/*----------------------------------------------------------------------------*/
+/*------- OnlinePumpEnergy -------*/
+auto OnlinePumpEnergy::required_results() const -> RP
+{
+    return RP::none().record(RP::Element::Pump, {RP::Quantity::Energy});
+}
+
+auto OnlinePumpEnergy::energy__kWh() const noexcept -> double
+{
+    return m__power.integral()/bevarmejo::k__sec_per_hour;
+}
+
+auto OnlinePumpEnergy::mean_power__kW() const noexcept -> double
+{
+    return m__power.mean();
+}
+
+void OnlinePumpEnergy::reset(const WaterDistributionSystem& a_wds)
+{
+    m__pumps.clear();
+    m__pumps.reserve(a_wds.n_pumps());
+    for (const auto& [id, pump] : a_wds.pumps())
+        m__pumps.push_back(pump.EN_index());
+
+    m__power.reset();
+}
+
+void OnlinePumpEnergy::accumulate(const WaterDistributionSystem& a_wds, const bevarmejo::epanet::ResultsBuffer& a_results, const time::Instant t)
+{
+    double power_kW = 0.0;
+    for (const auto en_index : m__pumps)
+        power_kW += a_results.link(LQ::Energy, en_index);
+
+    m__power.add(t, power_kW);
+}
+
+auto OnlinePumpEnergy::save_state() const -> std::any
+{
+    return m__power;
+}
+
+void OnlinePumpEnergy::restore_state(const std::any& a_state)
+{
+    m__power = std::any_cast<const ForwardIntegral&>(a_state);
+}
+
+} // namespace bevarmejo::eval::metrics
@@ -80,12 +80,22 @@ auto PaezFilion::mechanical_reliability_estimator(const WDS &a_wds) -> wds::aux:
     wds::aux::QuantitySeries<double> mre(a_wds.result_time_series());
     auto n_pipes = a_wds.n_pipes();
 
+    // Closed pipes are not in service (e.g., pre-provisioned duplicates that
+    // were not selected), so their failure doesn't change anything.
+    auto pipes_in_service = std::vector<const WDS::Pipe*>();
+    pipes_in_service.reserve(n_pipes);
+    for (const auto&& [name, pipe] : a_wds.pipes())
+    {
+        if (pipe.initial_status().value() != 0) // 0: EN_CLOSED
+            pipes_in_service.push_back(&pipe);
+    }
+
     // availability of pipes doesn't depend on the simulation so we compute it once
     auto avails = std::vector<double>();
-    avails.reserve(n_pipes);
-    for (const auto&& [name, pipe] : a_wds.pipes())
+    avails.reserve(pipes_in_service.size());
+    for (const auto* p_pipe : pipes_in_service)
     {
-        avails.push_back(CullinaneEtAl::pipe_mechanical_availability(pipe));
+        avails.push_back(CullinaneEtAl::pipe_mechanical_availability(*p_pipe));
     }
 
     auto total_d = eval::metrics::total_water_demand(a_wds);
@@ -93,16 +103,13 @@ auto PaezFilion::mechanical_reliability_estimator(const WDS &a_wds) -> wds::aux:
 
     // The flows change at each time step, but the number of pipes is constant
     // so we pre allocate
-    auto flows = std::vector<double>();
-    flows.reserve(n_pipes);
+    auto flows = std::vector<double>(pipes_in_service.size(), 0.0);
 
     for (const auto t : a_wds.result_time_series())
     {
-        std::size_t i = 0;
-        auto pipes = a_wds.pipes();
-        for (auto it = pipes.begin(); it <pipes.end(); ++i, ++it)
+        for (std::size_t i = 0; i < pipes_in_service.size(); ++i)
         {
-            flows[i] = it->flow().when_t(t);
+            flows[i] = pipes_in_service[i]->flow().when_t(t);
         }
 
         mre.commit(t, 
@@ -0,0 +1,117 @@
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "bevarmejo/io/json.hpp"
+#include "bevarmejo/io/keys/beme.hpp"
+#include "bevarmejo/utility/exceptions.hpp"
+
+#include "coarse_screening.hpp"
+
+namespace bevarmejo {
+
+/*------- Member functions -------*/
+// (constructor)
+CoarseScreening::CoarseScreening(Config a_config) :
+    m__config(std::move(a_config)),
+    m__front(),
+    m__stats()
+{
+    beme_throw_if(m__config.step_multiplier == 0, std::invalid_argument,
+        "Impossible to enable the coarse screening.",
+        "The step multiplier must be greater than zero.");
+
+    std::sort(m__config.margin_schedule.begin(), m__config.margin_schedule.end());
+}
+
+/*------- Element access -------*/
+auto CoarseScreening::config() const noexcept -> const Config&
+{
+    return m__config;
+}
+
+auto CoarseScreening::stats() const noexcept -> const Stats&
+{
+    return m__stats;
+}
+
+auto CoarseScreening::margin() const noexcept -> double
+{
+    const auto n_evals = m__stats.n_coarse.load(std::memory_order_relaxed);
+
+    double margin = m__config.margin;
+    for (const auto& [n_evals_from, scheduled_margin] : m__config.margin_schedule)
+    {
+        if (n_evals < n_evals_from)
+            break;
+        margin = scheduled_margin;
+    }
+    return margin;
+}
+
+/*------- Operations -------*/
+auto CoarseScreening::coarsen(const sim::solvers::epanet::HydSimSettings& a_settings) const -> sim::solvers::epanet::HydSimSettings
+{
+    auto coarse = a_settings;
+    coarse.resolution(a_settings.resolution()*m__config.step_multiplier);
+    coarse.report_resolution(a_settings.report_resolution()*m__config.step_multiplier);
+
+    if (m__config.horizon__s > 0 && m__config.horizon__s < a_settings.horizon())
+        coarse.horizon(m__config.horizon__s);
+
+    return coarse;
+}
+
+auto CoarseScreening::is_promising(const std::vector<double>& a_coarse_fv, const bool a_front_test) const -> bool
+{
+    if (a_coarse_fv.size() < 2)
+        return true;
+
+    const double margin = this->margin();
+    const double cost = a_coarse_fv[0];
+    const double of2 = a_coarse_fv[1];
+
+    // Too far from feasibility.
+    if (of2 > margin)
+        return false;
+
+    if (!a_front_test)
+        return true;
+
+    // Clearly dominated: a candidate of the front is cheaper and better by more than the margin.
+    const auto best_of2 = m__front.best_f1_up_to(cost - margin*std::abs(cost));
+    return !best_of2 || *best_of2 + margin >= of2;
+}
+
+void to_json(Json& j, const CoarseScreening::Config& config)
+{
+    j = Json{};
+    j[io::key::step_multiplier()] = config.step_multiplier;
+    if (config.horizon__s > 0)
+        j[io::key::coarse_horizon()] = config.horizon__s;
+    j[io::key::margin()] = config.margin;
+    if (!config.margin_schedule.empty())
+        j[io::key::margin_schedule()] = config.margin_schedule;
+}
+
+void from_json(const Json& j, CoarseScreening::Config& config)
+{
+    config = CoarseScreening::Config{};
+
+    if (io::key::step_multiplier.exists_in(j))
+        config.step_multiplier = j.at(io::key::step_multiplier.as_in(j)).get<std::size_t>();
+
+    if (io::key::coarse_horizon.exists_in(j))
+        config.horizon__s = j.at(io::key::coarse_horizon.as_in(j)).get<CoarseScreening::time_t>();
+
+    if (io::key::margin.exists_in(j))
+        config.margin = j.at(io::key::margin.as_in(j)).get<double>();
+
+    if (io::key::margin_schedule.exists_in(j))
+        config.margin_schedule = j.at(io::key::margin_schedule.as_in(j)).get<std::vector<std::pair<std::size_t, double>>>();
+}
+
+} // namespace bevarmejo
@@ -0,0 +1,177 @@
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+
+#include "bevarmejo/utility/exceptions.hpp"
+
+#include "fitness_cache.hpp"
+
+namespace bevarmejo {
+
+namespace {
+
+// Finaliser of splitmix64, spreads the bits of the combined hash.
+constexpr auto mix(std::uint64_t x) noexcept -> std::uint64_t
+{
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebULL;
+    x ^= x >> 31;
+    return x;
+}
+
+} // namespace
+
+/*------- Stats -------*/
+auto FitnessCache::Stats::hit_rate() const noexcept -> double
+{
+    const auto n_hits = hits.load(std::memory_order_relaxed);
+    const auto n_lookups = n_hits + misses.load(std::memory_order_relaxed);
+    return n_lookups == 0 ? 0.0 : static_cast<double>(n_hits)/n_lookups;
+}
+
+/*------- Member functions -------*/
+// (constructor)
+FitnessCache::FitnessCache(const std::string& a_problem_key, const std::size_t a_capacity) :
+    m__seed(mix(std::hash<std::string>{}(a_problem_key))),
+    m__capacity(a_capacity),
+    m__stripe_capacity((a_capacity + n_stripes - 1)/n_stripes),
+    m__stripes(),
+    m__stats()
+{
+    beme_throw_if(a_capacity == 0, std::invalid_argument,
+        "Impossible to create the fitness cache.",
+        "The capacity must be greater than zero.");
+}
+
+auto FitnessCache::shared(const std::string& a_problem_key, const std::size_t a_capacity) -> std::shared_ptr<FitnessCache>
+{
+    static std::mutex registry_mutex;
+    static std::unordered_map<std::string, std::weak_ptr<FitnessCache>> registry;
+
+    std::lock_guard<std::mutex> lock(registry_mutex);
+
+    auto& wp_cache = registry[a_problem_key];
+    auto cache = wp_cache.lock();
+    if (cache == nullptr)
+    {
+        cache = std::make_shared<FitnessCache>(a_problem_key, a_capacity);
+        wp_cache = cache;
+    }
+
+    return cache;
+}
+
+/*------- Element access -------*/
+auto FitnessCache::find(const Vector& a_dv) -> std::optional<Vector>
+{
+    const auto h = hash(a_dv);
+    auto& s = stripe(h);
+
+    {
+        std::lock_guard<std::mutex> lock(s.mutex);
+        auto [first, last] = s.index.equal_range(h);
+        for (auto it = first; it != last; ++it)
+        {
+            if (it->second->dv != a_dv)
+                continue;
+
+            s.lru.splice(s.lru.begin(), s.lru, it->second);
+            m__stats.hits.fetch_add(1, std::memory_order_relaxed);
+            return it->second->fv;
+        }
+    }
+
+    m__stats.misses.fetch_add(1, std::memory_order_relaxed);
+    return std::nullopt;
+}
+
+auto FitnessCache::stats() const noexcept -> const Stats&
+{
+    return m__stats;
+}
+
+/*------- Capacity -------*/
+auto FitnessCache::size() const -> std::size_t
+{
+    std::size_t n = 0;
+    for (const auto& s : m__stripes)
+    {
+        std::lock_guard<std::mutex> lock(s.mutex);
+        n += s.lru.size();
+    }
+    return n;
+}
+
+auto FitnessCache::capacity() const noexcept -> std::size_t
+{
+    return m__capacity;
+}
+
+/*------- Modifiers -------*/
+void FitnessCache::insert(const Vector& a_dv, const Vector& a_fv)
+{
+    const auto h = hash(a_dv);
+    auto& s = stripe(h);
+
+    std::lock_guard<std::mutex> lock(s.mutex);
+
+    // Another thread may have evaluated the same individual in the meantime.
+    auto [first, last] = s.index.equal_range(h);
+    for (auto it = first; it != last; ++it)
+    {
+        if (it->second->dv == a_dv)
+        {
+            s.lru.splice(s.lru.begin(), s.lru, it->second);
+            return;
+        }
+    }
+
+    if (s.lru.size() >= m__stripe_capacity)
+    {
+        const auto& oldest = s.lru.back();
+        auto [ofirst, olast] = s.index.equal_range(oldest.hash);
+        for (auto it = ofirst; it != olast; ++it)
+        {
+            if (&*it->second == &oldest)
+            {
+                s.index.erase(it);
+                break;
+            }
+        }
+        s.lru.pop_back();
+    }
+
+    s.lru.push_front(Entry{h, a_dv, a_fv});
+    s.index.emplace(h, s.lru.begin());
+}
+
+auto FitnessCache::hash(const Vector& a_dv) const noexcept -> std::uint64_t
+{
+    std::uint64_t h = m__seed ^ mix(a_dv.size());
+    for (double value : a_dv)
+    {
+        // +0.0 and -0.0 compare equal, so they must hash the same.
+        if (value == 0.0)
+            value = 0.0;
+
+        std::uint64_t bits = 0;
+        std::memcpy(&bits, &value, sizeof(bits));
+        h = mix(h ^ (bits + 0x9e3779b97f4a7c15ULL + (h << 6) + (h >> 2)));
+    }
+    return h;
+}
+
+auto FitnessCache::stripe(const std::uint64_t a_hash) noexcept -> Stripe&
+{
+    return m__stripes[a_hash % n_stripes];
+}
+
+} // namespace bevarmejo
@@ -0,0 +1,71 @@
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+
+#include "pareto_archive.hpp"
+
+namespace bevarmejo {
+
+/*------- Member functions -------*/
+// (constructor)
+auto ParetoArchive::shared(const std::string& a_problem_key) -> std::shared_ptr<ParetoArchive>
+{
+    static std::mutex registry_mutex;
+    static std::unordered_map<std::string, std::weak_ptr<ParetoArchive>> registry;
+
+    std::lock_guard<std::mutex> lock(registry_mutex);
+
+    auto& wp_archive = registry[a_problem_key];
+    auto archive = wp_archive.lock();
+    if (archive == nullptr)
+    {
+        archive = std::make_shared<ParetoArchive>();
+        wp_archive = archive;
+    }
+
+    return archive;
+}
+
+/*------- Element access -------*/
+auto ParetoArchive::best_f1_up_to(double a_f0) const -> std::optional<double>
+{
+    std::lock_guard<std::mutex> lock(m__mutex);
+
+    // The last point with f0 <= a_f0 has the lowest f1 of them all.
+    auto it = m__front.upper_bound(a_f0);
+    if (it == m__front.begin())
+        return std::nullopt;
+
+    return std::prev(it)->second;
+}
+
+/*------- Capacity -------*/
+auto ParetoArchive::size() const -> std::size_t
+{
+    std::lock_guard<std::mutex> lock(m__mutex);
+    return m__front.size();
+}
+
+/*------- Modifiers -------*/
+auto ParetoArchive::insert(double a_f0, double a_f1) -> bool
+{
+    std::lock_guard<std::mutex> lock(m__mutex);
+
+    // Dominated (or equalled) by the best point not more expensive than this one.
+    auto it = m__front.upper_bound(a_f0);
+    if (it != m__front.begin() && std::prev(it)->second <= a_f1)
+        return false;
+
+    // Remove the points it dominates: same or greater f0 and not better f1.
+    it = m__front.lower_bound(a_f0);
+    while (it != m__front.end() && it->second >= a_f1)
+        it = m__front.erase(it);
+
+    m__front.emplace(a_f0, a_f1);
+    return true;
+}
+
+} // namespace bevarmejo
@@ -0,0 +1,510 @@
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <exception>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define BEME_HAS_FORK 1
+#include <poll.h>
+#include <signal.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+#include <pagmo/problem.hpp>
+#include <pagmo/types.hpp>
+
+#include "bevarmejo/io/streams.hpp"
+#include "bevarmejo/utility/exceptions.hpp"
+
+#include "process_pool_bfe.hpp"
+
+namespace bevarmejo {
+
+#if defined(BEME_HAS_FORK)
+
+namespace {
+
+// Reply of a worker: a status followed by the fitness vector (ok) or by the
+// length and the text of the exception (failed).
+enum class ReplyStatus : std::uint32_t
+{
+    ok = 0,
+    failed = 1
+};
+
+// Read or write exactly a_size bytes, false on end of file or error.
+auto read_all(int a_fd, void* a_buf, std::size_t a_size) -> bool
+{
+    auto p = static_cast<char*>(a_buf);
+    while (a_size > 0)
+    {
+        const auto n = ::read(a_fd, p, a_size);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return false;
+        p += n;
+        a_size -= static_cast<std::size_t>(n);
+    }
+    return true;
+}
+
+auto write_all(int a_fd, const void* a_buf, std::size_t a_size) -> bool
+{
+    auto p = static_cast<const char*>(a_buf);
+    while (a_size > 0)
+    {
+        const auto n = ::write(a_fd, p, a_size);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return false;
+        p += n;
+        a_size -= static_cast<std::size_t>(n);
+    }
+    return true;
+}
+
+// Body of a worker process, it never returns.
+[[noreturn]] void serve(const pagmo::problem& a_prob, int a_fd_in, int a_fd_out)
+{
+    const auto n_x = a_prob.get_nx();
+
+    pagmo::vector_double dv(n_x);
+    while (read_all(a_fd_in, dv.data(), n_x*sizeof(double)))
+    {
+        bool sent = false;
+        try
+        {
+            const auto fv = a_prob.fitness(dv);
+
+            const auto status = ReplyStatus::ok;
+            sent = write_all(a_fd_out, &status, sizeof(status)) &&
+                write_all(a_fd_out, fv.data(), fv.size()*sizeof(double));
+        }
+        catch (const std::exception& e)
+        {
+            const auto status = ReplyStatus::failed;
+            const std::string what = e.what();
+            const auto len = static_cast<std::uint32_t>(what.size());
+            sent = write_all(a_fd_out, &status, sizeof(status)) &&
+                write_all(a_fd_out, &len, sizeof(len)) &&
+                write_all(a_fd_out, what.data(), what.size());
+        }
+        if (!sent)
+            break;
+    }
+
+    // Do not run the destructors and the atexit handlers of the parent.
+    std::cout.flush();
+    std::cerr.flush();
+    ::_exit(0);
+}
+
+} // namespace
+
+/*------- Workers -------*/
+class ProcessPoolBFE::Workers final
+{
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Worker
+    {
+        pid_t pid = -1;
+        int to_child = -1;
+        int from_child = -1;
+    };
+
+public:
+    std::atomic<std::size_t> n_failures{0};
+
+private:
+    std::mutex m__mutex; // One batch at a time.
+    std::vector<Worker> m__workers;
+    std::chrono::duration<double> m__timeout;
+    std::string m__prob_name;
+    pagmo::vector_double::size_type m__n_x = 0;
+    pagmo::vector_double::size_type m__n_f = 0;
+
+public:
+    Workers(std::size_t a_n_processes, std::chrono::duration<double> a_timeout) :
+        m__workers(a_n_processes),
+        m__timeout(a_timeout)
+    { }
+
+    Workers(const Workers&) = delete;
+    Workers& operator=(const Workers&) = delete;
+
+    ~Workers()
+    {
+        for (std::size_t w = 0; w < m__workers.size(); ++w)
+            stop(w);
+    }
+
+    auto evaluate(pagmo::problem& a_prob, const pagmo::vector_double& a_dvs) -> pagmo::vector_double
+    {
+        std::lock_guard<std::mutex> lock(m__mutex);
+
+        start(a_prob);
+
+        const auto n_dvs = a_dvs.size()/m__n_x;
+        pagmo::vector_double fvs(n_dvs*m__n_f);
+
+        std::deque<std::size_t> pending;
+        for (std::size_t i = 0; i < n_dvs; ++i)
+            pending.push_back(i);
+
+        std::vector<std::optional<std::size_t>> busy(m__workers.size());
+        std::vector<Clock::time_point> deadlines(m__workers.size());
+        std::size_t n_done = 0;
+        std::vector<pollfd> fds;
+        std::vector<std::size_t> fds_worker;
+
+        while (n_done < n_dvs)
+        {
+            // Hand out the pending decision vectors to the idle workers.
+            for (std::size_t w = 0; w < m__workers.size() && !pending.empty(); ++w)
+            {
+                if (busy[w])
+                    continue;
+
+                const auto i = pending.front();
+                if (!write_all(m__workers[w].to_child, a_dvs.data() + i*m__n_x, m__n_x*sizeof(double)))
+                {
+                    // The worker died while idle, the vector is still pending.
+                    restart(w, a_prob);
+                    continue;
+                }
+                busy[w] = i;
+                deadlines[w] = Clock::now() + std::chrono::duration_cast<Clock::duration>(m__timeout);
+                pending.pop_front();
+            }
+
+            // Wait for at least one reply (or a dead worker), at most until
+            // the first worker runs out of time.
+            fds.clear();
+            fds_worker.clear();
+            auto first_deadline = Clock::time_point::max();
+            for (std::size_t w = 0; w < m__workers.size(); ++w)
+            {
+                if (!busy[w])
+                    continue;
+                fds.push_back(pollfd{m__workers[w].from_child, POLLIN, 0});
+                fds_worker.push_back(w);
+                first_deadline = std::min(first_deadline, deadlines[w]);
+            }
+
+            int n_ready = 0;
+            do {
+                n_ready = ::poll(fds.data(), fds.size(), poll_timeout__ms(first_deadline));
+            } while (n_ready < 0 && errno == EINTR);
+
+            beme_throw_if(n_ready < 0, std::runtime_error,
+                "Impossible to evaluate the batch of decision vectors.",
+                "Waiting for the worker processes failed.",
+                "Errno: ", errno);
+
+            for (std::size_t k = 0; k < fds.size(); ++k)
+            {
+                if (fds[k].revents == 0)
+                    continue;
+
+                const auto w = fds_worker[k];
+                const auto i = *busy[w];
+                busy[w].reset();
+                ++n_done;
+
+                double* fv = fvs.data() + i*m__n_f;
+                if (!receive(w, i, a_dvs, fv))
+                {
+                    fail(i, a_dvs, fv, "Worker process " + std::to_string(m__workers[w].pid) + " " + reap(w) + ".");
+                    restart(w, a_prob);
+                }
+            }
+
+            // A worker that is still busy after the timeout is hung (e.g.,
+            // EPANET not converging or a deadlock), it is treated as a dead one.
+            if (m__timeout <= std::chrono::duration<double>::zero())
+                continue;
+
+            const auto now = Clock::now();
+            for (std::size_t w = 0; w < m__workers.size(); ++w)
+            {
+                if (!busy[w] || deadlines[w] > now)
+                    continue;
+
+                const auto i = *busy[w];
+                busy[w].reset();
+                ++n_done;
+
+                const auto pid = m__workers[w].pid;
+                ::kill(pid, SIGKILL);
+                fail(i, a_dvs, fvs.data() + i*m__n_f,
+                    "Worker process " + std::to_string(pid) + " did not reply within " +
+                    std::to_string(m__timeout.count()) + " s and " + reap(w) + ".");
+                restart(w, a_prob);
+            }
+        }
+
+        // The workers counted the evaluations on their copies of the problem.
+        a_prob.increment_fevals(n_dvs);
+
+        return fvs;
+    }
+
+private:
+    // Timeout of poll() to wake up at the deadline, -1 (forever) without a timeout.
+    auto poll_timeout__ms(const Clock::time_point a_deadline) const -> int
+    {
+        if (m__timeout <= std::chrono::duration<double>::zero())
+            return -1;
+
+        const auto left = std::chrono::ceil<std::chrono::milliseconds>(a_deadline - Clock::now());
+        return static_cast<int>(std::clamp<std::chrono::milliseconds::rep>(left.count(), 0, std::numeric_limits<int>::max()));
+    }
+
+    // (Re)start the workers if they were never started or were started for
+    // another problem.
+    void start(pagmo::problem& a_prob)
+    {
+        if (m__workers.front().pid > 0 &&
+            m__prob_name == a_prob.get_name() &&
+            m__n_x == a_prob.get_nx() &&
+            m__n_f == a_prob.get_nf())
+            return;
+
+        for (std::size_t w = 0; w < m__workers.size(); ++w)
+            stop(w);
+
+        m__prob_name = a_prob.get_name();
+        m__n_x = a_prob.get_nx();
+        m__n_f = a_prob.get_nf();
+
+        // A write to a dead worker must fail with EPIPE, not kill the optimisation.
+        ::signal(SIGPIPE, SIG_IGN);
+
+        for (std::size_t w = 0; w < m__workers.size(); ++w)
+            spawn(w, a_prob);
+    }
+
+    void spawn(std::size_t a_w, pagmo::problem& a_prob)
+    {
+        int in[2];  // parent -> child
+        int out[2]; // child -> parent
+        beme_throw_if(::pipe(in) != 0, std::runtime_error,
+            "Impossible to start the worker process.",
+            "Could not create the pipes.",
+            "Errno: ", errno);
+        if (::pipe(out) != 0)
+        {
+            ::close(in[0]);
+            ::close(in[1]);
+            beme_throw(std::runtime_error,
+                "Impossible to start the worker process.",
+                "Could not create the pipes.",
+                "Errno: ", errno);
+        }
+
+        // Whatever is buffered would be printed by the child too.
+        std::cout.flush();
+        std::cerr.flush();
+        std::fflush(nullptr);
+
+        const pid_t pid = ::fork();
+        if (pid == 0)
+        {
+            // Keep only the pipes of this worker, so that the others see the
+            // end of file when the parent closes their pipes.
+            for (const auto& other : m__workers)
+            {
+                if (other.to_child >= 0)
+                    ::close(other.to_child);
+                if (other.from_child >= 0)
+                    ::close(other.from_child);
+            }
+            ::close(in[1]);
+            ::close(out[0]);
+            serve(a_prob, in[0], out[1]);
+        }
+
+        ::close(in[0]);
+        ::close(out[1]);
+        if (pid < 0)
+        {
+            ::close(in[1]);
+            ::close(out[0]);
+            beme_throw(std::runtime_error,
+                "Impossible to start the worker process.",
+                "The fork failed.",
+                "Errno: ", errno);
+        }
+
+        m__workers[a_w] = Worker{pid, in[1], out[0]};
+    }
+
+    void stop(std::size_t a_w)
+    {
+        auto& worker = m__workers[a_w];
+        if (worker.to_child >= 0)
+            ::close(worker.to_child); // The worker exits at the end of file.
+        if (worker.from_child >= 0)
+            ::close(worker.from_child);
+        if (worker.pid > 0)
+        {
+            int status = 0;
+            while (::waitpid(worker.pid, &status, 0) < 0 && errno == EINTR) { }
+        }
+        worker = Worker{};
+    }
+
+    void restart(std::size_t a_w, pagmo::problem& a_prob)
+    {
+        stop(a_w);
+        spawn(a_w, a_prob);
+    }
+
+    // Wait for a dead worker and describe how it ended.
+    auto reap(std::size_t a_w) -> std::string
+    {
+        auto& worker = m__workers[a_w];
+        ::close(worker.to_child);
+        worker.to_child = -1;
+
+        int status = 0;
+        pid_t res = 0;
+        while ((res = ::waitpid(worker.pid, &status, 0)) < 0 && errno == EINTR) { }
+        worker.pid = -1;
+
+        if (res > 0 && WIFSIGNALED(status))
+            return "was killed by signal " + std::to_string(WTERMSIG(status));
+        if (res > 0 && WIFEXITED(status))
+            return "exited with status " + std::to_string(WEXITSTATUS(status));
+        return "stopped replying";
+    }
+
+    // Read the reply of the worker, false if the worker died.
+    auto receive(std::size_t a_w, std::size_t a_i, const pagmo::vector_double& a_dvs, double* a_fv) -> bool
+    {
+        const int fd = m__workers[a_w].from_child;
+
+        ReplyStatus status;
+        if (!read_all(fd, &status, sizeof(status)))
+            return false;
+
+        if (status == ReplyStatus::ok)
+            return read_all(fd, a_fv, m__n_f*sizeof(double));
+
+        std::uint32_t len = 0;
+        if (!read_all(fd, &len, sizeof(len)))
+            return false;
+        std::string what(len, '\0');
+        if (!read_all(fd, what.data(), len))
+            return false;
+
+        fail(a_i, a_dvs, a_fv, "The fitness threw an exception: " + what);
+        return true;
+    }
+
+    void fail(std::size_t a_i, const pagmo::vector_double& a_dvs, double* a_fv, const std::string& a_reason)
+    {
+        n_failures.fetch_add(1, std::memory_order_relaxed);
+
+        const pagmo::vector_double dv(a_dvs.begin() + a_i*m__n_x, a_dvs.begin() + (a_i+1)*m__n_x);
+        bevarmejo::io::stream_out(std::cerr,
+            "Evaluation of a decision vector failed in the process pool.\n",
+            a_reason, "\n",
+            "Decision vector: ", dv, "\n"
+        );
+
+        for (std::size_t k = 0; k < m__n_f; ++k)
+            a_fv[k] = std::numeric_limits<double>::max();
+    }
+
+}; // class ProcessPoolBFE::Workers
+
+#else // !BEME_HAS_FORK
+
+class ProcessPoolBFE::Workers final
+{
+public:
+    std::atomic<std::size_t> n_failures{0};
+
+    Workers(std::size_t, std::chrono::duration<double>)
+    {
+        beme_throw(std::runtime_error,
+            "Impossible to create the process pool.",
+            "Worker processes are only available on POSIX systems.");
+    }
+
+    auto evaluate(pagmo::problem&, const pagmo::vector_double&) -> pagmo::vector_double
+    {
+        return {};
+    }
+};
+
+#endif // BEME_HAS_FORK
+
+/*------- Member functions -------*/
+// (constructor)
+ProcessPoolBFE::ProcessPoolBFE() :
+    ProcessPoolBFE(0)
+{ }
+
+ProcessPoolBFE::ProcessPoolBFE(std::size_t a_n_processes, double a_timeout__s) :
+    m__n_processes(a_n_processes > 0 ? a_n_processes : std::max(1u, std::thread::hardware_concurrency())),
+    m__timeout(a_timeout__s > 0.0 ? a_timeout__s : 0.0),
+    m__workers(std::make_shared<Workers>(m__n_processes, m__timeout))
+{ }
+
+/*------- Element access -------*/
+auto ProcessPoolBFE::n_processes() const noexcept -> std::size_t
+{
+    return m__n_processes;
+}
+
+auto ProcessPoolBFE::timeout__s() const noexcept -> double
+{
+    return m__timeout.count();
+}
+
+auto ProcessPoolBFE::n_failures() const noexcept -> std::size_t
+{
+    return m__workers->n_failures.load(std::memory_order_relaxed);
+}
+
+auto ProcessPoolBFE::get_name() const -> std::string
+{
+    return "bevarmejo::process_pool_bfe";
+}
+
+auto ProcessPoolBFE::get_extra_info() const -> std::string
+{
+    return "\tProcesses: " + std::to_string(n_processes()) + "\n" +
+        "\tTimeout [s]: " + std::to_string(timeout__s()) + "\n" +
+        "\tFailed evaluations: " + std::to_string(n_failures()) + "\n";
+}
+
+/*------- Operations -------*/
+auto ProcessPoolBFE::operator()(pagmo::problem& a_prob, const pagmo::vector_double& a_dvs) const -> pagmo::vector_double
+{
+    return m__workers->evaluate(a_prob, a_dvs);
+}
+
+} // namespace bevarmejo
@@ -0,0 +1,248 @@
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "bevarmejo/io/json.hpp"
+#include "bevarmejo/io/keys/beme.hpp"
+#include "bevarmejo/utility/exceptions.hpp"
+
+#include "surrogate.hpp"
+
+namespace bevarmejo {
+
+namespace {
+
+// Finaliser of splitmix64, spreads the bits of the combined hash.
+constexpr auto mix(std::uint64_t x) noexcept -> std::uint64_t
+{
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebULL;
+    x ^= x >> 31;
+    return x;
+}
+
+auto is_failed(const std::vector<double>& a_fv) noexcept -> bool
+{
+    return std::any_of(a_fv.begin(), a_fv.end(), [](double v) {
+        return !std::isfinite(v) || v == std::numeric_limits<double>::max();
+    });
+}
+
+} // namespace
+
+/*------- Member functions -------*/
+// (constructor)
+Surrogate::Surrogate(Config a_config) :
+    m__config(std::move(a_config)),
+    m__mutex(),
+    m__samples(),
+    m__next(0),
+    m__dv_min(),
+    m__dv_max(),
+    m__front(),
+    m__stats()
+{
+    beme_throw_if(m__config.n_neighbours == 0 || m__config.capacity < m__config.n_neighbours, std::invalid_argument,
+        "Impossible to enable the surrogate.",
+        "The number of neighbours must be greater than zero and not greater than the capacity.",
+        "Neighbours: ", m__config.n_neighbours, " Capacity: ", m__config.capacity);
+
+    m__config.min_samples = std::max(m__config.min_samples, m__config.n_neighbours);
+    m__samples.reserve(m__config.capacity);
+}
+
+/*------- Element access -------*/
+auto Surrogate::config() const noexcept -> const Config&
+{
+    return m__config;
+}
+
+auto Surrogate::stats() const noexcept -> const Stats&
+{
+    return m__stats;
+}
+
+auto Surrogate::predict(const Vector& a_dv) const -> std::optional<Prediction>
+{
+    std::shared_lock<std::shared_mutex> lock(m__mutex);
+
+    if (m__samples.size() < m__config.min_samples)
+        return std::nullopt;
+
+    // Squared distance, each variable scaled by its range over the samples.
+    std::vector<std::pair<double, std::size_t>> dists;
+    dists.reserve(m__samples.size());
+    for (std::size_t s = 0; s < m__samples.size(); ++s)
+    {
+        const auto& dv = m__samples[s].first;
+        if (dv.size() != a_dv.size())
+            continue;
+
+        double d = 0.0;
+        for (std::size_t i = 0; i < dv.size(); ++i)
+        {
+            const double range = m__dv_max[i] - m__dv_min[i];
+            if (range <= 0.0)
+                continue;
+            const double delta = (dv[i] - a_dv[i])/range;
+            d += delta*delta;
+        }
+        dists.emplace_back(d, s);
+    }
+
+    if (dists.size() < m__config.n_neighbours)
+        return std::nullopt;
+
+    const auto k = m__config.n_neighbours;
+    std::partial_sort(dists.begin(), dists.begin() + k, dists.end());
+
+    const auto n_f = m__samples[dists.front().second].second.size();
+    Prediction prediction{Vector(n_f, 0.0), Vector(n_f, 0.0)};
+
+    // A candidate already simulated is known exactly.
+    if (dists.front().first == 0.0)
+    {
+        prediction.mean = m__samples[dists.front().second].second;
+        return prediction;
+    }
+
+    for (std::size_t n = 0; n < k; ++n)
+    {
+        const auto& fv = m__samples[dists[n].second].second;
+        for (std::size_t j = 0; j < n_f; ++j)
+            prediction.mean[j] += fv[j]/k;
+    }
+    for (std::size_t n = 0; n < k; ++n)
+    {
+        const auto& fv = m__samples[dists[n].second].second;
+        for (std::size_t j = 0; j < n_f; ++j)
+            prediction.spread[j] += (fv[j] - prediction.mean[j])*(fv[j] - prediction.mean[j])/k;
+    }
+    for (auto& spread : prediction.spread)
+        spread = std::sqrt(spread);
+
+    return prediction;
+}
+
+/*------- Capacity -------*/
+auto Surrogate::size() const -> std::size_t
+{
+    std::shared_lock<std::shared_mutex> lock(m__mutex);
+    return m__samples.size();
+}
+
+/*------- Modifiers -------*/
+void Surrogate::train(const Vector& a_dv, const Vector& a_fv)
+{
+    if (is_failed(a_fv))
+        return;
+
+    if (a_fv.size() >= 2)
+        m__front.insert(a_fv[0], a_fv[1]);
+
+    std::unique_lock<std::shared_mutex> lock(m__mutex);
+
+    if (m__dv_min.empty())
+    {
+        m__dv_min = a_dv;
+        m__dv_max = a_dv;
+    }
+    for (std::size_t i = 0; i < a_dv.size() && i < m__dv_min.size(); ++i)
+    {
+        m__dv_min[i] = std::min(m__dv_min[i], a_dv[i]);
+        m__dv_max[i] = std::max(m__dv_max[i], a_dv[i]);
+    }
+
+    if (m__samples.size() < m__config.capacity)
+    {
+        m__samples.emplace_back(a_dv, a_fv);
+        return;
+    }
+
+    m__samples[m__next] = {a_dv, a_fv};
+    m__next = (m__next + 1) % m__config.capacity;
+}
+
+/*------- Operations -------*/
+auto Surrogate::explores(const Vector& a_dv) const noexcept -> bool
+{
+    std::uint64_t h = mix(m__config.seed ^ a_dv.size());
+    for (double value : a_dv)
+    {
+        if (value == 0.0)
+            value = 0.0;
+
+        std::uint64_t bits = 0;
+        std::memcpy(&bits, &value, sizeof(bits));
+        h = mix(h ^ (bits + 0x9e3779b97f4a7c15ULL + (h << 6) + (h >> 2)));
+    }
+
+    // Top 53 bits as a uniform number in [0, 1).
+    const double u = static_cast<double>(h >> 11)*0x1.0p-53;
+    return u < m__config.exploration;
+}
+
+auto Surrogate::is_discarded(const Prediction& a_prediction) const -> bool
+{
+    if (a_prediction.mean.size() < 2)
+        return false;
+
+    // Most optimistic values of the candidate within the confidence.
+    const double of1 = a_prediction.mean[0] - m__config.confidence*a_prediction.spread[0];
+    const double of2 = a_prediction.mean[1] - m__config.confidence*a_prediction.spread[1];
+
+    // Confidently infeasible.
+    if (of2 > 0.0)
+        return true;
+
+    // Confidently dominated.
+    const auto best_of2 = m__front.best_f1_up_to(of1);
+    return best_of2 && *best_of2 < of2;
+}
+
+void to_json(Json& j, const Surrogate::Config& config)
+{
+    j = Json{};
+    j[io::key::n_neighbours()] = config.n_neighbours;
+    j[io::key::min_samples()] = config.min_samples;
+    j[io::key::capacity()] = config.capacity;
+    j[io::key::exploration()] = config.exploration;
+    j[io::key::confidence()] = config.confidence;
+    j[io::key::exploration_seed()] = config.seed;
+}
+
+void from_json(const Json& j, Surrogate::Config& config)
+{
+    config = Surrogate::Config{};
+
+    if (io::key::n_neighbours.exists_in(j))
+        config.n_neighbours = j.at(io::key::n_neighbours.as_in(j)).get<std::size_t>();
+
+    if (io::key::min_samples.exists_in(j))
+        config.min_samples = j.at(io::key::min_samples.as_in(j)).get<std::size_t>();
+
+    if (io::key::capacity.exists_in(j))
+        config.capacity = j.at(io::key::capacity.as_in(j)).get<std::size_t>();
+
+    if (io::key::exploration.exists_in(j))
+        config.exploration = j.at(io::key::exploration.as_in(j)).get<double>();
+
+    if (io::key::confidence.exists_in(j))
+        config.confidence = j.at(io::key::confidence.as_in(j)).get<double>();
+
+    if (io::key::exploration_seed.exists_in(j))
+        config.seed = j.at(io::key::exploration_seed.as_in(j)).get<std::uint64_t>();
+}
+
+} // namespace bevarmejo
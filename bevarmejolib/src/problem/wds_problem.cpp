@@ -1,5 +1,8 @@
+#include <atomic>
+#include <chrono>
 #include <string>
 #include <memory>
+#include <utility>
 
 #include "wds_problem.hpp"
 
@@ -10,7 +13,14 @@ WDSProblem::WDSProblem() :
     m__extra_info(""),
     m__dv_adapter(),
     m__inp_base_filename(),
-    m__metrics_filename()
+    m__metrics_filename(),
+    m__replicas(),
+    m__fitness_cache(),
+    m__fitness_cache_stats(),
+    m__coarse_screening(),
+    m__surrogate(),
+    m__eval_budget(),
+    m__n_timeouts()
     { }
 
 WDSProblem::WDSProblem(const std::string& name, const std::string& extra_info) : 
@@ -18,12 +28,29 @@ WDSProblem::WDSProblem(const std::string& name, const std::string& extra_info) :
     m__extra_info(extra_info),
     m__dv_adapter(),
     m__inp_base_filename(),
-    m__metrics_filename()
+    m__metrics_filename(),
+    m__replicas(),
+    m__fitness_cache(),
+    m__fitness_cache_stats(),
+    m__coarse_screening(),
+    m__surrogate(),
+    m__eval_budget(),
+    m__n_timeouts()
     { }
 
 std::string WDSProblem::get_name() const { return m__name; }
 
-std::string WDSProblem::get_extra_info() const { return m__extra_info; }
+std::string WDSProblem::get_extra_info() const
+{
+    if (m__surrogate == nullptr)
+        return m__extra_info;
+
+    const auto& stats = m__surrogate->stats();
+    return m__extra_info +
+        "\n\tSurrogate: " + std::to_string(stats.n_replaced.load(std::memory_order_relaxed)) +
+        " of " + std::to_string(stats.n_queries.load(std::memory_order_relaxed)) +
+        " evaluations replaced by the prediction.\n";
+}
 
 auto WDSProblem::get_nx() const -> std::vector<double>::size_type {
     return this->get_bounds().first.size();
@@ -78,4 +105,102 @@ auto WDSProblem::disable_save_metrics() noexcept -> WDSProblem&
     return *this;
 }
 
+auto WDSProblem::enable_fitness_cache(
+    const std::string& a_problem_key,
+    std::size_t a_capacity
+) -> WDSProblem&
+{
+    if (a_capacity == 0) {
+        return this->disable_fitness_cache();
+    }
+    m__fitness_cache = FitnessCache::shared(a_problem_key, a_capacity);
+    m__fitness_cache_stats = std::make_shared<FitnessCache::Stats>();
+    return *this;
+}
+
+auto WDSProblem::disable_fitness_cache() noexcept -> WDSProblem&
+{
+    m__fitness_cache.reset();
+    m__fitness_cache_stats.reset();
+    return *this;
+}
+
+auto WDSProblem::fitness_cache() const noexcept -> const FitnessCache*
+{
+    return m__fitness_cache.get();
+}
+
+auto WDSProblem::fitness_cache_stats() const noexcept -> const FitnessCache::Stats*
+{
+    return m__fitness_cache_stats.get();
+}
+
+auto WDSProblem::enable_coarse_screening(
+    CoarseScreening::Config a_config
+) -> WDSProblem&
+{
+    m__coarse_screening = std::make_shared<CoarseScreening>(std::move(a_config));
+    return *this;
+}
+
+auto WDSProblem::disable_coarse_screening() noexcept -> WDSProblem&
+{
+    m__coarse_screening.reset();
+    return *this;
+}
+
+auto WDSProblem::coarse_screening() const noexcept -> const CoarseScreening*
+{
+    return m__coarse_screening.get();
+}
+
+auto WDSProblem::enable_surrogate(
+    Surrogate::Config a_config
+) -> WDSProblem&
+{
+    m__surrogate = std::make_shared<Surrogate>(std::move(a_config));
+    return *this;
+}
+
+auto WDSProblem::disable_surrogate() noexcept -> WDSProblem&
+{
+    m__surrogate.reset();
+    return *this;
+}
+
+auto WDSProblem::surrogate() const noexcept -> const Surrogate*
+{
+    return m__surrogate.get();
+}
+
+auto WDSProblem::enable_eval_budget(
+    double a_budget__s
+) -> WDSProblem&
+{
+    if (a_budget__s <= 0.0) {
+        return this->disable_eval_budget();
+    }
+    m__eval_budget = std::chrono::duration_cast<sim::solvers::epanet::DeadlineScope::Clock::duration>(
+        std::chrono::duration<double>(a_budget__s));
+    m__n_timeouts = std::make_shared<std::atomic<std::size_t>>(0);
+    return *this;
+}
+
+auto WDSProblem::disable_eval_budget() noexcept -> WDSProblem&
+{
+    m__eval_budget = sim::solvers::epanet::DeadlineScope::Clock::duration::zero();
+    m__n_timeouts.reset();
+    return *this;
+}
+
+auto WDSProblem::eval_budget__s() const noexcept -> double
+{
+    return std::chrono::duration<double>(m__eval_budget).count();
+}
+
+auto WDSProblem::n_timeouts() const noexcept -> std::size_t
+{
+    return m__n_timeouts ? m__n_timeouts->load(std::memory_order_relaxed) : 0;
+}
+
 } // namespace bevarmejo
@@ -0,0 +1,136 @@
+#include <cassert>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "bevarmejo/utility/exceptions.hpp"
+#include "bevarmejo/wds/water_distribution_system.hpp"
+#include "bevarmejo/simulation/solvers/epanet/hydraulic.hpp"
+
+#include "wds_replica_pool.hpp"
+
+namespace bevarmejo {
+
+/*------- Lease -------*/
+WDSReplicaPool::Lease::Lease(Slot& a_slot) noexcept :
+    m__slot(&a_slot)
+{
+    m__slot->in_use = true;
+}
+
+WDSReplicaPool::Lease::Lease(Lease&& other) noexcept :
+    m__slot(other.m__slot)
+{
+    other.m__slot = nullptr;
+}
+
+WDSReplicaPool::Lease::~Lease()
+{
+    if (m__slot != nullptr)
+        m__slot->in_use = false;
+}
+
+auto WDSReplicaPool::Lease::operator*() const noexcept -> WDS&
+{
+    return *m__slot->wds;
+}
+
+auto WDSReplicaPool::Lease::operator->() const noexcept -> WDS*
+{
+    return m__slot->wds.get();
+}
+
+auto WDSReplicaPool::Lease::get() const noexcept -> WDS&
+{
+    return *m__slot->wds;
+}
+
+auto WDSReplicaPool::Lease::session() const -> sim::solvers::epanet::HydSimSession&
+{
+    if (m__slot->session == nullptr)
+        m__slot->session = std::make_unique<sim::solvers::epanet::HydSimSession>(*m__slot->wds);
+
+    return *m__slot->session;
+}
+
+auto WDSReplicaPool::Lease::applied_dv() const noexcept -> std::vector<double>&
+{
+    return m__slot->applied_dv;
+}
+
+/*------- Member functions -------*/
+// (constructor)
+WDSReplicaPool::WDSReplicaPool(Factory a_factory) :
+    m__factory(std::move(a_factory)),
+    m__mutex(),
+    m__slots()
+{
+    beme_throw_if(!m__factory, std::invalid_argument,
+        "Impossible to create the pool of replicas.",
+        "The factory function is empty.");
+}
+
+/*------- Element access -------*/
+auto WDSReplicaPool::lease() -> Lease
+{
+    const auto tid = std::this_thread::get_id();
+
+    {
+        std::lock_guard<std::mutex> lock(m__mutex);
+        auto it = m__slots.find(tid);
+        if (it != m__slots.end())
+        {
+            // The slot of a thread is only used by that thread, so if it is
+            // busy the thread is trying to lease twice (e.g., nested fitness).
+            beme_throw_if(it->second.in_use, std::logic_error,
+                "Impossible to lease the replica.",
+                "The replica of this thread is already in use.");
+
+            return Lease(it->second);
+        }
+    }
+
+    // Building a network is expensive, so do it without holding the lock.
+    // No other thread will ever look for this thread id, so there is no race.
+    auto replica = m__factory();
+    assert(replica != nullptr);
+
+    std::lock_guard<std::mutex> lock(m__mutex);
+    // Elements of an unordered_map are not moved by a rehash, so the
+    // reference stays valid after other threads insert their slots.
+    auto& slot = m__slots[tid];
+    slot.wds = std::move(replica);
+
+    return Lease(slot);
+}
+
+/*------- Capacity -------*/
+auto WDSReplicaPool::size() const -> std::size_t
+{
+    std::lock_guard<std::mutex> lock(m__mutex);
+    return m__slots.size();
+}
+
+/*------- Factories -------*/
+auto WDSReplicaPool::replicate(std::shared_ptr<const WDS> a_prototype) -> Factory
+{
+    beme_throw_if(a_prototype == nullptr, std::invalid_argument,
+        "Impossible to create the factory of replicas.",
+        "The prototype network is empty.");
+
+    // Replicas are built lazily from many threads, but they all read the same
+    // EPANET project of the prototype, so one clone at a time.
+    auto p_mutex = std::make_shared<std::mutex>();
+
+    return [prototype = std::move(a_prototype), p_mutex]() -> std::unique_ptr<WDS>
+    {
+        std::lock_guard<std::mutex> lock(*p_mutex);
+        return prototype->clone();
+    };
+}
+
+} // namespace bevarmejo
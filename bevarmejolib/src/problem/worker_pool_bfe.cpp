@@ -0,0 +1,88 @@
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <optional>
+#include <string>
+
+#include <pagmo/problem.hpp>
+#include <pagmo/threading.hpp>
+#include <pagmo/types.hpp>
+
+#include "bevarmejo/utility/worker_pool.hpp"
+
+#include "worker_pool_bfe.hpp"
+
+namespace bevarmejo {
+
+namespace {
+
+// Chunks per worker, a few more than one to balance the individuals that
+// fail early with the ones that are simulated until the end.
+constexpr std::size_t k__chunks_per_worker = 4;
+
+} // namespace
+
+/*------- Member functions -------*/
+// (constructor)
+WorkerPoolBFE::WorkerPoolBFE() :
+    WorkerPoolBFE(0)
+{ }
+
+WorkerPoolBFE::WorkerPoolBFE(std::size_t a_n_threads) :
+    m__workers(std::make_shared<WorkerPool>(a_n_threads))
+{ }
+
+/*------- Element access -------*/
+auto WorkerPoolBFE::n_threads() const noexcept -> std::size_t
+{
+    return m__workers->size();
+}
+
+auto WorkerPoolBFE::get_name() const -> std::string
+{
+    return "bevarmejo::worker_pool_bfe";
+}
+
+auto WorkerPoolBFE::get_extra_info() const -> std::string
+{
+    return "\tThreads: " + std::to_string(n_threads()) + "\n";
+}
+
+/*------- Operations -------*/
+auto WorkerPoolBFE::operator()(pagmo::problem& a_prob, const pagmo::vector_double& a_dvs) const -> pagmo::vector_double
+{
+    // pagmo::bfe already checked that the batch is made of whole decision vectors.
+    const auto n_x = a_prob.get_nx();
+    const auto n_f = a_prob.get_nf();
+    const auto n_dvs = a_dvs.size()/n_x;
+
+    pagmo::vector_double fvs(n_dvs*n_f);
+
+    // Problems with a basic thread safety (ours, as the pagmo default) can not
+    // be called concurrently, so each chunk works on its own copy. The copies
+    // still share the replicas of the networks and the fitness cache.
+    const bool share_prob = a_prob.get_thread_safety() >= pagmo::thread_safety::constant;
+
+    const auto n_chunks = std::min(n_dvs, n_threads()*k__chunks_per_worker);
+    m__workers->parallel_for(n_chunks, [&](std::size_t c)
+    {
+        std::optional<pagmo::problem> prob_copy;
+        const pagmo::problem& prob = share_prob ? a_prob : prob_copy.emplace(a_prob);
+
+        pagmo::vector_double dv(n_x);
+        for (auto i = c*n_dvs/n_chunks; i < (c+1)*n_dvs/n_chunks; ++i)
+        {
+            std::copy(a_dvs.begin() + i*n_x, a_dvs.begin() + (i+1)*n_x, dv.begin());
+            const auto fv = prob.fitness(dv);
+            std::copy(fv.begin(), fv.end(), fvs.begin() + i*n_f);
+        }
+    });
+
+    // The copies counted their own evaluations, not the problem of the island.
+    if (!share_prob)
+        a_prob.increment_fevals(n_dvs);
+
+    return fvs;
+}
+
+} // namespace bevarmejo
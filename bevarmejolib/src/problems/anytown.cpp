@@ -6,6 +6,7 @@
 
 #include <algorithm>
 #include <iostream>
+#include <limits>
 #include <cmath>
 #include <memory>
 #include <string>
@@ -22,12 +23,14 @@
 #include "bevarmejo/io/aliased_key.hpp"
 #include "bevarmejo/io/fsys.hpp"
 #include "bevarmejo/io/json.hpp"
+#include "bevarmejo/io/keys/beme.hpp"
 #include "bevarmejo/io/labels.hpp"
 #include "bevarmejo/io/streams.hpp"
 namespace bemeio = bevarmejo::io;
 #include "bevarmejo/constants.hpp"
 #include "bevarmejo/econometric_functions.hpp"
 #include "bevarmejo/hydraulic_functions.hpp"
+#include "bevarmejo/evaluation/metrics/accumulators.hpp"
 
 #include "bevarmejo/wds/water_distribution_system.hpp"
 #include "bevarmejo/simulation/solvers/epanet/hydraulic.hpp"
@@ -59,6 +62,9 @@ static constexpr bemeio::AliasedKey max_vel{"Pipe max velocity"}; // "Pipe max v
 static constexpr bemeio::AliasedKey cap_cost{"Additional capital cost"}; // "Additional capital cost"
 static constexpr bemeio::AliasedKey ds_fail_sols{"N ds failed sols"}; // "N ds failed sols"
 static constexpr bemeio::AliasedKey ds_unsat_sols{"N ds unsati sols"}; // "N ds unsati sols" 
+static constexpr bemeio::AliasedKey prov_dup_pipes{"Pre-provisioned duplicates"}; // "Pre-provisioned duplicates"
+static constexpr bemeio::AliasedKey prov_tanks{"Pre-provisioned tanks"}; // "Pre-provisioned tanks"
+static constexpr bemeio::AliasedKey early_abort{"Early abort"}; // "Early abort"
 } // namespace key
 // Values for the allowed formulations in the json file.
 namespace io::value {
@@ -120,10 +126,11 @@ Problem::Problem(
 	m__has_operations(false),
 	m__additional_capital_cost(0.0),
 	m__max_velocity__m_per_s(2.0),
-	__old_HW_coeffs(),
+	m__prov_dup_pipes(false),
+	m__prov_tanks(false),
+	m__early_abort(false),
 	m_algo(),
-	m_pop(),
-	m__cached_metrics()
+	m_pop()
 {
 	if (a_formulation_str == io::value::rehab_f1)
 	{
@@ -295,6 +302,24 @@ Problem::Problem(
 	load_network(settings, lookup_paths);
 
 	load_other_data(settings, lookup_paths);
+
+	// Islands built from the same settings share the fitness already evaluated.
+	if (bemeio::key::fitness_cache.exists_in(settings)) {
+		enable_fitness_cache(
+			m__name + settings.dump(),
+			settings.at(bemeio::key::fitness_cache.as_in(settings)).get<std::size_t>()
+		);
+	}
+
+	// Optional: give up the evaluations that take longer than this many seconds.
+	if (bemeio::key::eval_budget.exists_in(settings)) {
+		enable_eval_budget(settings.at(bemeio::key::eval_budget.as_in(settings)).get<double>());
+	}
+
+	// Optional: skip the candidates a surrogate predicts to be infeasible or dominated.
+	if (bemeio::key::surrogate.exists_in(settings)) {
+		enable_surrogate(settings.at(bemeio::key::surrogate.as_in(settings)).get<Surrogate::Config>());
+	}
 	
 	// We have "configured" the formulations for the various parts, we can pass this info to the adapter
 	m__dv_adapter.reconfigure(this->get_continuous_dvs_mask());
@@ -371,8 +396,12 @@ void Problem::load_network(const Json& settings, const bemeio::Paths& lookup_pat
 		m__formulation != Formulation::opertns_f2
 	) {
 		m__anytown->submit_id_sequence(label::__temp_elems);
+		m__anytown->submit_id_sequence(label::__prov_elems);
 	}
 
+	// The fitness is evaluated on per-thread replicas, m__anytown is only the prototype.
+	m__replicas = std::make_shared<WDSReplicaPool>(WDSReplicaPool::replicate(m__anytown));
+
 	// Prepare the simulation settings.
 	long h_step = 0;
     int errorcode = EN_gettimeparam(m__anytown->ph(), EN_HYDSTEP, &h_step);
@@ -388,6 +417,17 @@ void Problem::load_network(const Json& settings, const bemeio::Paths& lookup_pat
     assert(errorcode < 100);
 
     m__eps_settings.report_resolution(r_step);
+
+    // Record only what the objectives read: resilience index and pressure
+    // deficiency (fr1, fr3), velocities (fr2) and pump energy (cost).
+    using RP = bevarmejo::epanet::ResultsProfile;
+    m__eps_settings.results_profile(RP::none()
+        .record(RP::Element::Junction, {RP::Quantity::Pressure, RP::Quantity::Demand})
+        .record(RP::Element::Reservoir, {RP::Quantity::Head, RP::Quantity::Inflow})
+        .record(RP::Element::Tank, {RP::Quantity::Head, RP::Quantity::Inflow})
+        .record(RP::Element::Pipe, {RP::Quantity::Velocity})
+        .record(RP::Element::Pump, {RP::Quantity::Energy})
+    );
 }
 
 void Problem::load_other_data(const Json& settings, const bemeio::Paths& lookup_paths) {
@@ -489,6 +529,47 @@ void Problem::load_other_data(const Json& settings, const bemeio::Paths& lookup_
 		m__ds_unsati_sols = settings[io::key::ds_unsat_sols.as_in(settings)];
 	}
 
+	if (io::key::prov_dup_pipes.exists_in(settings)) {
+		m__prov_dup_pipes = settings[io::key::prov_dup_pipes.as_in(settings)];
+	}
+
+	if (io::key::prov_tanks.exists_in(settings)) {
+		m__prov_tanks = settings[io::key::prov_tanks.as_in(settings)];
+	}
+
+	// Optional: stop the EPS as soon as the solution is going to be penalised.
+	// Only the hierarchical objective has a penalty band decided by the first
+	// violation, the base one weighs the deficit against the reliability.
+	if (io::key::early_abort.exists_in(settings)) {
+		m__early_abort = settings[io::key::early_abort.as_in(settings)];
+
+		beme_throw_if(m__early_abort &&
+			m__reliability_obj_func_formulation != ReliabilityObjectiveFunctionFormulation::Hierarchical,
+			std::invalid_argument,
+			"Impossible to construct the Anytown Problem.",
+			"The early abort is only available with the hierarchical reliability objective.",
+			"Formulation: ", m__name);
+	}
+
+	// Install the duplicates and the tank slots in the prototype, so that every replica has them.
+	if (m__prov_dup_pipes && m__has_design) {
+		fep::provision__dup_pipes(*m__anytown);
+	}
+	if (m__prov_tanks && m__has_design) {
+		fnt::provision__tanks(*m__anytown);
+	}
+
+	// Roughness of the existing pipes as loaded, to restore the cleaned pipes
+	// of a replica whatever was applied to it.
+	if (m__has_design) {
+		for (auto&& [id, pipe] : m__anytown->subnetwork_with_order<WDS::Pipe>(exis_pipes__subnet_name)) {
+			m__exis_pipes_HW_coeffs.emplace(id, pipe.roughness().value());
+		}
+
+		// The pipe options are final here, so the costs can be compiled.
+		m__pipes_cost_plan = compile__pipes_cost_plan(*m__anytown, m__exi_pipe_options, m__new_pipe_options);
+	}
+
 	if (m__formulation == Formulation::twoph_f1) {
 		/*
 		// Prepare the internal optimization problem 
@@ -656,16 +737,38 @@ auto Problem::get_continuous_dvs_mask() const -> std::vector<bool>
 auto Problem::fitness(
 	const std::vector<double>& pagmo_dv
 ) const -> std::vector<double>
+{
+    // First thing first reconvert back from the pagmo ordering to the beme one.
+	const auto dvs = m__dv_adapter.from_pagmo_to_beme(pagmo_dv);
+
+	return budgeted_fitness(get_nobj()+get_nec()+get_nic(), [this, &dvs]() {
+		return provisional_fitness([this, &dvs]() {
+			return cached_fitness(dvs, [this, &dvs]() {
+				return surrogate_fitness(dvs, [this, &dvs]() { return evaluate(dvs); });
+			});
+		});
+	});
+}
+
+auto Problem::evaluate(
+	const std::vector<double>& dvs
+) const -> std::vector<double>
 {
 	// Let's pre-allocate in case something doesn't work out.
 	std::vector<double> fitv(get_nobj()+get_nec()+get_nic(), std::numeric_limits<double>::max());
 
-    // First thing first reconvert back from the pagmo ordering to the beme one.
-	const auto dvs = m__dv_adapter.from_pagmo_to_beme(pagmo_dv);
+	// Stage 1: analytic checks and terms, no simulation needed. A decision
+	// vector that can not be priced gets the penalty of a failed simulation.
+	if (!is_feasible__analytic(dvs))
+		return std::move(fitv);
+
+	// Apply the changes to the network of this thread, only the genes that
+	// differ from the last individual evaluated on it.
+	// Each thread has its own replica, so fitness can be called concurrently.
+	auto anytown = m__replicas->lease();
+	update_dv(*anytown, anytown.applied_dv(), dvs);
 
-	// For now, instead of creating a copy object, I will just apply the changes to the network and then reset it.
-	// This doesn't allow parallelization unless you have different copies of the problem.
-    apply_dv(dvs);
+	const double capital_cost = this->capital_cost(*anytown, dvs);
 
 	// things to do 
 	// 1. EPS 
@@ -687,8 +790,28 @@ auto Problem::fitness(
 	//			add the emitters and then remove them and repeat for the next condition
 	// 		check min pressure constraint 
 
-	// 1. EPS
-	auto results = sim::solvers::epanet::solve_hydraulics(*m__anytown, m__eps_settings);
+	// Stage 2: EPS, a failure is penalised on both objectives.
+	// With early abort, the EPS stops once the pressure or the velocity
+	// constraint is violated, as the solution is going to be in the penalty
+	// band of the hierarchical objective anyway. The penalty is then computed
+	// on the steps simulated so far.
+	const double min_pressure__m = anytown::min_pressure__psi*MperFT/PSIperFT;
+	auto pressure_deficit = eval::metrics::OnlinePressureDeficiency(min_pressure__m, /*relative=*/ true);
+	auto max_velocity = eval::metrics::OnlineMaxPipeVelocity();
+	auto pump_energy = eval::metrics::OnlinePumpEnergy();
+	auto eps_metrics = sim::solvers::epanet::StepAccumulators{};
+	auto stop_on_violation = sim::solvers::epanet::StepPredicate{};
+	bool aborted = false;
+	if (m__early_abort) {
+		eps_metrics = {pressure_deficit, max_velocity, pump_energy};
+		stop_on_violation = [&](const WDS&, const bevarmejo::epanet::ResultsBuffer&, const time::Instant) {
+			// The deficit of a step enters the integral only when the step is over.
+			aborted = pressure_deficit.deficiency().integral() > 0.0 ||
+				max_velocity.value() > m__max_velocity__m_per_s;
+			return aborted;
+		};
+	}
+	auto results = sim::solvers::epanet::solve_hydraulics(*anytown, m__eps_settings, eps_metrics, stop_on_violation);
 
 	if (!m__inp_base_filename.empty()) {
 		auto orig_filename_stem = fsys::path(m__anytown_filename).stem().string();
@@ -704,7 +827,7 @@ auto Problem::fitness(
 			bemeio::other::ext__inp
 		);
 
-		int errco = EN_saveinpfile(this->m__anytown->ph_, out_file.string().c_str());
+		int errco = EN_saveinpfile(anytown->ph_, out_file.string().c_str());
 		assert(errco <= 100);
 
 		bevarmejo::io::stream_out(std::cout,
@@ -717,22 +840,38 @@ auto Problem::fitness(
 	if (!sim::solvers::epanet::is_successful_with_warnings(results))
 	{
 		bemeio::stream_out( std::cerr, "Error in the hydraulic simulation. \n");
-		reset_dv(dvs);
 		return std::move(fitv);
 	}
 
 	// First objective is always cost for all formulations.
-	fitv[0] = cost(dvs);
+	// If aborted, the energy of the day is estimated from the average power so far.
+	auto metrics = cost_metrics(*anytown, capital_cost);
+	if (aborted)
+		metrics.energy_cost_per_day = pump_energy.mean_power__kW()*bevarmejo::k__hours_per_day*anytown::energy_cost__kWh;
+	fitv[0] = cost(metrics);
+
+	// The aborted EPS only has the steps up to the violation, which are enough
+	// for the penalty band of the hierarchical objective. Its energy is an
+	// estimate, so it is neither cached nor learnt by the surrogate.
+	if (aborted) {
+		fitv[1] = fr2::of__reliability(
+			*anytown, results,
+			m__max_velocity__m_per_s,
+			m__ds_failed_sols,
+			m__ds_unsati_sols
+		);
+		throw ProvisionalFitness{std::move(fitv)};
+	}
 	
-	// Second objective is the of__reliability, based on the formulation
+	// Stage 3: second objective is the of__reliability, based on the formulation
 	switch (m__reliability_obj_func_formulation)
 	{
 	case ReliabilityObjectiveFunctionFormulation::Base:
-		fitv[1] = fr1::of__reliability(*m__anytown);
+		fitv[1] = fr1::of__reliability(*anytown);
 		break;
 	case ReliabilityObjectiveFunctionFormulation::Hierarchical:
 		fitv[1] = fr2::of__reliability(
-			*m__anytown, results,
+			*anytown, results,
 			m__max_velocity__m_per_s,
 			m__ds_failed_sols,
 			m__ds_unsati_sols
@@ -750,8 +889,8 @@ auto Problem::fitness(
 		);
 
 		Json jout = {
-			{"capital_cost", m__cached_metrics.capital_cost},
-			{"energy_cost_per_day", m__cached_metrics.energy_cost_per_day} 
+			{"capital_cost", metrics.capital_cost},
+			{"energy_cost_per_day", metrics.energy_cost_per_day} 
 		};
 
 		std::ofstream out_file(filename);
@@ -777,16 +916,17 @@ auto Problem::fitness(
 		}
 	}
 
-	reset_dv(dvs);
     return std::move(fitv);
 }
 
 // ------------------- 2nd level ------------------- //
 auto Problem::apply_dv(
-	const std::vector<double>& dvs
+	WDS& anytown,
+	const std::vector<double>& dvs,
+	std::unordered_map<std::string, double>& old_HW_coeffs
 ) const -> void
 {
-	m__anytown->cache_indices();
+	anytown.cache_indices();
 
 	// Unfortunately I have to follow an order that doesn't make sense, which is the one on which I implemented the dvs.
 	// 1. Existing pipes,
@@ -796,15 +936,15 @@ auto Problem::apply_dv(
 	auto curr_dv = dvs.begin();
 	if (m__has_design) {
 		// 1. Existing pipes
-		std::size_t subnet_size = m__anytown->subnetwork_with_order<WDS::Pipe>(exis_pipes__subnet_name).size();
+		std::size_t subnet_size = anytown.subnetwork_with_order<WDS::Pipe>(exis_pipes__subnet_name).size();
 		std::size_t gene_size;
 		switch (m__exi_pipes_formulation)
 		{
 			case ExistingPipesFormulation::FarmaniEtAl2005:
 				gene_size = fep1::dv_size*subnet_size;
 				fep1::apply_dv__exis_pipes(
-					*m__anytown,
-					__old_HW_coeffs,
+					anytown,
+					old_HW_coeffs,
 					curr_dv,
 					curr_dv+gene_size,
 					m__exi_pipe_options
@@ -813,8 +953,8 @@ auto Problem::apply_dv(
 			case ExistingPipesFormulation::Combined:
 				gene_size = fep2::dv_size*subnet_size;
 				fep2::apply_dv__exis_pipes(
-					*m__anytown,
-					__old_HW_coeffs,
+					anytown,
+					old_HW_coeffs,
 					curr_dv,
 					curr_dv+gene_size,
 					m__exi_pipe_options
@@ -826,10 +966,10 @@ auto Problem::apply_dv(
 		curr_dv += gene_size;
 
 		// 2. New pipes
-		subnet_size = m__anytown->subnetwork_with_order<WDS::Pipe>(new_pipes__subnet_name).size();
+		subnet_size = anytown.subnetwork_with_order<WDS::Pipe>(new_pipes__subnet_name).size();
 		gene_size = fnp1::dv_size*subnet_size;
 		fnp1::apply_dv__new_pipes(
-			*m__anytown,
+			anytown,
 			curr_dv,
 			curr_dv+gene_size,
 			m__new_pipe_options
@@ -841,7 +981,7 @@ auto Problem::apply_dv(
 	if (m__has_operations) {
 		auto gene_size = pgo_dv::size;
 		pgo_dv::apply_dv__pumps(
-			*m__anytown,
+			anytown,
 			curr_dv,
 			curr_dv+gene_size
 		);
@@ -856,7 +996,7 @@ auto Problem::apply_dv(
 			case NewTanksFormulation::Simple:
 				gene_size = fnt1::dv_size*max_n_installable_tanks;
 				fnt1::apply_dv__tanks(
-					*m__anytown,
+					anytown,
 					curr_dv,
 					curr_dv+gene_size,
 					m__tank_options
@@ -865,7 +1005,7 @@ auto Problem::apply_dv(
 			case NewTanksFormulation::FarmaniEtAl2005:
 				gene_size = fnt2::dv_size *max_n_installable_tanks;
 				fnt2::apply_dv__tanks(
-					*m__anytown,
+					anytown,
 					curr_dv,
 					curr_dv+gene_size,
 					m__new_pipe_options
@@ -874,7 +1014,7 @@ auto Problem::apply_dv(
 			case NewTanksFormulation::LocVolRisDiamH2DRatio:
 				gene_size = fnt3::dv_size *max_n_installable_tanks;
 				fnt3::apply_dv__tanks(
-					*m__anytown,
+					anytown,
 					curr_dv,
 					curr_dv+gene_size,
 					m__tank_options,
@@ -922,13 +1062,14 @@ auto Problem::apply_dv(
 		
 		// To calculate the reliability index, since I lost the results in the internal optimization
 		// I have to apply the selected pattern to the network and run the simulation again. 
-		apply_dv__pumps(*m__anytown, m_pop.get_x().at(idx.front()));
+		apply_dv__pumps(anytown, m_pop.get_x().at(idx.front()));
 		return;	
 	}
 	*/
 }
 
-auto Problem::cost(
+auto Problem::capital_cost(
+	const WDS& anytown,
 	const std::vector<double> &dvs
 ) const -> double
 {
@@ -942,25 +1083,23 @@ auto Problem::cost(
 		auto curr_dv = dvs.begin();
 		std::size_t gene_size;
 
-		std::size_t subnet_size = m__anytown->subnetwork_with_order<WDS::Pipe>(exis_pipes__subnet_name).size();
+		std::size_t subnet_size = anytown.subnetwork_with_order<WDS::Pipe>(exis_pipes__subnet_name).size();
 		switch (m__exi_pipes_formulation)
 		{
 			case ExistingPipesFormulation::FarmaniEtAl2005:
 				gene_size = fep1::dv_size*subnet_size;
 				capital_cost += fep1::cost__exis_pipes(
-					*m__anytown,
+					m__pipes_cost_plan,
 					curr_dv,
-					curr_dv+gene_size,
-					m__exi_pipe_options
+					curr_dv+gene_size
 				);
 				break;
 			case ExistingPipesFormulation::Combined:
 				gene_size = fep2::dv_size*subnet_size;
 				capital_cost += fep2::cost__exis_pipes(
-					*m__anytown,
+					m__pipes_cost_plan,
 					curr_dv,
-					curr_dv+gene_size,
-					m__exi_pipe_options
+					curr_dv+gene_size
 				);
 				break;
 			default:
@@ -969,13 +1108,12 @@ auto Problem::cost(
 		curr_dv += gene_size;
 
 		// 2. New pipes
-		subnet_size = m__anytown->subnetwork_with_order<WDS::Pipe>(new_pipes__subnet_name).size();
+		subnet_size = anytown.subnetwork_with_order<WDS::Pipe>(new_pipes__subnet_name).size();
 		gene_size = fnp1::dv_size*subnet_size;
 		capital_cost += fnp1::cost__new_pipes(
-			*m__anytown,
+			m__pipes_cost_plan,
 			curr_dv,
-			curr_dv+gene_size,
-			m__new_pipe_options
+			curr_dv+gene_size
 		);
 		curr_dv += gene_size;
 
@@ -993,7 +1131,7 @@ auto Problem::cost(
 			case NewTanksFormulation::Simple:
 				gene_size = fnt1::dv_size*max_n_installable_tanks;
 				capital_cost += fnt1::cost__tanks(
-					*m__anytown,
+					anytown,
 					curr_dv,
 					curr_dv+gene_size,
 					m__tank_options,
@@ -1003,7 +1141,7 @@ auto Problem::cost(
 			case NewTanksFormulation::FarmaniEtAl2005:
 				gene_size = fnt2::dv_size *max_n_installable_tanks;
 				capital_cost += fnt2::cost__tanks(
-					*m__anytown,
+					anytown,
 					curr_dv,
 					curr_dv+gene_size,
 					m__tank_options,
@@ -1013,7 +1151,7 @@ auto Problem::cost(
 			case NewTanksFormulation::LocVolRisDiamH2DRatio:
 				gene_size = fnt3::dv_size *max_n_installable_tanks;
 				capital_cost += fnt3::cost__tanks(
-					*m__anytown,
+					anytown,
 					curr_dv,
 					curr_dv+gene_size,
 					m__tank_options,
@@ -1025,8 +1163,55 @@ auto Problem::cost(
 		}
 		curr_dv += gene_size;
 	}
-	
-	double energy_cost_per_day = pgo_dv::cost__energy_per_day(*m__anytown);
+
+	return capital_cost;
+}
+
+auto Problem::is_feasible__analytic(
+	const std::vector<double>& dvs
+) const -> bool
+{
+	const auto bounds = get_bounds();
+	const auto lb = m__dv_adapter.from_pagmo_to_beme(bounds.first);
+	const auto ub = m__dv_adapter.from_pagmo_to_beme(bounds.second);
+	const auto continuous = get_continuous_dvs_mask();
+	assert(dvs.size() == lb.size() && dvs.size() == continuous.size());
+
+	for (std::size_t i = 0; i < dvs.size(); ++i) {
+		if (dvs[i] < lb[i] || dvs[i] > ub[i])
+			return false;
+		if (!continuous[i] && dvs[i] != std::round(dvs[i]))
+			return false;
+	}
+
+	if (!m__has_design)
+		return true;
+
+	// The existing pipes are the first genes, action 1 is the cleaning in both formulations.
+	const std::size_t gene_size = m__exi_pipes_formulation == ExistingPipesFormulation::FarmaniEtAl2005 ?
+		fep1::dv_size : fep2::dv_size;
+	for (std::size_t i = 0; i < m__pipes_cost_plan.exis_clean.size(); ++i) {
+		if (dvs[i*gene_size] == 1.0 && std::isnan(m__pipes_cost_plan.exis_clean[i]))
+			return false;
+	}
+
+	return true;
+}
+
+auto Problem::cost_metrics(
+	const WDS& anytown,
+	const double capital_cost
+) const -> CostMetrics
+{
+	return {capital_cost, pgo_dv::cost__energy_per_day(anytown)};
+}
+
+auto Problem::cost(
+	const CostMetrics& metrics
+) const -> double
+{
+	const double capital_cost = metrics.capital_cost;
+	const double energy_cost_per_day = metrics.energy_cost_per_day;
 	double yearly_energy_cost = energy_cost_per_day * bevarmejo::k__days_ina_year;
 	double discount_rate = anytown::discount_rate;
 	double amortization_years = anytown::amortization_years;
@@ -1038,11 +1223,6 @@ auto Problem::cost(
 		amortization_years = 1.0;
 	}
 
-	if (!m__metrics_filename.empty()) {
-		m__cached_metrics.capital_cost = capital_cost;
-		m__cached_metrics.energy_cost_per_day = energy_cost_per_day;
-	}
-
 	// since this function is named "cost", I return the opposite of the money I have to pay so it is positive as the word implies
 	return -bevarmejo::net_present_value(
 		capital_cost,
@@ -1113,7 +1293,7 @@ auto fr1::of__reliability(
 
 		/*if (mean_norm_daily_deficit < 1.0 ) {
 			// Tanks constraint
-			double tank_cnstr = tanks_operational_levels_use(m__anytown->tanks());
+			double tank_cnstr = tanks_operational_levels_use(anytown.tanks());
 			fitv[1] *= (1-tank_cnstr); // tank constraint is 0.0 when I satisfy the tank constraints, and since it is between 0 and 1 I can use it as a weight.
 		}*/
 	}
@@ -1211,33 +1391,35 @@ auto fr2::of__reliability(
 }
 
 auto Problem::reset_dv(
-	const std::vector<double>& dvs
+	WDS& anytown,
+	const std::vector<double>& dvs,
+	const std::unordered_map<std::string, double>& old_HW_coeffs
 ) const -> void
 {
 	// Do the opposite operations of apply_dv 
 	auto curr_dv = dvs.begin();
 	if (m__has_design) {
 		// 1. Existing pipes
-		std::size_t subnet_size = m__anytown->subnetwork_with_order<WDS::Pipe>(exis_pipes__subnet_name).size();
+		std::size_t subnet_size = anytown.subnetwork_with_order<WDS::Pipe>(exis_pipes__subnet_name).size();
 		std::size_t gene_size;
 		switch (m__exi_pipes_formulation)
 		{
 			case ExistingPipesFormulation::FarmaniEtAl2005:
 				gene_size = fep1::dv_size*subnet_size;
 				fep1::reset_dv__exis_pipes(
-					*m__anytown,
+					anytown,
 					curr_dv,
 					curr_dv+gene_size,
-					__old_HW_coeffs
+					old_HW_coeffs
 				);
 				break;
 			case ExistingPipesFormulation::Combined:
 				gene_size = fep2::dv_size*subnet_size;
 				fep2::reset_dv__exis_pipes(
-					*m__anytown,
+					anytown,
 					curr_dv,
 					curr_dv+gene_size,
-					__old_HW_coeffs
+					old_HW_coeffs
 				);
 				break;
 			default:
@@ -1246,10 +1428,10 @@ auto Problem::reset_dv(
 		curr_dv += gene_size;
 
 		// 2. New pipes
-		subnet_size = m__anytown->subnetwork_with_order<WDS::Pipe>(new_pipes__subnet_name).size();
+		subnet_size = anytown.subnetwork_with_order<WDS::Pipe>(new_pipes__subnet_name).size();
 		gene_size = fnp1::dv_size*subnet_size;
 		fnp1::reset_dv__new_pipes(
-			*m__anytown,
+			anytown,
 			curr_dv,
 			curr_dv+gene_size
 		);
@@ -1260,7 +1442,7 @@ auto Problem::reset_dv(
 	if (m__has_operations) {
 		auto gene_size = pgo_dv::size;
 		pgo_dv::reset_dv__pumps(
-			*m__anytown,
+			anytown,
 			curr_dv,
 			curr_dv+gene_size
 		);
@@ -1275,7 +1457,7 @@ auto Problem::reset_dv(
 			case NewTanksFormulation::Simple:
 				gene_size = fnt1::dv_size*max_n_installable_tanks;
 				fnt1::reset_dv__tanks(
-					*m__anytown,
+					anytown,
 					curr_dv,
 					curr_dv+gene_size
 				);
@@ -1283,7 +1465,7 @@ auto Problem::reset_dv(
 			case NewTanksFormulation::FarmaniEtAl2005:
 				gene_size = fnt2::dv_size *max_n_installable_tanks;
 				fnt2::reset_dv__tanks(
-					*m__anytown,
+					anytown,
 					curr_dv,
 					curr_dv+gene_size
 				);
@@ -1291,7 +1473,7 @@ auto Problem::reset_dv(
 			case NewTanksFormulation::LocVolRisDiamH2DRatio:
 				gene_size = fnt3::dv_size *max_n_installable_tanks;
 				fnt3::reset_dv__tanks(
-					*m__anytown,
+					anytown,
 					curr_dv,
 					curr_dv+gene_size
 				);
@@ -1303,6 +1485,129 @@ auto Problem::reset_dv(
 	}
 }
 
+auto Problem::update_dv(
+	WDS& anytown,
+	std::vector<double>& applied_dvs,
+	const std::vector<double>& dvs
+) const -> void
+{
+	if (applied_dvs == dvs)
+		return;
+
+	if (applied_dvs.empty())
+	{
+		std::unordered_map<std::string, double> old_HW_coeffs;
+		apply_dv(anytown, dvs, old_HW_coeffs);
+		applied_dvs = dvs;
+		return;
+	}
+	assert(applied_dvs.size() == dvs.size());
+
+	anytown.cache_indices();
+
+	// Same order as apply_dv: existing pipes, new pipes, operations, tanks.
+	std::size_t exis_size = 0;
+	std::size_t new_size = 0;
+	std::size_t tanks_size = 0;
+	if (m__has_design) {
+		const std::size_t n_exis_pipes = anytown.subnetwork_with_order<WDS::Pipe>(exis_pipes__subnet_name).size();
+		exis_size = (m__exi_pipes_formulation == ExistingPipesFormulation::FarmaniEtAl2005 ? fep1::dv_size : fep2::dv_size)*n_exis_pipes;
+		new_size = fnp1::dv_size*anytown.subnetwork_with_order<WDS::Pipe>(new_pipes__subnet_name).size();
+		switch (m__new_tanks_formulation)
+		{
+			case NewTanksFormulation::Simple:
+				tanks_size = fnt1::dv_size*max_n_installable_tanks;
+				break;
+			case NewTanksFormulation::FarmaniEtAl2005:
+				tanks_size = fnt2::dv_size*max_n_installable_tanks;
+				break;
+			case NewTanksFormulation::LocVolRisDiamH2DRatio:
+				tanks_size = fnt3::dv_size*max_n_installable_tanks;
+				break;
+			default:
+				break;
+		}
+	}
+	const std::size_t exis_begin = 0;
+	const std::size_t new_begin = exis_begin+exis_size;
+	const std::size_t opers_begin = new_begin+new_size;
+	const std::size_t tanks_begin = opers_begin+(m__has_operations ? pgo_dv::size : 0);
+	assert(tanks_begin+tanks_size == dvs.size());
+
+	const auto differs = [&](std::size_t a_begin, std::size_t a_size) {
+		return !std::equal(dvs.begin()+a_begin, dvs.begin()+a_begin+a_size, applied_dvs.begin()+a_begin);
+	};
+
+	// Duplicates and tanks that are not pre-provisioned are added to (and
+	// deleted from) the network, shifting the EPANET indices. Then, the only
+	// safe way is the full reset followed by the full application.
+	if ((!m__prov_dup_pipes && differs(exis_begin, exis_size)) ||
+		(!m__prov_tanks && differs(tanks_begin, tanks_size)))
+	{
+		reset_dv(anytown, applied_dvs, m__exis_pipes_HW_coeffs);
+		applied_dvs.clear();
+
+		std::unordered_map<std::string, double> old_HW_coeffs;
+		apply_dv(anytown, dvs, old_HW_coeffs);
+		applied_dvs = dvs;
+		return;
+	}
+
+	// From here on, nothing is added or deleted.
+	const auto count_elements = [&anytown]() {
+		int n_nodes = 0;
+		int n_links = 0;
+		EN_getcount(anytown.ph_, EN_NODECOUNT, &n_nodes);
+		EN_getcount(anytown.ph_, EN_LINKCOUNT, &n_links);
+		return std::make_pair(n_nodes, n_links);
+	};
+	[[maybe_unused]] const auto n_elements = count_elements();
+
+	const auto applied = applied_dvs.cbegin();
+	const auto curr_dv = dvs.cbegin();
+	if (m__has_design) {
+		// 1. Existing pipes
+		if (m__exi_pipes_formulation == ExistingPipesFormulation::FarmaniEtAl2005)
+			fep1::update_dv__exis_pipes(anytown, m__exis_pipes_HW_coeffs, applied+exis_begin, curr_dv+exis_begin, curr_dv+new_begin, m__exi_pipe_options);
+		else
+			fep2::update_dv__exis_pipes(anytown, m__exis_pipes_HW_coeffs, applied+exis_begin, curr_dv+exis_begin, curr_dv+new_begin, m__exi_pipe_options);
+
+		// 2. New pipes
+		fnp1::update_dv__new_pipes(anytown, applied+new_begin, curr_dv+new_begin, curr_dv+opers_begin, m__new_pipe_options);
+	}
+
+	// 3. Operations
+	if (m__has_operations) {
+		pgo_dv::update_dv__pumps(anytown, applied+opers_begin, curr_dv+opers_begin, curr_dv+tanks_begin);
+	}
+
+	// 4. Tanks, the genes of a slot depend on the others (same location), so
+	// all the slots are reset and installed again.
+	if (m__has_design && differs(tanks_begin, tanks_size)) {
+		const auto tanks_end = tanks_begin+tanks_size;
+		switch (m__new_tanks_formulation)
+		{
+			case NewTanksFormulation::Simple:
+				fnt1::reset_dv__tanks(anytown, applied+tanks_begin, applied+tanks_end);
+				fnt1::apply_dv__tanks(anytown, curr_dv+tanks_begin, curr_dv+tanks_end, m__tank_options);
+				break;
+			case NewTanksFormulation::FarmaniEtAl2005:
+				fnt2::reset_dv__tanks(anytown, applied+tanks_begin, applied+tanks_end);
+				fnt2::apply_dv__tanks(anytown, curr_dv+tanks_begin, curr_dv+tanks_end, m__new_pipe_options);
+				break;
+			case NewTanksFormulation::LocVolRisDiamH2DRatio:
+				fnt3::reset_dv__tanks(anytown, applied+tanks_begin, applied+tanks_end);
+				fnt3::apply_dv__tanks(anytown, curr_dv+tanks_begin, curr_dv+tanks_end, m__tank_options, m__new_pipe_options);
+				break;
+			default:
+				break;
+		}
+	}
+
+	assertm(count_elements() == n_elements, "The incremental update must not change the topology of the network");
+	applied_dvs = dvs;
+}
+
 // ------------------- 3rd level ------------------- //
 // ------------------- apply_dv ------------------- //
 void fep1::apply_dv__exis_pipes(
@@ -1343,6 +1648,14 @@ void fep1::apply_dv__exis_pipes(
 #ifdef DEBUGSIM
 			bemeio::stream_out(std::cout, "Duplicated pipe ", id, " with diam ", pipes_alt_costs.at(alt_option).diameter__in, "in (", pipes_alt_costs.at(alt_option).diameter__in*MperFT/12, " mm)\n");
 #endif
+			// Pre-provisioned: the duplicate is already there, just open it.
+			auto dup_pipe_id = fep::dup_pipe_id(id);
+			if (anyt_wds.id_sequence(label::__prov_elems).contains(dup_pipe_id))
+			{
+				fep::open__dup_pipe(anyt_wds, dup_pipe_id, pipes_alt_costs.at(alt_option).diameter__in);
+				continue;
+			}
+
 			// Ideally I would just need to modify my network object and then
 			// this changed would be refelected automatically on the EPANET 
 			// project. However, this requires some work, so I will do it the 
@@ -1360,8 +1673,6 @@ void fep1::apply_dv__exis_pipes(
 			std::string out_node2_id = epanet::get_node_id(anyt_wds.ph_, out_node2_idx);
 			
 			// create the new pipe
-			// new name is Dxx where xx is the original pipe name
-			auto dup_pipe_id = std::string("D")+id;
 			int dup_pipe_idx = 0;
 			errorcode = EN_addlink(anyt_wds.ph_, dup_pipe_id.c_str(), EN_PIPE, out_node1_id.c_str(), out_node2_id.c_str(), &dup_pipe_idx);
 			assert(errorcode <= 100);
@@ -1432,6 +1743,14 @@ void fep2::apply_dv__exis_pipes(
 #ifdef DEBUGSIM
 			bemeio::stream_out(std::cout, "Duplicated pipe ", id, " with diam ", pipes_alt_costs.at(alt_option).diameter__in, "in (", pipes_alt_costs.at(alt_option).diameter__in*MperFT/12, " mm)\n");
 #endif
+			// Pre-provisioned: the duplicate is already there, just open it.
+			auto new_link_id = fep::dup_pipe_id(id);
+			if (anyt_wds.id_sequence(label::__prov_elems).contains(new_link_id))
+			{
+				fep::open__dup_pipe(anyt_wds, new_link_id, pipes_alt_costs.at(alt_option).diameter__in);
+				continue;
+			}
+
 			// DUPLICATE on EPANET project
 			// retrieve the old property of the already existing pipe
 			int out_node1_idx = 0;
@@ -1443,8 +1762,6 @@ void fep2::apply_dv__exis_pipes(
 			std::string out_node2_id = epanet::get_node_id(anyt_wds.ph_, out_node2_idx);
 			
 			// create the new pipe
-			// new name is Dxx where xx is the original pipe name
-			auto new_link_id = std::string("D")+id;
 			int dup_pipe_idx = 0;
 			errorcode = EN_addlink(anyt_wds.ph_, new_link_id.c_str(), EN_PIPE, out_node1_id.c_str(), out_node2_id.c_str(), &dup_pipe_idx);
 			assert(errorcode <= 100);
@@ -1478,6 +1795,103 @@ void fep2::apply_dv__exis_pipes(
 	return;
 }
 
+auto fep::dup_pipe_id(const std::string& exis_pipe_id) -> std::string
+{
+	// new name is Dxx where xx is the original pipe name
+	return std::string("D")+exis_pipe_id;
+}
+
+void fep::provision__dup_pipes(
+	WDS& anyt_wds)
+{
+	auto& prov_elems = anyt_wds.id_sequence(label::__prov_elems);
+
+	// Collect the ids first, installing while iterating on the pipes would
+	// invalidate the view.
+	std::vector<std::string> exis_pipe_ids;
+	for (auto&& [id, pipe] : anyt_wds.subnetwork_with_order<WDS::Pipe>(exis_pipes__subnet_name))
+	{
+		if (!prov_elems.contains(fep::dup_pipe_id(id)))
+			exis_pipe_ids.push_back(id);
+	}
+
+	for (const auto& id : exis_pipe_ids)
+	{
+		auto dup_pipe_id = fep::dup_pipe_id(id);
+		const auto& pipe = anyt_wds.pipe(id);
+
+		// DUPLICATE on EPANET project, same as apply_dv__exis_pipes but closed.
+		int out_node1_idx = 0;
+		int out_node2_idx = 0;
+		int errorcode = EN_getlinknodes(anyt_wds.ph_, pipe.EN_index(), &out_node1_idx, &out_node2_idx);
+		assert(errorcode <= 100);
+
+		std::string out_node1_id = epanet::get_node_id(anyt_wds.ph_, out_node1_idx);
+		std::string out_node2_id = epanet::get_node_id(anyt_wds.ph_, out_node2_idx);
+
+		int dup_pipe_idx = 0;
+		errorcode = EN_addlink(anyt_wds.ph_, dup_pipe_id.c_str(), EN_PIPE, out_node1_id.c_str(), out_node2_id.c_str(), &dup_pipe_idx);
+		beme_throw_if_EN_error(errorcode,
+			"Impossible to provision the duplicate pipes.",
+			"Error originating from the EPANET API while adding the duplicate of pipe ", id);
+
+		// The diameter is a placeholder until the pipe is opened by a dv.
+		double link_length = 0.0;
+		errorcode = EN_getlinkvalue(anyt_wds.ph_, pipe.EN_index(), EN_LENGTH, &link_length);
+		assert(errorcode <= 100);
+		double link_diameter = 0.0;
+		errorcode = EN_getlinkvalue(anyt_wds.ph_, pipe.EN_index(), EN_DIAMETER, &link_diameter);
+		assert(errorcode <= 100);
+		errorcode = EN_setpipedata(anyt_wds.ph_, dup_pipe_idx,
+			link_length,
+			link_diameter,
+			bevarmejo::anytown::coeff_HW_new,
+			0.0
+		);
+		assert(errorcode <= 100);
+		errorcode = EN_setlinkvalue(anyt_wds.ph_, dup_pipe_idx, EN_INITSTATUS, EN_CLOSED);
+		assert(errorcode <= 100);
+
+		// DUPLICATE on my network object
+		auto& dup_pipe = anyt_wds.duplicate<WDS::Pipe>(id, dup_pipe_id);
+		dup_pipe.roughness(bevarmejo::anytown::coeff_HW_new);
+		dup_pipe.initial_status(EN_CLOSED);
+
+		prov_elems.push_back(dup_pipe_id);
+	}
+
+	anyt_wds.cache_indices();
+}
+
+void fep::open__dup_pipe(
+	WDS& anyt_wds,
+	const std::string& dup_pipe_id,
+	double diameter__in)
+{
+	// The roughness of a new pipe is fixed, it was already set when provisioned.
+	auto& dup_pipe = anyt_wds.pipe(dup_pipe_id);
+
+	int errorcode = EN_setlinkvalue(anyt_wds.ph_, dup_pipe.EN_index(), EN_DIAMETER, diameter__in);
+	assert(errorcode <= 100);
+	errorcode = EN_setlinkvalue(anyt_wds.ph_, dup_pipe.EN_index(), EN_INITSTATUS, EN_OPEN);
+	assert(errorcode <= 100);
+
+	dup_pipe.diameter(diameter__in*MperFT/12*1000);
+	dup_pipe.initial_status(EN_OPEN);
+}
+
+void fep::close__dup_pipe(
+	WDS& anyt_wds,
+	const std::string& dup_pipe_id)
+{
+	auto& dup_pipe = anyt_wds.pipe(dup_pipe_id);
+
+	int errorcode = EN_setlinkvalue(anyt_wds.ph_, dup_pipe.EN_index(), EN_INITSTATUS, EN_CLOSED);
+	assert(errorcode <= 100);
+
+	dup_pipe.initial_status(EN_CLOSED);
+}
+
 void fnp1::apply_dv__new_pipes(
 	WDS &anyt_wds,
 	std::vector<double>::const_iterator start_dv,
@@ -1570,6 +1984,24 @@ auto fnt1::apply_dv__tanks(
 		// I should create a new tank at that position and with that volume
 		double tank_volume_gal = tank_option.at(tank_vol_option).volume__gal;
 		double tank_volume_m3 = tank_volume_gal * bevarmejo::k__m3_per_gal;
+
+		if (fnt::has_provisioned_tanks(anytown))
+		{
+			// Same data as below, but written in the slot of this tank.
+			auto&& [orig_tank_id, orig_tank] = *(anytown.tanks().begin());
+			double diam_m = std::pow(tank_volume_m3*4.0/k__pi, 1.0/3.0);
+			fnt::install__tank_slot(anytown, i, junction_id, {
+				orig_tank.elevation(),
+				diam_m,
+				orig_tank.min_level().value(),
+				orig_tank.min_level().value(),
+				diam_m,
+				orig_tank.min_volume().value(),
+				16.0
+			});
+			already_installed_tanks.insert(new_tank_loc_shift);
+			continue;
+		}
 		
 		auto new_tank_id = std::string("T")+std::to_string(i);
 		auto& new_tank = anytown.insert_tank(new_tank_id);
@@ -1714,6 +2146,27 @@ auto fnt2::apply_dv__tanks(
 
 		auto&& [junction_id, junction] = *(anytown.subnetwork_with_order<WDS::Junction>("possible_tank_locations").begin() + new_tank_loc_shift);
 
+		if (fnt::has_provisioned_tanks(anytown))
+		{
+			// Same data as below, but written in the slot of this tank.
+			double operational_tank_height = tank_hmax__m-tank_hmin__m;
+			if (operational_tank_height < 0)
+			{
+				operational_tank_height = fnt2::tank_hmax_ub__m-tank_hmin__m;
+			}
+			fnt::install__tank_slot(anytown, i, junction_id, {
+				tank_hmin__m-tank_safetyl__m,
+				tank_diam__m,
+				tank_safetyl__m,
+				tank_safetyl__m,
+				operational_tank_height+tank_safetyl__m,
+				k__pi*tank_diam__m*tank_diam__m/4.0*tank_safetyl__m,
+				new_pipes_options.at(riser_dv-1).diameter__in
+			});
+			already_installed_tanks.insert(new_tank_loc_shift);
+			continue;
+		}
+
 		auto new_tank_id = std::string("T")+std::to_string(i);
 		auto& new_tank = anytown.insert_tank(new_tank_id);
 
@@ -1892,6 +2345,22 @@ auto anytown::fnt3::apply_dv__tanks(
             }
         }
         
+		if (fnt::has_provisioned_tanks(a_anytown_sys))
+		{
+			// Same data as below, but written in the slot of this tank.
+			fnt::install__tank_slot(a_anytown_sys, i, junction_id, {
+				elev__m,
+				diam__m,
+				min_ope_lev__m-elev__m,
+				min_ope_lev__m-elev__m,
+				max_ope_lev__m-elev__m,
+				k__pi*diam__m*diam__m/4.0*(min_ope_lev__m-elev__m),
+				new_pipes_options.at(riser_diam_opt_idx).diameter__in
+			});
+			already_installed_tanks.insert(tank_loc_shift);
+			continue;
+		}
+
 		auto new_tank_id = std::string("T")+std::to_string(i);
 		auto& new_tank = a_anytown_sys.insert_tank(new_tank_id);
 
@@ -1969,133 +2438,305 @@ auto anytown::fnt3::apply_dv__tanks(
 }
 
 
+auto fnt::tank_id(std::size_t slot) -> std::string
+{
+	return std::string("T")+std::to_string(slot);
+}
+
+auto fnt::riser_id(std::size_t slot, const std::string& junction_id) -> std::string
+{
+	return std::string("Ris_")+std::to_string(slot)+"_"+junction_id;
+}
+
+auto fnt::has_provisioned_tanks(
+	const WDS& anytown) -> bool
+{
+	return anytown.id_sequence(label::__prov_elems).contains(fnt::tank_id(0));
+}
+
+void fnt::provision__tanks(
+	WDS& anytown)
+{
+	if (fnt::has_provisioned_tanks(anytown))
+		return;
+
+	auto& prov_elems = anytown.id_sequence(label::__prov_elems);
+
+	// Until a slot is used, its tank is a copy of the original one.
+	// Copy the data now, inserting tanks may invalidate the reference.
+	auto&& [orig_tank_id, orig_tank] = *(anytown.tanks().begin());
+	const double elevation__m = orig_tank.elevation();
+	const double min_level__m = orig_tank.min_level().value();
+	const double max_level__m = orig_tank.max_level().value();
+	const double diameter__m = orig_tank.diameter().value();
+	const double min_volume__m3 = orig_tank.min_volume().value();
+
+	std::vector<std::string> loc_ids;
+	for (auto&& [junction_id, junction] : anytown.subnetwork_with_order<WDS::Junction>(pos_tank_loc__subnet_name))
+		loc_ids.push_back(junction_id);
+	assert(!loc_ids.empty());
+
+	for (std::size_t i = 0; i < bevarmejo::anytown::max_n_installable_tanks; ++i)
+	{
+		auto new_tank_id = fnt::tank_id(i);
+		auto& new_tank = anytown.insert_tank(new_tank_id);
+
+		new_tank.elevation(elevation__m);
+		new_tank.initial_level(min_level__m);
+		new_tank.min_level(min_level__m);
+		new_tank.max_level(max_level__m);
+		new_tank.diameter(diameter__m);
+		new_tank.min_volume(min_volume__m3);
+		const auto& first_loc = anytown.junction(loc_ids.front());
+		new_tank.x_coord(first_loc.x_coord());
+		new_tank.y_coord(first_loc.y_coord()+bevarmejo::anytown::riser_length__ft);
+
+		int new_tank_idx = 0;
+		int errco = EN_addnode(anytown.ph_, new_tank_id.c_str(), EN_TANK, &new_tank_idx);
+		beme_throw_if_EN_error(errco,
+			"Impossible to provision the tank slots.",
+			"Error originating from the EPANET API while adding tank ", new_tank_id);
+
+		errco = EN_setcoord(anytown.ph_, new_tank_idx, new_tank.x_coord(), new_tank.y_coord());
+		assert(errco <= 100);
+
+		errco = EN_settankdata(anytown.ph_, new_tank_idx,
+			elevation__m/MperFT,
+			min_level__m/MperFT,
+			min_level__m/MperFT,
+			max_level__m/MperFT,
+			diameter__m/MperFT,
+			min_volume__m3/M3perFT3,
+			"");
+		assert(errco <= 100);
+
+		prov_elems.push_back(new_tank_id);
+
+		// One closed riser to every possible location.
+		for (const auto& junction_id : loc_ids)
+		{
+			auto new_riser_id = fnt::riser_id(i, junction_id);
+
+			auto& riser = anytown.install_pipe(new_riser_id, junction_id, new_tank_id);
+			riser.diameter(16.0*MperFT/12*1000);
+			riser.length(bevarmejo::anytown::riser_length__ft*MperFT);
+			riser.roughness(bevarmejo::anytown::coeff_HW_new);
+			riser.initial_status(EN_CLOSED);
+
+			int riser_idx = 0;
+			errco = EN_addlink(anytown.ph_, new_riser_id.c_str(), EN_PIPE, junction_id.c_str(), new_tank_id.c_str(), &riser_idx);
+			beme_throw_if_EN_error(errco,
+				"Impossible to provision the tank slots.",
+				"Error originating from the EPANET API while adding riser ", new_riser_id);
+
+			errco = EN_setpipedata(anytown.ph_, riser_idx,
+				bevarmejo::anytown::riser_length__ft,
+				16.0,
+				bevarmejo::anytown::coeff_HW_new,
+				0.0
+			);
+			assert(errco <= 100);
+
+			errco = EN_setlinkvalue(anytown.ph_, riser_idx, EN_INITSTATUS, EN_CLOSED);
+			assert(errco <= 100);
+
+			prov_elems.push_back(new_riser_id);
+		}
+	}
+
+	anytown.cache_indices();
+}
+
+void fnt::install__tank_slot(
+	WDS& anytown,
+	std::size_t slot,
+	const std::string& junction_id,
+	const tank_slot_data& data)
+{
+	auto new_tank_id = fnt::tank_id(slot);
+	auto& new_tank = anytown.tank(new_tank_id);
+	const auto& junction = anytown.junction(junction_id);
+
+	new_tank.elevation(data.elevation__m);
+	new_tank.diameter(data.diameter__m);
+	new_tank.initial_level(data.initial_level__m);
+	new_tank.min_level(data.min_level__m);
+	new_tank.max_level(data.max_level__m);
+	new_tank.min_volume(data.min_volume__m3);
+	new_tank.x_coord(junction.x_coord());
+	new_tank.y_coord(junction.y_coord()+bevarmejo::anytown::riser_length__ft);
+
+	int errco = EN_setcoord(anytown.ph_, new_tank.EN_index(), new_tank.x_coord(), new_tank.y_coord());
+	assert(errco <= 100);
+
+	errco = EN_settankdata(anytown.ph_, new_tank.EN_index(),
+		data.elevation__m/MperFT,
+		data.initial_level__m/MperFT,
+		data.min_level__m/MperFT,
+		data.max_level__m/MperFT,
+		data.diameter__m/MperFT,
+		data.min_volume__m3/M3perFT3,
+		"");
+	assert(errco <= 100);
+
+	auto new_riser_id = fnt::riser_id(slot, junction_id);
+	auto& riser = anytown.pipe(new_riser_id);
+
+	errco = EN_setlinkvalue(anytown.ph_, riser.EN_index(), EN_DIAMETER, data.riser_diameter__in);
+	assert(errco <= 100);
+	errco = EN_setlinkvalue(anytown.ph_, riser.EN_index(), EN_INITSTATUS, EN_OPEN);
+	assert(errco <= 100);
+
+	riser.diameter(data.riser_diameter__in*MperFT/12*1000);
+	riser.initial_status(EN_OPEN);
+
+	anytown.id_sequence(label::__temp_elems).push_back(new_tank_id);
+	anytown.id_sequence(label::__temp_elems).push_back(new_riser_id);
+}
+
+void fnt::uninstall__tank_slot(
+	WDS& anytown,
+	std::size_t slot)
+{
+	auto& temp_elems = anytown.id_sequence(label::__temp_elems);
+	auto new_tank_id = fnt::tank_id(slot);
+	if (!temp_elems.contains(new_tank_id))
+		return;
+
+	// Close the riser that was opened, the tank is isolated again.
+	for (auto&& [junction_id, junction] : anytown.subnetwork_with_order<WDS::Junction>(pos_tank_loc__subnet_name))
+	{
+		auto riser_id = fnt::riser_id(slot, junction_id);
+		if (!temp_elems.contains(riser_id))
+			continue;
+
+		auto& riser = anytown.pipe(riser_id);
+		int errco = EN_setlinkvalue(anytown.ph_, riser.EN_index(), EN_INITSTATUS, EN_CLOSED);
+		assert(errco <= 100);
+
+		riser.initial_status(EN_CLOSED);
+		temp_elems.erase(riser_id);
+	}
+
+	temp_elems.erase(new_tank_id);
+}
+
 // -------------------   cost   ------------------- //
-auto fep1::cost__exis_pipes(
+auto compile__pipes_cost_plan(
 	const WDS& anytown,
+	const std::vector<bevarmejo::anytown::exi_pipe_option> &exi_pipes_alt_costs,
+	const std::vector<bevarmejo::anytown::new_pipe_option> &new_pipes_alt_costs
+) -> PipesCostPlan
+{
+	PipesCostPlan plan;
+
+	// Existing pipes: cleaning (by diameter) or duplicating, city pipes cost more.
+	plan.n_exis_options = exi_pipes_alt_costs.size();
+	for (auto&& [id, pipe] : anytown.subnetwork_with_order<WDS::Pipe>(exis_pipes__subnet_name))
+	{
+		bool city = anytown.id_sequence(city_pipes__subnet_name).contains(id);
+		double length__ft = pipe.length().value()/MperFT; // the table is in $/ft
+
+		double pipe_diam = pipe.diameter().value();
+		auto it = std::find_if(exi_pipes_alt_costs.begin(), exi_pipes_alt_costs.end(), 
+			[&pipe_diam](const auto& pac) { 
+				return std::abs(pac.diameter__in*MperFT/12*1000 - pipe_diam) < 0.0001; 
+			});
+		if (it == exi_pipes_alt_costs.end())
+			plan.exis_clean.push_back(std::numeric_limits<double>::quiet_NaN());
+		else
+			plan.exis_clean.push_back((city ? it->cost_clean_city__per_ft : it->cost_clean_resi__per_ft)*length__ft);
+
+		for (const auto& pac : exi_pipes_alt_costs)
+			plan.exis_dup.push_back((city ? pac.cost_dup_city__per_ft : pac.cost_dup_resi__per_ft)*length__ft);
+	}
+
+	// New pipes: installing each option.
+	plan.n_new_options = new_pipes_alt_costs.size();
+	for (auto&& [id, pipe] : anytown.subnetwork_with_order<WDS::Pipe>(new_pipes__subnet_name))
+	{
+		double length__ft = pipe.length().value()/MperFT;
+		for (const auto& pac : new_pipes_alt_costs)
+			plan.new_pipes.push_back(pac.cost__per_ft*length__ft);
+	}
+
+	return plan;
+}
+
+auto fep1::cost__exis_pipes(
+	const PipesCostPlan& plan,
 	std::vector<double>::const_iterator start_dv,
-    std::vector<double>::const_iterator end_dv,
-	const std::vector<bevarmejo::anytown::exi_pipe_option> &pipes_alt_costs
+	std::vector<double>::const_iterator end_dv
 ) -> double
 {
-	double capital_cost = 0.0;
+	assert(end_dv-start_dv == static_cast<std::ptrdiff_t>(fep1::dv_size*plan.exis_clean.size()));
 
-	auto curr_dv = start_dv;
-	for (auto&& [id, pipe] : anytown.subnetwork_with_order<WDS::Pipe>(exis_pipes__subnet_name))
+	double capital_cost = 0.0;
+	std::size_t i = 0;
+	for (auto curr_dv = start_dv; curr_dv != end_dv; ++i)
 	{
 		std::size_t action_type = *curr_dv++;
 		std::size_t alt_option = *curr_dv++;
 
-		if (action_type == 0) // no action
-			continue;
-		
-		bool city = anytown.id_sequence(city_pipes__subnet_name).contains(id);
-		double pipe_cost_per_ft = 0.0;
-
 		if (action_type == 1) // clean
 		{
-			// The cost per unit of length is a function of the diameter of the pipe.
-			// Therefore, I have to search for the diameter in the table.
-			double pipe_diam = pipe.diameter().value();
-			auto it = std::find_if(pipes_alt_costs.begin(), pipes_alt_costs.end(), 
-				[&pipe_diam](const auto& pac) { 
-					return std::abs(pac.diameter__in*MperFT/12*1000 - pipe_diam) < 0.0001; 
-				});
-
-			// Check I actually found it 
-			assert(it != pipes_alt_costs.end());
-
-			if (city)
-				pipe_cost_per_ft = it->cost_clean_city__per_ft;
-			else
-				pipe_cost_per_ft = it->cost_clean_resi__per_ft;
+			assert(!std::isnan(plan.exis_clean[i]));
+			capital_cost += plan.exis_clean[i];
 		}
-		else // if (action_type == 2) // duplicate
+		else if (action_type == 2) // duplicate
 		{
-			if (city) 
-				pipe_cost_per_ft = pipes_alt_costs.at(alt_option).cost_dup_city__per_ft;
-			else
-				pipe_cost_per_ft = pipes_alt_costs.at(alt_option).cost_dup_resi__per_ft;
-		} 
-
-		capital_cost += pipe_cost_per_ft/MperFT * pipe.length().value(); 
-		// again I save the length in mm, but the table is in $/ft
+			capital_cost += plan.exis_dup.at(i*plan.n_exis_options+alt_option);
+		}
 	}
 
-	assert(curr_dv == end_dv);
 	return capital_cost;
 }
+
 auto fep2::cost__exis_pipes(
-	const WDS& anytown,
+	const PipesCostPlan& plan,
 	std::vector<double>::const_iterator start_dv,
-    std::vector<double>::const_iterator end_dv,
-	const std::vector<bevarmejo::anytown::exi_pipe_option> &pipes_alt_costs
+	std::vector<double>::const_iterator end_dv
 ) -> double
 {
+	assert(end_dv-start_dv == static_cast<std::ptrdiff_t>(fep2::dv_size*plan.exis_clean.size()));
+
 	double capital_cost = 0.0;
-	
-	auto curr_dv = start_dv;
-	for (auto&& [id, pipe] : anytown.subnetwork_with_order<WDS::Pipe>(exis_pipes__subnet_name))
+	std::size_t i = 0;
+	for (auto curr_dv = start_dv; curr_dv != end_dv; ++curr_dv, ++i)
 	{
-		std::size_t action_type = *curr_dv++;
-		std::size_t alt_option = action_type-2; // -2 because the first two options are no action and clean
-
-		if (action_type == 0) // no action
-			continue;
-
-		bool city = anytown.id_sequence(city_pipes__subnet_name).contains(id);
-		double pipe_cost_per_ft = 0.0;
+		std::size_t action_type = *curr_dv;
 
 		if (action_type == 1) // clean
 		{
-			double pipe_diam = pipe.diameter().value();
-			auto it = std::find_if(pipes_alt_costs.begin(), pipes_alt_costs.end(), 
-				[&pipe_diam](const auto& pac) { 
-					return std::abs(pac.diameter__in*MperFT/12*1000 - pipe_diam) < 0.0001; 
-				});
-
-			assert(it != pipes_alt_costs.end());
-				
-			if (city)
-				pipe_cost_per_ft = it->cost_clean_city__per_ft;
-			else
-				pipe_cost_per_ft = it->cost_clean_resi__per_ft;
+			assert(!std::isnan(plan.exis_clean[i]));
+			capital_cost += plan.exis_clean[i];
 		}
-		else // if (dv >= 2) duplicate
+		else if (action_type >= 2) // duplicate, -2 because the first two options are no action and clean
 		{
-			if (city) 
-				pipe_cost_per_ft = pipes_alt_costs.at(alt_option).cost_dup_city__per_ft;
-			else
-				pipe_cost_per_ft = pipes_alt_costs.at(alt_option).cost_dup_resi__per_ft;
-		} 
-
-		capital_cost += pipe_cost_per_ft/MperFT * pipe.length().value(); 
+			capital_cost += plan.exis_dup.at(i*plan.n_exis_options+action_type-2);
+		}
 	}
 
-	assert(curr_dv == end_dv);
 	return capital_cost;
 }
 
 auto fnp1::cost__new_pipes(
-	const WDS &anytown,
+	const PipesCostPlan& plan,
 	std::vector<double>::const_iterator start_dv,
-    std::vector<double>::const_iterator end_dv,
-	const std::vector<bevarmejo::anytown::new_pipe_option> &pipes_alt_costs
+	std::vector<double>::const_iterator end_dv
 ) -> double
 {
-	// 6 pipes x [prc]
-	// This must be installed, thus minimum cost will never be 0.
+	assert(plan.n_new_options != 0 && 
+		end_dv-start_dv == static_cast<std::ptrdiff_t>(fnp1::dv_size*plan.new_pipes.size()/plan.n_new_options));
+
 	double capital_cost = 0.0;
-	
-	auto curr_dv = start_dv;
-	for (auto&& [id, pipe] : anytown.subnetwork_with_order<WDS::Pipe>(new_pipes__subnet_name))
+	std::size_t i = 0;
+	for (auto curr_dv = start_dv; curr_dv != end_dv; ++curr_dv, ++i)
 	{
-		std::size_t alt_option = *curr_dv++;
-		
-		double pipe_cost_per_ft = pipes_alt_costs.at(alt_option).cost__per_ft;
-		capital_cost += pipe_cost_per_ft/MperFT * pipe.length().value();
+		std::size_t alt_option = *curr_dv;
+		capital_cost += plan.new_pipes.at(i*plan.n_new_options+alt_option);
 	}
 
-	assert(curr_dv == end_dv);
 	return capital_cost;
 }
 
@@ -2295,8 +2936,14 @@ void fep1::reset_dv__exis_pipes(
 
 		else // if (action_type == 2) // duplicate
 		{
-			// duplicate pipe has been named Dxx where xx is the original pipe name
-			auto dup_pipe_id = std::string("D")+id;
+			auto dup_pipe_id = fep::dup_pipe_id(id);
+
+			// Pre-provisioned duplicates stay in the network, closed.
+			if (anytown.id_sequence(label::__prov_elems).contains(dup_pipe_id))
+			{
+				fep::close__dup_pipe(anytown, dup_pipe_id);
+				continue;
+			}
 
 			int errorcode = EN_deletelink(anytown.ph_, anytown.pipe(dup_pipe_id).EN_index(), EN_UNCONDITIONAL);
 			assert(errorcode <= 100);
@@ -2338,8 +2985,14 @@ void fep2::reset_dv__exis_pipes(
 
 		else // if (dv >= 2) // duplicate
 		{
-			// duplicate pipe has been named Dxx where xx is the original pipe name
-			auto dup_pipe_id = std::string("D")+id;
+			auto dup_pipe_id = fep::dup_pipe_id(id);
+
+			// Pre-provisioned duplicates stay in the network, closed.
+			if (anytown.id_sequence(label::__prov_elems).contains(dup_pipe_id))
+			{
+				fep::close__dup_pipe(anytown, dup_pipe_id);
+				continue;
+			}
 
 			int errorcode = EN_deletelink(anytown.ph_, anytown.pipe(dup_pipe_id).EN_index(), EN_UNCONDITIONAL);
 			assert(errorcode <= 100);
@@ -2384,6 +3037,14 @@ void fnt1::reset_dv__tanks(
 	std::vector<double>::const_iterator start_dv,
     std::vector<double>::const_iterator end_dv)
 {
+	// Pre-provisioned slots stay in the network, isolated.
+	if (fnt::has_provisioned_tanks(anytown))
+	{
+		for (std::size_t i = 0; i < bevarmejo::anytown::max_n_installable_tanks; ++i)
+			fnt::uninstall__tank_slot(anytown, i);
+		return;
+	}
+
 	std::unordered_set<std::size_t> already_installed_tanks;
 
 	auto curr_dv = start_dv;
@@ -2423,6 +3084,14 @@ auto fnt2::reset_dv__tanks(
     std::vector<double>::const_iterator end_dv
 ) -> void
 {
+	// Pre-provisioned slots stay in the network, isolated.
+	if (fnt::has_provisioned_tanks(anytown))
+	{
+		for (std::size_t i = 0; i < max_n_installable_tanks; ++i)
+			fnt::uninstall__tank_slot(anytown, i);
+		return;
+	}
+
 	auto& temp_elems = anytown.id_sequence(label::__temp_elems);
 	for (std::size_t i = max_n_installable_tanks; i; --i)
 	{
@@ -2449,6 +3118,14 @@ auto anytown::fnt3::reset_dv__tanks(
     std::vector<double>::const_iterator end_dv
 ) -> void
 {
+	// Pre-provisioned slots stay in the network, isolated.
+	if (fnt::has_provisioned_tanks(a_anytown_sys))
+	{
+		for (std::size_t i = 0; i < max_n_installable_tanks; ++i)
+			fnt::uninstall__tank_slot(a_anytown_sys, i);
+		return;
+	}
+
     auto& temp_elems = a_anytown_sys.id_sequence(label::__temp_elems);
 	for (std::size_t i = max_n_installable_tanks; i; --i)
 	{
@@ -2469,6 +3146,157 @@ auto anytown::fnt3::reset_dv__tanks(
 	}
 }
 
+// -------------------  update  ------------------- //
+namespace {
+// Undo the action applied to an existing pipe and apply the new one, in place.
+// Actions: 0 no action, 1 clean, 2 duplicate (pre-provisioned) with alt_option.
+void update__exis_pipe(
+	WDS& anyt_wds,
+	const std::string& id,
+	WDS::Pipe& pipe,
+	std::size_t old_action,
+	std::size_t action,
+	std::size_t alt_option,
+	const std::unordered_map<std::string, double> &orig_HW_coeffs,
+	const std::vector<bevarmejo::anytown::exi_pipe_option> &pipes_alt_costs)
+{
+	const auto dup_pipe_id = fep::dup_pipe_id(id);
+	assert(anyt_wds.id_sequence(label::__prov_elems).contains(dup_pipe_id));
+
+	if (old_action == 1)
+	{
+		int errorcode = EN_setlinkvalue(anyt_wds.ph_, pipe.EN_index(), EN_ROUGHNESS, orig_HW_coeffs.at(id));
+		assert(errorcode <= 100);
+
+		pipe.roughness(orig_HW_coeffs.at(id));
+	}
+	else if (old_action == 2 && action != 2)
+	{
+		fep::close__dup_pipe(anyt_wds, dup_pipe_id);
+	}
+
+	if (action == 1)
+	{
+		int errorcode = EN_setlinkvalue(anyt_wds.ph_, pipe.EN_index(), EN_ROUGHNESS, bevarmejo::anytown::coeff_HW_cleaned);
+		assert(errorcode <= 100);
+
+		pipe.roughness(bevarmejo::anytown::coeff_HW_cleaned);
+	}
+	else if (action == 2)
+	{
+		fep::open__dup_pipe(anyt_wds, dup_pipe_id, pipes_alt_costs.at(alt_option).diameter__in);
+	}
+}
+} // namespace
+
+void fep1::update_dv__exis_pipes(
+	WDS& anyt_wds,
+	const std::unordered_map<std::string, double> &orig_HW_coeffs,
+	std::vector<double>::const_iterator applied_dv,
+	std::vector<double>::const_iterator start_dv,
+	std::vector<double>::const_iterator end_dv,
+	const std::vector<bevarmejo::anytown::exi_pipe_option> &pipes_alt_costs)
+{
+	auto old_dv = applied_dv;
+	auto curr_dv = start_dv;
+	for (auto&& [id, pipe] : anyt_wds.subnetwork_with_order<WDS::Pipe>(exis_pipes__subnet_name))
+	{
+		std::size_t old_action_type = *old_dv++;
+		std::size_t old_alt_option = *old_dv++;
+		std::size_t action_type = *curr_dv++;
+		std::size_t alt_option = *curr_dv++;
+
+		// The option matters only for the duplicates.
+		if (action_type == old_action_type && (action_type != 2 || alt_option == old_alt_option))
+			continue;
+
+		update__exis_pipe(anyt_wds, id, pipe, old_action_type, action_type, alt_option, orig_HW_coeffs, pipes_alt_costs);
+	}
+	assert(curr_dv == end_dv);
+}
+
+void fep2::update_dv__exis_pipes(
+	WDS& anyt_wds,
+	const std::unordered_map<std::string, double> &orig_HW_coeffs,
+	std::vector<double>::const_iterator applied_dv,
+	std::vector<double>::const_iterator start_dv,
+	std::vector<double>::const_iterator end_dv,
+	const std::vector<bevarmejo::anytown::exi_pipe_option> &pipes_alt_costs)
+{
+	auto old_dv = applied_dv;
+	auto curr_dv = start_dv;
+	for (auto&& [id, pipe] : anyt_wds.subnetwork_with_order<WDS::Pipe>(exis_pipes__subnet_name))
+	{
+		std::size_t old_dv_value = *old_dv++;
+		std::size_t dv = *curr_dv++;
+		if (dv == old_dv_value)
+			continue;
+
+		// Same actions as fep1: the options >= 2 are the duplicates.
+		update__exis_pipe(anyt_wds, id, pipe,
+			std::min<std::size_t>(old_dv_value, 2),
+			std::min<std::size_t>(dv, 2),
+			dv >= 2 ? dv-2 : 0,
+			orig_HW_coeffs, pipes_alt_costs);
+	}
+	assert(curr_dv == end_dv);
+}
+
+void fnp1::update_dv__new_pipes(
+	WDS& anyt_wds,
+	std::vector<double>::const_iterator applied_dv,
+	std::vector<double>::const_iterator start_dv,
+	std::vector<double>::const_iterator end_dv,
+	const std::vector<bevarmejo::anytown::new_pipe_option> &pipes_alt_costs)
+{
+	auto old_dv = applied_dv;
+	auto curr_dv = start_dv;
+	for (auto&& [id, pipe] : anyt_wds.subnetwork_with_order<WDS::Pipe>(new_pipes__subnet_name))
+	{
+		std::size_t old_alt_option = *old_dv++;
+		std::size_t alt_option = *curr_dv++;
+		if (alt_option == old_alt_option)
+			continue;
+
+		double diameter__in = pipes_alt_costs.at(alt_option).diameter__in;
+		int errorcode = EN_setlinkvalue(anyt_wds.ph_, pipe.EN_index(), EN_DIAMETER, diameter__in);
+		assert(errorcode <= 100);
+
+		pipe.diameter(diameter__in*MperFT/12*1000); //save in mm
+	}
+	assert(curr_dv == end_dv);
+}
+
+void pgo_dv::update_dv__pumps(
+	WDS& anyt_wds,
+	std::vector<double>::const_iterator applied_dv,
+	std::vector<double>::const_iterator start_dv,
+	std::vector<double>::const_iterator end_dv)
+{
+	std::size_t i = 0;
+	for (auto&& [id, pump] : anyt_wds.pumps()) {
+		auto pattern_idx = pump.speed_pattern()->EN_index();
+
+		auto old_dv = applied_dv;
+		auto curr_dv = start_dv;
+		for (auto t=1; t <= pgo_dv::size; ++t, ++curr_dv, ++old_dv) {
+			if (*curr_dv == *old_dv)
+				continue;
+
+			int errorcode = EN_setpatternvalue(
+				anyt_wds.ph_,
+				pattern_idx,
+				t,
+				*curr_dv > (double)i ? 1.0 : 0.0
+			);
+			assert(errorcode <= 100);
+		}
+		assert(curr_dv == end_dv);
+
+		++i;
+	}
+}
+
 // ------------------- 1st level ------------------- //
 // -------------------   Bounds  ------------------- //
 auto Problem::get_bounds() const -> std::pair<std::vector<double>, std::vector<double>>
@@ -2762,8 +3590,9 @@ void to_json(Json& j, const bevarmejo::anytown::Problem &prob)
 		j[io::key::at_subnets()][seq_name] = names_in_seq;
 	}
 
-	// Remove the temporary elements
+	// Remove the temporary and pre-provisioned elements
 	j[io::key::at_subnets()].erase(label::__temp_elems);
+	j[io::key::at_subnets()].erase(label::__prov_elems);
 
 	j["extra_info"] = prob.get_extra_info();
 
@@ -2787,6 +3616,30 @@ void to_json(Json& j, const bevarmejo::anytown::Problem &prob)
 	if (prob.m__ds_unsati_sols != 0) {
 		j[io::key::ds_unsat_sols()] = prob.m__ds_unsati_sols;
 	}
+
+	if (prob.m__prov_dup_pipes) {
+		j[io::key::prov_dup_pipes()] = prob.m__prov_dup_pipes;
+	}
+
+	if (prob.m__prov_tanks) {
+		j[io::key::prov_tanks()] = prob.m__prov_tanks;
+	}
+
+	if (prob.m__early_abort) {
+		j[io::key::early_abort()] = prob.m__early_abort;
+	}
+
+	if (prob.fitness_cache() != nullptr) {
+		j[bemeio::key::fitness_cache()] = prob.fitness_cache()->capacity();
+	}
+
+	if (prob.surrogate() != nullptr) {
+		j[bemeio::key::surrogate()] = prob.surrogate()->config();
+	}
+
+	if (prob.eval_budget__s() > 0.0) {
+		j[bemeio::key::eval_budget()] = prob.eval_budget__s();
+	}
 }
 
 } // namespace anytown
@@ -1,10 +1,20 @@
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <exception>
+#include <mutex>
+#include <optional>
 #include <string>
 #include <string_view>
+#include <thread>
+#include <unordered_map>
 
 #include "bevarmejo/utility/exceptions.hpp"
 #include "bevarmejo/io/aliased_key.hpp"
 #include "bevarmejo/io/fsys.hpp"
 #include "bevarmejo/io/json.hpp"
+#include "bevarmejo/io/keys/beme.hpp"
 #include "bevarmejo/io/labels.hpp"
 #include "bevarmejo/io/streams.hpp"
 namespace bemeio = bevarmejo::io;
@@ -12,6 +22,7 @@ namespace bemeio = bevarmejo::io;
 #include "bevarmejo/econometric_functions.hpp"
 #include "bevarmejo/hydraulic_functions.hpp"
 #include "bevarmejo/evaluation/metrics/hydraulic_functions.hpp"
+#include "bevarmejo/evaluation/metrics/accumulators.hpp"
 
 #include "bevarmejo/wds/water_distribution_system.hpp"
 #include "bevarmejo/simulation/solvers/epanet/hydraulic.hpp"
@@ -37,48 +48,156 @@ namespace io::key
 static constexpr bemeio::AliasedKey at_eps_inp {"Anytown eps inp"}; // "Anytown eps inp"
 static constexpr bemeio::AliasedKey at_ff_inp {"Anytown fireflow inp"}; // "Anytown fireflow inp"
 static constexpr bemeio::AliasedKey opers {"Pump group operations"}; // "Pump group operations"
+static constexpr bemeio::AliasedKey early_abort {"Early abort"}; // "Early abort"
+static constexpr bemeio::AliasedKey prov_dup_pipes {"Pre-provisioned duplicates"}; // "Pre-provisioned duplicates"
+static constexpr bemeio::AliasedKey prov_tanks {"Pre-provisioned tanks"}; // "Pre-provisioned tanks"
+static constexpr bemeio::AliasedKey ff_threads {"Fireflow threads"}; // "Fireflow threads"
+static constexpr bemeio::AliasedKey ff_pruning {"Fireflow pruning"}; // "Fireflow pruning"
+static constexpr bemeio::AliasedKey perspectives {"Perspectives"}; // "Perspectives"
+static constexpr bemeio::AliasedKey eps_checkpoints {"EPS checkpoints"}; // "EPS checkpoints"
 }
 
 static const std::string hr__exinfo = "Hydraulic Reliability and Operational Efficiency Perspective";
 static const std::string mr__exinfo = "Mechanical Reliability Perspective";
 static const std::string fr__exinfo = "Firefighting Reliability Perspective";
 
-Problem::Problem(std::string_view a_ud_formulation, const Json& settings, const bemeio::Paths& lookup_paths) :
-    __old_HW_coeffs()
+namespace {
+
+auto to_formulation(std::string_view a_formulation_name) -> Formulation
+{
+    if (a_formulation_name == io::formulation_name::hr)
+        return Formulation::hr;
+    if (a_formulation_name == io::formulation_name::mr)
+        return Formulation::mr;
+
+    beme_throw_if(a_formulation_name != io::formulation_name::fr, std::invalid_argument,
+        "Impossible to construct the Anytown Problem.",
+        "The provided Anytown SysTol25 formulation is not recognised.",
+        "Formulation: ", a_formulation_name);
+
+    return Formulation::fr;
+}
+
+auto to_formulation_name(const Formulation a_formulation) -> const std::string&
 {
-    if (a_ud_formulation == io::formulation_name::hr)
+    switch (a_formulation)
     {
-        m__formulation = Formulation::hr;
-        m__extra_info = hr__exinfo;   
+    case Formulation::hr:
+        return io::formulation_name::hr;
+    case Formulation::mr:
+        return io::formulation_name::mr;
+    default:
+        return io::formulation_name::fr;
     }
-    else if (a_ud_formulation == io::formulation_name::mr)
+}
+
+// For each tank in the temp elements, set the min level to 0 and then the min volume
+// (EN doesn't change that automatically because it consider them independent)
+auto lower_min_level__new_tanks(WDS& ff_anytown) -> void
+{
+    ff_anytown.cache_indices();
+    auto& temp_elems = ff_anytown.id_sequence(label::__temp_elems);
+    for (std::size_t i = anytown::max_n_installable_tanks; i; --i)
     {
-        m__formulation = Formulation::mr;
-        m__extra_info = mr__exinfo;
+        auto new_tank_id = std::string("T")+std::to_string(i-1);
+
+        if (temp_elems.contains(new_tank_id))
+        {
+            auto& tank = ff_anytown.tank(new_tank_id);
+            int errorcode = EN_setnodevalue(ff_anytown.ph(), tank.EN_index(), EN_MINLEVEL, 0.0);
+            assert(errorcode <= 100);
+
+            errorcode = EN_setnodevalue(ff_anytown.ph(), tank.EN_index(), EN_MINVOLUME, 0.0);
+            assert(errorcode <= 100);
+
+            tank.min_level(0.0);
+            tank.min_volume(0.0);
+        }
     }
-    else if (a_ud_formulation == io::formulation_name::fr)
+}
+
+} // namespace
+
+Problem::Problem(std::string_view a_ud_formulation, const Json& settings, const bemeio::Paths& lookup_paths)
+{
+    // Throws if the formulation is not recognised.
+    m__formulation = to_formulation(a_ud_formulation);
+    switch (m__formulation)
     {
-        m__formulation = Formulation::fr;
+    case Formulation::hr:
+        m__extra_info = hr__exinfo;
+        break;
+    case Formulation::mr:
+        m__extra_info = mr__exinfo;
+        break;
+    default:
         m__extra_info = fr__exinfo;
-    }
-    else
-    {
-        beme_throw(std::invalid_argument, "Impossible to construct the Anytown Problem.",
-        "The provided Anytown SysTol25 formulation is not recognised.",
-        "Formulation: ", a_ud_formulation);
+        break;
     }
     m__name = (
         bemeio::other::nsp__beme +
         bemeio::other::sep__namespaces +
         problem_name + 
         bemeio::other::sep__namespaces +
-        std::string(a_ud_formulation)
+        to_formulation_name(m__formulation)
     );
 
+    // Optional: the perspectives computed by evaluate_perspectives (by default only this formulation).
+    m__perspectives = {m__formulation};
+    if (io::key::perspectives.exists_in(settings))
+    {
+        m__perspectives.clear();
+        for (const auto& name : settings.at(io::key::perspectives.as_in(settings)).get<std::vector<std::string>>())
+        {
+            const auto perspective = to_formulation(name);
+            if (std::find(m__perspectives.begin(), m__perspectives.end(), perspective) == m__perspectives.end())
+                m__perspectives.push_back(perspective);
+        }
+    }
+
     load_networks(settings, lookup_paths);
     
     load_other_data(settings, lookup_paths);
 
+    // Islands built from the same settings share the fitness already evaluated.
+    if (bemeio::key::fitness_cache.exists_in(settings))
+    {
+        enable_fitness_cache(
+            m__name + settings.dump(),
+            settings.at(bemeio::key::fitness_cache.as_in(settings)).get<std::size_t>()
+        );
+    }
+
+    // Optional: give up the evaluations that take longer than this many seconds.
+    if (bemeio::key::eval_budget.exists_in(settings))
+    {
+        enable_eval_budget(settings.at(bemeio::key::eval_budget.as_in(settings)).get<double>());
+    }
+
+    // Optional: skip the candidates a surrogate predicts to be infeasible or dominated.
+    if (bemeio::key::surrogate.exists_in(settings))
+    {
+        enable_surrogate(settings.at(bemeio::key::surrogate.as_in(settings)).get<Surrogate::Config>());
+    }
+
+    // Optional: two-level evaluation with a coarse EPS first.
+    if (bemeio::key::coarse_screening.exists_in(settings))
+    {
+        enable_coarse_screening(
+            settings.at(bemeio::key::coarse_screening.as_in(settings)).get<CoarseScreening::Config>()
+        );
+        m__coarse_eps_settings = m__coarse_screening->coarsen(m__eps_settings);
+    }
+
+    // Optional: the front used to prune the fireflow scenarios, shared like the cache.
+    if (m__formulation == Formulation::fr &&
+        io::key::ff_pruning.exists_in(settings) &&
+        settings.at(io::key::ff_pruning.as_in(settings)).get<bool>())
+    {
+        m__ff_archive = ParetoArchive::shared(m__name + settings.dump());
+        m__ff_n_pruned = std::make_shared<std::atomic<std::size_t>>(0);
+    }
+
     m__dv_adapter.reconfigure(this->get_continuous_dvs_mask());    
 }
 
@@ -89,7 +208,6 @@ void Problem::load_networks(const Json& settings, const bemeio::Paths& lookup_pa
     );
     const auto inp_filename = settings.at(io::key::at_eps_inp.as_in(settings)).get<fsys::path>();
 
-    // Use "locate_file" to find the inp file in the paths.
     // EPANET does not load correctly the a curve so we need to fix it "manually" here.
     m__anytown = std::make_shared<WDS>(
         bemeio::locate_file</*log = */true>(inp_filename, lookup_paths),
@@ -115,6 +233,10 @@ void Problem::load_networks(const Json& settings, const bemeio::Paths& lookup_pa
     m__anytown->submit_id_sequence(anytown::new_pipes__subnet_name, anytown::new_pipes__el_names);
     m__anytown->submit_id_sequence(anytown::pos_tank_loc__subnet_name, anytown::pos_tank_loc__el_names);
     m__anytown->submit_id_sequence(label::__temp_elems);
+    m__anytown->submit_id_sequence(label::__prov_elems);
+
+    // The fitness is evaluated on per-thread replicas, m__anytown is only the prototype.
+    m__replicas = std::make_shared<WDSReplicaPool>(WDSReplicaPool::replicate(m__anytown));
 
     // Prepare the simulation settings.
 	long h_step = 0;
@@ -132,6 +254,12 @@ void Problem::load_networks(const Json& settings, const bemeio::Paths& lookup_pa
 
     m__eps_settings.report_resolution(r_step);
 
+    // Each simulation records only what its perspective reads.
+    using RP = bevarmejo::epanet::ResultsProfile;
+    // EPS constraints, cost and the resilience index of the hr perspective
+    // are accumulated online during the simulation (see fitness), nothing is stored.
+    m__eps_settings.results_profile(RP::none());
+
     // The mechanical reliability simulations is a instantaneous simulation
     // with 1.3 times the average demand. The anytown file starts at 18:00
     // with demand 1, thus we do a simulation with horizon 0.
@@ -139,8 +267,14 @@ void Problem::load_networks(const Json& settings, const bemeio::Paths& lookup_pa
         .report_resolution(r_step)
         .resolution(h_step)
         .horizon(0);
+    m__mrsim__settings.results_profile(RP::none() // Mechanical reliability estimator
+        .record(RP::Element::Junction, {RP::Quantity::Demand})
+        .record(RP::Element::Pipe, {RP::Quantity::Flow})
+    );
     
-    if (m__formulation == Formulation::fr)
+    // The fireflow network is needed also when the fr perspective is requested.
+    if (m__formulation == Formulation::fr ||
+        std::find(m__perspectives.begin(), m__perspectives.end(), Formulation::fr) != m__perspectives.end())
     {
         // Upload the second network and do more or less the same actions
         assert(settings != nullptr && 
@@ -174,6 +308,9 @@ void Problem::load_networks(const Json& settings, const bemeio::Paths& lookup_pa
         m__ff_anytown->submit_id_sequence(anytown::new_pipes__subnet_name, anytown::new_pipes__el_names);
         m__ff_anytown->submit_id_sequence(anytown::pos_tank_loc__subnet_name, anytown::pos_tank_loc__el_names);
         m__ff_anytown->submit_id_sequence(label::__temp_elems);
+        m__ff_anytown->submit_id_sequence(label::__prov_elems);
+
+        m__ff_replicas = std::make_shared<WDSReplicaPool>(WDSReplicaPool::replicate(m__ff_anytown));
 
         errorcode = EN_gettimeparam(m__ff_anytown->ph(), EN_HYDSTEP, &h_step);
         assert(errorcode < 100);
@@ -188,11 +325,93 @@ void Problem::load_networks(const Json& settings, const bemeio::Paths& lookup_pa
             .pressure_driven_analysis(0.0, anytown::min_pressure_fireflow__psi/PSIperFT*MperFT, 0.5)
             .resolution(h_step)
             .horizon(horizon);
+        m__ffsim_settings.results_profile(RP::none() // Total demand and consumption
+            .record(RP::Element::Junction, {RP::Quantity::Demand})
+        );
     }
 }
 
 void Problem::load_other_data(const Json& settings, const bemeio::Paths& lookup_paths)
 {
+    // Optional: stop the EPS of infeasible solutions as soon as they violate a constraint.
+    if (io::key::early_abort.exists_in(settings))
+    {
+        m__early_abort = settings.at(io::key::early_abort.as_in(settings)).get<bool>();
+    }
+
+    // Optional: install the duplicate pipes and the tank slots once, so that
+    // the topology never changes.
+    if (io::key::prov_dup_pipes.exists_in(settings))
+    {
+        m__prov_dup_pipes = settings.at(io::key::prov_dup_pipes.as_in(settings)).get<bool>();
+    }
+
+    if (io::key::prov_tanks.exists_in(settings))
+    {
+        m__prov_tanks = settings.at(io::key::prov_tanks.as_in(settings)).get<bool>();
+    }
+
+    // Optional: individuals with the same design and the same pump schedule for
+    // the first hours resume the EPS from the hydraulic state at that hour.
+    if (io::key::eps_checkpoints.exists_in(settings))
+    {
+        // Only the hr formulation has the pump genes (see get_continuous_dvs_mask).
+        beme_throw_if(m__formulation != Formulation::hr, std::invalid_argument,
+            "Impossible to enable the EPS checkpoints.",
+            "The pump schedule is part of the decision vector only in the hydraulic reliability formulation.");
+
+        long p_step = 0;
+        int errorcode = EN_gettimeparam(m__anytown->ph(), EN_PATTERNSTEP, &p_step);
+        assert(errorcode < 100);
+        long p_start = 0;
+        errorcode = EN_gettimeparam(m__anytown->ph(), EN_PATTERNSTART, &p_start);
+        assert(errorcode < 100);
+
+        // The pump gene i must drive the period [i*p_step, (i+1)*p_step) of the EPS.
+        beme_throw_if(p_start != 0, std::invalid_argument,
+            "Impossible to enable the EPS checkpoints.",
+            "The pump patterns must start with the simulation.",
+            "Pattern start: ", p_start);
+
+        m__eps_checkpoints = std::make_shared<sim::solvers::epanet::HydCheckpointCache>(
+            p_step,
+            settings.at(io::key::eps_checkpoints.as_in(settings)).get<std::size_t>()
+        );
+    }
+
+    // Both prototypes, so that every replica has them.
+    for (auto* p_anytown : {m__anytown.get(), m__ff_anytown.get()})
+    {
+        if (p_anytown == nullptr)
+            continue;
+
+        if (m__prov_dup_pipes)
+            anytown::fep::provision__dup_pipes(*p_anytown);
+        if (m__prov_tanks)
+            anytown::fnt::provision__tanks(*p_anytown);
+    }
+
+    // Roughness of the existing pipes as loaded, to restore the cleaned pipes
+    // of a replica whatever was applied to it.
+    for (auto&& [id, pipe] : m__anytown->subnetwork_with_order<WDS::Pipe>(anytown::exis_pipes__subnet_name))
+        m__exis_pipes_HW_coeffs.emplace(id, pipe.roughness().value());
+
+    m__pipes_cost_plan = anytown::compile__pipes_cost_plan(*m__anytown, anytown::exi_pipe_options, anytown::new_pipe_options);
+
+    if (m__ff_anytown)
+    {
+        for (auto&& [id, pipe] : m__ff_anytown->subnetwork_with_order<WDS::Pipe>(anytown::exis_pipes__subnet_name))
+            m__ff_exis_pipes_HW_coeffs.emplace(id, pipe.roughness().value());
+    }
+
+    // Optional: simulate the fireflow scenarios concurrently on this many threads.
+    if (m__ff_anytown && io::key::ff_threads.exists_in(settings))
+    {
+        const auto n_threads = settings.at(io::key::ff_threads.as_in(settings)).get<std::size_t>();
+        if (n_threads > 1)
+            m__ff_workers = std::make_shared<WorkerPool>(n_threads);
+    }
+
     if (m__formulation == Formulation::hr)
     {
         return; // No need in hydraulic reliability
@@ -239,6 +458,31 @@ void Problem::load_other_data(const Json& settings, const bemeio::Paths& lookup_
 }
 
 
+auto Problem::prunes_fireflow() const noexcept -> bool
+{
+    return m__ff_archive != nullptr;
+}
+
+auto Problem::n_pruned_evaluations() const noexcept -> std::size_t
+{
+    return m__ff_n_pruned ? m__ff_n_pruned->load(std::memory_order_relaxed) : 0;
+}
+
+auto Problem::n_ff_threads() const noexcept -> std::size_t
+{
+    return m__ff_workers ? m__ff_workers->size() : 0;
+}
+
+auto Problem::perspectives() const -> std::vector<std::string>
+{
+    std::vector<std::string> names;
+    names.reserve(m__perspectives.size());
+    for (const auto perspective : m__perspectives)
+        names.push_back(to_formulation_name(perspective));
+
+    return names;
+}
+
 // PAGMO FUNCTIONS
 
 auto Problem::get_nobj() const -> std::vector<double>::size_type
@@ -275,16 +519,271 @@ auto Problem::get_continuous_dvs_mask() const -> std::vector<bool>
 auto Problem::fitness(
 	const std::vector<double>& pagmo_dv
 ) const -> std::vector<double>
+{
+    // First thing first reconvert back from the pagmo ordering to the beme one.
+	const auto dvs = m__dv_adapter.from_pagmo_to_beme(pagmo_dv);
+
+    return budgeted_fitness(get_nobj()+get_nec()+get_nic(), [this, &dvs]() {
+        return provisional_fitness([this, &dvs]() {
+            return cached_fitness(dvs, [this, &dvs]() {
+                return surrogate_fitness(dvs, [this, &dvs]() {
+                    return screened_fitness(
+                        [this, &dvs]() { return evaluate(dvs, /*coarse=*/ true); },
+                        [this, &dvs]() { return evaluate(dvs); },
+                        /*front_test=*/ m__formulation == Formulation::hr
+                    );
+                });
+            });
+        });
+    });
+}
+
+auto Problem::evaluate(
+	const std::vector<double>& dvs,
+    const bool a_coarse
+) const -> std::vector<double>
 {
     // Let's pre-allocate in case something doesn't work out.
 	std::vector<double> fitv(get_nobj()+get_nec()+get_nic(), std::numeric_limits<double>::max());
 
-    // First thing first reconvert back from the pagmo ordering to the beme one.
-	const auto dvs = m__dv_adapter.from_pagmo_to_beme(pagmo_dv);
+    // Each thread works on its own replica, so fitness can be called concurrently.
+    // The fireflow network is leased only when the scenarios are simulated.
+    // Only the genes that differ from the last individual on the replica are applied.
+    auto anytown = m__replicas->lease();
+    update_dv(*anytown, anytown.applied_dv(), dvs);
+
+    // Stages 1 and 2 are common to all formulations.
+    const auto eps = simulate_eps(*anytown, dvs, a_coarse, m__formulation == Formulation::hr);
+    fitv[0] = eps.cost;
+
+    if (eps.penalty.has_value())
+    {
+        // No need to do extra simulations, simply return the violation as this solution is not good.
+        fitv[1] = *eps.penalty;
+        return std::move(fitv);
+    }
+
+    // Stage 3: we calculated anything we need for objective function 1 and 2 that is common between all formulations,
+    // Now, we need to specialize.
+    if (a_coarse && m__formulation != Formulation::hr)
+    {
+        // Only the hr perspective comes for free with the EPS. The mr and fr
+        // ones need their own simulations, which is what the screening has to
+        // save, so the coarse pass only tells that the solution is feasible
+        // and the front test is skipped (see fitness).
+        fitv[1] = -1.0;
+        return std::move(fitv);
+    }
 
-    apply_dv(dvs);
+    switch (m__formulation)
+    {
+    case Formulation::hr:
+        fitv[1] = -eps.hydraulic_reliability;  // I want to maximize the reliability index
+        break;
 
-	const auto results = sim::solvers::epanet::solve_hydraulics(*m__anytown, m__eps_settings);
+    case Formulation::mr:
+        fitv[1] = -mechanical_reliability_perspective(*anytown);
+        break;
+
+    case Formulation::fr:
+    {
+        const auto ff_rel = firefighting_reliability_perspective(dvs, fitv[0], /*prunable=*/ true);
+        fitv[1] = -ff_rel.value;
+        // The bound of a pruned individual depends on the archive at the time
+        // (and on the threads), so it is returned but never reused.
+        if (ff_rel.pruned)
+            throw ProvisionalFitness{std::move(fitv)};
+
+        // Only the fully simulated individuals can enter the front.
+        if (m__ff_archive)
+            m__ff_archive->insert(fitv[0], fitv[1]);
+        break;
+    }
+    
+    default:
+        break;
+    }
+
+    return std::move(fitv);
+}
+
+auto Problem::evaluate_perspectives(
+    const std::vector<double>& pagmo_dv
+) const -> std::vector<double>
+{
+    const auto dvs = m__dv_adapter.from_pagmo_to_beme(pagmo_dv);
+
+    std::vector<double> fitv(1+m__perspectives.size(), std::numeric_limits<double>::max());
+
+    auto anytown = m__replicas->lease();
+    update_dv(*anytown, anytown.applied_dv(), dvs);
+
+    const bool needs_hr = std::find(m__perspectives.begin(), m__perspectives.end(), Formulation::hr) != m__perspectives.end();
+    const auto eps = simulate_eps(*anytown, dvs, /*coarse=*/ false, needs_hr);
+    fitv[0] = eps.cost;
+
+    // The penalty of stages 1 and 2 does not depend on the perspective.
+    if (eps.penalty.has_value())
+    {
+        std::fill(fitv.begin()+1, fitv.end(), *eps.penalty);
+        return std::move(fitv);
+    }
+
+    // The mr simulation runs on the replica of the EPS, the fr scenarios on
+    // their own replicas, so they can run concurrently. The values are exact,
+    // the fireflow pruning is never applied here.
+    std::optional<double> mr_value;
+    std::optional<double> fr_value;
+    const bool needs_mr = std::find(m__perspectives.begin(), m__perspectives.end(), Formulation::mr) != m__perspectives.end();
+    const bool needs_fr = std::find(m__perspectives.begin(), m__perspectives.end(), Formulation::fr) != m__perspectives.end();
+
+    std::exception_ptr mr_error;
+    std::thread mr_thread;
+    if (needs_mr)
+    {
+        auto mr_task = [this, &anytown, &mr_value, &mr_error]() {
+            try
+            {
+                mr_value = mechanical_reliability_perspective(*anytown);
+            }
+            catch (...)
+            {
+                mr_error = std::current_exception();
+            }
+        };
+
+        if (needs_fr)
+            mr_thread = std::thread(mr_task);
+        else
+            mr_task();
+    }
+
+    std::exception_ptr fr_error;
+    if (needs_fr)
+    {
+        try
+        {
+            fr_value = firefighting_reliability_perspective(dvs, fitv[0], /*prunable=*/ false).value;
+        }
+        catch (...)
+        {
+            fr_error = std::current_exception();
+        }
+    }
+
+    if (mr_thread.joinable())
+        mr_thread.join();
+
+    if (mr_error)
+        std::rethrow_exception(mr_error);
+    if (fr_error)
+        std::rethrow_exception(fr_error);
+
+    for (std::size_t i = 0; i < m__perspectives.size(); ++i)
+    {
+        switch (m__perspectives[i])
+        {
+        case Formulation::hr:
+            fitv[i+1] = -eps.hydraulic_reliability;
+            break;
+        case Formulation::mr:
+            fitv[i+1] = -*mr_value;
+            break;
+        case Formulation::fr:
+            fitv[i+1] = -*fr_value;
+            break;
+        default:
+            break;
+        }
+    }
+
+    return std::move(fitv);
+}
+
+auto Problem::evaluate_perspectives(
+    const std::vector<std::vector<double>>& pagmo_dvs,
+    WorkerPool* a_pool
+) const -> std::vector<std::vector<double>>
+{
+    std::vector<std::vector<double>> fitvs(pagmo_dvs.size());
+
+    const auto evaluate_one = [this, &pagmo_dvs, &fitvs](std::size_t i) {
+        fitvs[i] = evaluate_perspectives(pagmo_dvs[i]);
+    };
+
+    if (a_pool != nullptr)
+    {
+        a_pool->parallel_for(pagmo_dvs.size(), evaluate_one);
+    }
+    else
+    {
+        for (std::size_t i = 0; i < pagmo_dvs.size(); ++i)
+            evaluate_one(i);
+    }
+
+    return std::move(fitvs);
+}
+
+auto Problem::simulate_eps(
+    WDS& anytown,
+    const std::vector<double>& dvs,
+    const bool a_coarse,
+    const bool a_resilience
+) const -> EPSOutcome
+{
+    EPSOutcome outcome{
+        std::numeric_limits<double>::max(),
+        std::numeric_limits<double>::max(),
+        0.0
+    };
+
+    // Stage 1: analytic terms, no simulation needed.
+    const double capital_cost = this->capital_cost(anytown, dvs);
+
+    // Stage 2: EPS. The metrics of the EPS are computed while simulating.
+    const double min_pressure__m = anytown::min_pressure__psi*MperFT/PSIperFT;
+    auto pressure_deficit = eval::metrics::OnlinePressureDeficiency(min_pressure__m, /*relative=*/ true);
+    auto max_velocity = eval::metrics::OnlineMaxPipeVelocity();
+    auto pump_energy = eval::metrics::OnlinePumpEnergy();
+    auto resilience = eval::metrics::OnlineResilienceIndex(min_pressure__m);
+    auto eps_metrics = sim::solvers::epanet::StepAccumulators{pressure_deficit, max_velocity, pump_energy};
+    if (a_resilience)
+        eps_metrics.push_back(resilience);
+
+    // With early abort, the EPS stops once a constraint is violated, as the
+    // solution is going to be penalised anyway. The penalty is then computed on
+    // the steps simulated so far.
+    bool aborted = false;
+    auto stop_on_violation = sim::solvers::epanet::StepPredicate{};
+    if (m__early_abort)
+    {
+        stop_on_violation = [&](const WDS&, const bevarmejo::epanet::ResultsBuffer&, const time::Instant) {
+            // The deficit of a step enters the integral only when the step is over.
+            aborted = pressure_deficit.deficiency().integral() > 0.0 ||
+                max_velocity.value() > anytown::max_velocity__m_per_s;
+            return aborted;
+        };
+    }
+
+    // The design (all but the pump genes) and the requested metrics identify
+    // the simulation, the pump genes are the schedule shared up to a period.
+    // The coarse EPS has other settings and is not checkpointed, and without
+    // the pump genes (not hr) there is no schedule to share.
+    const bool has_pump_genes = m__formulation == Formulation::hr;
+    const auto results = [&]() {
+        if (a_coarse || m__eps_checkpoints == nullptr || !has_pump_genes)
+            return sim::solvers::epanet::solve_hydraulics(anytown,
+                a_coarse ? m__coarse_eps_settings : m__eps_settings,
+                eps_metrics, stop_on_violation);
+
+        assert(dvs.size() == get_nx());
+        const auto pumps_begin = dvs.end()-anytown::pgo_dv::size;
+        auto design = std::vector<double>(dvs.begin(), pumps_begin);
+        design.push_back(a_resilience ? 1.0 : 0.0);
+        return sim::solvers::epanet::solve_hydraulics(anytown, m__eps_settings,
+            eps_metrics, stop_on_violation,
+            *m__eps_checkpoints, design, std::vector<double>(pumps_begin, dvs.end()));
+    }();
 
     if (!m__inp_base_filename.empty()) {
 		auto orig_filename_stem = fsys::path(m__anytown_filename).stem().string();
@@ -300,7 +799,7 @@ auto Problem::fitness(
 			bemeio::other::ext__inp
 		);
 
-		int errco = EN_saveinpfile(this->m__anytown->ph_, out_file.string().c_str());
+		int errco = EN_saveinpfile(anytown.ph_, out_file.string().c_str());
 		assert(errco <= 100);
 
 		bevarmejo::io::stream_out(std::cout,
@@ -313,13 +812,15 @@ auto Problem::fitness(
 	if (!sim::solvers::epanet::is_successful_with_warnings(results))
 	{
 		bemeio::stream_out( std::cerr, "Error in the hydraulic simulation. \n");
-		reset_dv(dvs);
-		return std::move(fitv);
+		return outcome;
 	}
 
     // Objective function 1: 
     // NET PRESENT COST
-    fitv[0] = cost(dvs);
+    // If aborted (or coarse), the energy of the day is estimated from the average power so far.
+    const double energy_per_day__kWh = (aborted || a_coarse) ?
+        pump_energy.mean_power__kW()*bevarmejo::k__hours_per_day : pump_energy.energy__kWh();
+    outcome.cost = cost(capital_cost, energy_per_day__kWh*anytown::energy_cost__kWh);
 
     // Objective function 2:
     // It is divided in 3 parts:
@@ -330,10 +831,8 @@ auto Problem::fitness(
     //      - total normalized pressure deficit
     //      - max velocity normalized
     // C: [0 -> -1]
-    // CUSTOMIZED PART!
+    // CUSTOMIZED PART! (the perspective, see evaluate)
     // Feasible solutions in the EPS and satisfying the constraint violations.
-    // 
-    double value = std::numeric_limits<double>::max();
 
     // Part A
     const auto n_steps = results.size();
@@ -342,30 +841,19 @@ auto Problem::fitness(
     if (n_correct_steps < n_steps)
     {
         // Kind of like the error in the hyd simulation.
-        reset_dv(dvs);
-        fitv[1] = 1.0 + ((double)n_steps - (double)n_correct_steps) / (double)n_steps;
-        return std::move(fitv);
+        outcome.penalty = 1.0 + ((double)n_steps - (double)n_correct_steps) / (double)n_steps;
+        return outcome;
     }
 
     // Part B
     
     // Get the cumulative deficit of all junctions and normalize it if EPS.
-	const auto normdeficit_daily = pressure_deficiency(*m__anytown, anytown::min_pressure__psi*MperFT/PSIperFT, /*relative=*/ true);
-	auto pressure_violation = normdeficit_daily.integrate_forward();
-    pressure_violation = (normdeficit_daily.back().first != 0) ? (pressure_violation / normdeficit_daily.back().first) : pressure_violation;
+    const auto& normdeficit_daily = pressure_deficit.deficiency();
+	auto pressure_violation = normdeficit_daily.integral();
+    pressure_violation = (normdeficit_daily.duration() != 0) ? (pressure_violation / normdeficit_daily.duration()) : pressure_violation;
 
     // Get the maximum pipe velocity violation of the constraint
-    double observed_max_velocity = 0.0;
-	for (const auto& [id, pipe] : m__anytown->pipes())
-	{
-		for (const auto& vel : pipe.velocity().values())
-		{
-			if (vel > observed_max_velocity)
-			{
-				observed_max_velocity = vel;
-			}
-		}
-	}
+    const double observed_max_velocity = max_velocity.value();
 	auto velocity_violation = (observed_max_velocity <= anytown::max_velocity__m_per_s) ? 0.0 : (observed_max_velocity - anytown::max_velocity__m_per_s) / anytown::max_velocity__m_per_s;
 	
     // We must do the average of the violations because we want it to be at 0 when both are at 0.
@@ -373,39 +861,25 @@ auto Problem::fitness(
     
     if (total_violation > 0.0)
     {
-        // No need to do extra simulations, simply return the violation as this solution is not good.
-        reset_dv(dvs);
-        fitv[1] = total_violation;
-        return std::move(fitv);
+        outcome.penalty = total_violation;
+        return outcome;
     }
 
-    // We calculated anything we need for objective function 1 and 2 that is common between all formulations,
-    // Now, we need to specialize.
-    switch (m__formulation)
-    {
-    case Formulation::hr:
-        fitv[1] = -hydraulic_reliability_perspective();  // I want to maximize the reliability index
-        break;
-
-    case Formulation::mr:
-        fitv[1] = -mechanical_reliability_perspective();
-        break;
+    // Part C starts here, the hr perspective is already available.
+    outcome.penalty = std::nullopt;
+    if (a_resilience)
+        outcome.hydraulic_reliability = hydraulic_reliability_perspective(resilience);
 
-    case Formulation::fr:
-        fitv[1] = -firefighting_reliability_perspective();
-        break;
-    
-    default:
-        break;
-    }
-
-    reset_dv(dvs);
-    return std::move(fitv);
+    return outcome;
 }
 
-auto Problem::apply_dv(const std::vector<double>& dvs) const -> void
+auto Problem::apply_dv(
+    WDS& anytown,
+    const std::vector<double>& dvs,
+    std::unordered_map<std::string, double>& old_HW_coeffs
+) const -> void
 {
-    m__anytown->cache_indices();
+    anytown.cache_indices();
 
     // For each decision variable group (existing pipes, new pipes, etc)
     // Do the same operations:
@@ -418,8 +892,8 @@ auto Problem::apply_dv(const std::vector<double>& dvs) const -> void
     // 1. Existing pipes:
     gene_size = anytown::fep2::dv_size*anytown::exis_pipes__el_names.size();
     bevarmejo::anytown::fep2::apply_dv__exis_pipes(
-        *m__anytown,
-        __old_HW_coeffs,
+        anytown,
+        old_HW_coeffs,
         curr_dv,
         curr_dv+gene_size,
         anytown::exi_pipe_options
@@ -429,7 +903,7 @@ auto Problem::apply_dv(const std::vector<double>& dvs) const -> void
     // 2. New pipes
     gene_size = anytown::fnp1::dv_size*anytown::new_pipes__el_names.size();
     bevarmejo::anytown::fnp1::apply_dv__new_pipes(
-        *m__anytown,
+        anytown,
         curr_dv,
         curr_dv+gene_size,
         anytown::new_pipe_options
@@ -439,7 +913,7 @@ auto Problem::apply_dv(const std::vector<double>& dvs) const -> void
     // 3. Tanks
     gene_size = anytown::fnt3::dv_size*anytown::max_n_installable_tanks;
     bevarmejo::anytown::fnt3::apply_dv__tanks(
-        *m__anytown,
+        anytown,
         curr_dv,
         curr_dv+gene_size,
         anytown::tank_options,
@@ -452,80 +926,67 @@ auto Problem::apply_dv(const std::vector<double>& dvs) const -> void
     {
         gene_size = anytown::pgo_dv::size;
         anytown::pgo_dv::apply_dv__pumps(
-            *m__anytown,
+            anytown,
             curr_dv,
             curr_dv+gene_size
         );
         curr_dv += gene_size;
     }
+}
 
-    // In the firefighting case I have to apply the dvs also to the network used to simulate the fire events
-    if (m__formulation == Formulation::fr)
-    {
-        m__ff_anytown->cache_indices();
-        curr_dv = dvs.begin();
-
-        // 1. Existing pipes:
-        gene_size = anytown::fep2::dv_size*anytown::exis_pipes__el_names.size();
-        bevarmejo::anytown::fep2::apply_dv__exis_pipes(
-            *m__ff_anytown,
-            __old_HW_coeffs,
-            curr_dv,
-            curr_dv+gene_size,
-            anytown::exi_pipe_options
-        );
-        curr_dv += gene_size;
-        
-        // 2. New pipes
-        gene_size = anytown::fnp1::dv_size*anytown::new_pipes__el_names.size();
-        bevarmejo::anytown::fnp1::apply_dv__new_pipes(
-            *m__ff_anytown,
-            curr_dv,
-            curr_dv+gene_size,
-            anytown::new_pipe_options
-        );
-        curr_dv += gene_size;
-
-        // 3. Tanks
-        gene_size = anytown::fnt3::dv_size*anytown::max_n_installable_tanks;
-        bevarmejo::anytown::fnt3::apply_dv__tanks(
-            *m__ff_anytown,
-            curr_dv,
-            curr_dv+gene_size,
-            anytown::tank_options,
-            anytown::new_pipe_options
-        );
-        curr_dv += gene_size;
+auto Problem::apply_dv__fireflow(
+    WDS& ff_anytown,
+    const std::vector<double>& dvs,
+    std::unordered_map<std::string, double>& old_HW_coeffs
+) const -> void
+{
+    assertm(m__ff_anytown != nullptr, "This functions should be run only when the fireflow network is loaded");
 
-        // However, for the tanks, the min level must be moved to 0 so that we can simulate the fireflow events...
-        // For each tank in the temp elements, set the min level to 0 and then the min volume
-        // (EN doesn't change that automatically because it consider them independent)
-        m__ff_anytown->cache_indices();
-        auto& temp_elems = m__ff_anytown->id_sequence(label::__temp_elems);
-        for (std::size_t i = anytown::max_n_installable_tanks; i; --i)
-        {
-            auto new_tank_id = std::string("T")+std::to_string(i-1);
+    // In the firefighting case I have to apply the dvs also to the network used to simulate the fire events
+    ff_anytown.cache_indices();
 
-            if (temp_elems.contains(new_tank_id))
-            {
-                auto& tank = m__ff_anytown->tank(new_tank_id);
-                int errorcode = EN_setnodevalue(m__ff_anytown->ph(), tank.EN_index(), EN_MINLEVEL, 0.0);
-                assert(errorcode <= 100);
+    std::size_t gene_size = 0;
+    auto curr_dv = dvs.begin();
 
-                errorcode = EN_setnodevalue(m__ff_anytown->ph(), tank.EN_index(), EN_MINVOLUME, 0.0);
-                assert(errorcode <= 100);
+    // 1. Existing pipes:
+    gene_size = anytown::fep2::dv_size*anytown::exis_pipes__el_names.size();
+    bevarmejo::anytown::fep2::apply_dv__exis_pipes(
+        ff_anytown,
+        old_HW_coeffs,
+        curr_dv,
+        curr_dv+gene_size,
+        anytown::exi_pipe_options
+    );
+    curr_dv += gene_size;
+    
+    // 2. New pipes
+    gene_size = anytown::fnp1::dv_size*anytown::new_pipes__el_names.size();
+    bevarmejo::anytown::fnp1::apply_dv__new_pipes(
+        ff_anytown,
+        curr_dv,
+        curr_dv+gene_size,
+        anytown::new_pipe_options
+    );
+    curr_dv += gene_size;
 
-                tank.min_level(0.0);
-                tank.min_volume(0.0);
-            }
-        }
-    }
+    // 3. Tanks
+    gene_size = anytown::fnt3::dv_size*anytown::max_n_installable_tanks;
+    bevarmejo::anytown::fnt3::apply_dv__tanks(
+        ff_anytown,
+        curr_dv,
+        curr_dv+gene_size,
+        anytown::tank_options,
+        anytown::new_pipe_options
+    );
+    curr_dv += gene_size;
 
+    // However, for the tanks, the min level must be moved to 0 so that we can simulate the fireflow events...
+    lower_min_level__new_tanks(ff_anytown);
 }
 
-auto Problem::cost(const std::vector<double>& dvs) const -> double
+auto Problem::capital_cost(const WDS& anytown, const std::vector<double>& dvs) const -> double
 {
-    // Capital cost of interventions plus operational cost
+    // Capital cost of interventions
     double capital_cost = 0.0;
 	
 	std::size_t gene_size = 0;
@@ -534,27 +995,25 @@ auto Problem::cost(const std::vector<double>& dvs) const -> double
     // 1. Existing pipes:
     gene_size = anytown::fep2::dv_size*anytown::exis_pipes__el_names.size();
     capital_cost += bevarmejo::anytown::fep2::cost__exis_pipes(
-        *m__anytown,
+        m__pipes_cost_plan,
         curr_dv,
-        curr_dv+gene_size,
-        anytown::exi_pipe_options
+        curr_dv+gene_size
     );
     curr_dv += gene_size;
         
     // 2. New pipes
     gene_size = anytown::fnp1::dv_size*anytown::new_pipes__el_names.size();
     capital_cost += bevarmejo::anytown::fnp1::cost__new_pipes(
-        *m__anytown,
+        m__pipes_cost_plan,
         curr_dv,
-        curr_dv+gene_size,
-        anytown::new_pipe_options
+        curr_dv+gene_size
     );
     curr_dv += gene_size;
 
     // 3. Tanks
     gene_size = anytown::fnt3::dv_size*anytown::max_n_installable_tanks;
     capital_cost += bevarmejo::anytown::fnt3::cost__tanks(
-        *m__anytown,
+        anytown,
         curr_dv,
         curr_dv+gene_size,
         anytown::tank_options,
@@ -562,10 +1021,13 @@ auto Problem::cost(const std::vector<double>& dvs) const -> double
     );
     curr_dv += gene_size;
 
-    // No cost is associated with the fireflow condition and the "cost" of operations
-    // Is extracted as the energy cost of the network...
+    return capital_cost;
+}
 
-    double energy_cost_per_day = bevarmejo::anytown::pgo_dv::cost__energy_per_day(*m__anytown);
+auto Problem::cost(const double capital_cost, const double energy_cost_per_day) const -> double
+{
+    // No cost is associated with the fireflow condition and the "cost" of operations
+    // Is extracted as the energy cost of the network (accumulated during the EPS)...
 	double yearly_energy_cost = energy_cost_per_day * bevarmejo::k__days_ina_year;
 
     // NPV requires initial capital investment to be positive when exiting
@@ -579,26 +1041,23 @@ auto Problem::cost(const std::vector<double>& dvs) const -> double
 
 }
 
-auto Problem::hydraulic_reliability_perspective() const -> double
+auto Problem::hydraulic_reliability_perspective(const eval::metrics::OnlineResilienceIndex& a_resilience_index) const -> double
 {
-    assertm(m__formulation == Formulation::hr, "This functions should be run only for the hr formulation");
 
-    // All constraints are satisfied, now check the reliability index
-	const auto ir_daily = resilience_index_from_min_pressure(*m__anytown, bevarmejo::anytown::min_pressure__psi*MperFT/PSIperFT);
-	auto value = ir_daily.integrate_forward();
+    // All constraints are satisfied, now check the reliability index (accumulated during the EPS)
+	const auto& ir_daily = a_resilience_index.index();
+	auto value = ir_daily.integral();
 
-	value = ir_daily.back().first != 0 ? value / ir_daily.back().first : value;
+	value = ir_daily.duration() != 0 ? value / ir_daily.duration() : value;
 
     return value;
 }
 
-auto Problem::mechanical_reliability_perspective() const -> double
+auto Problem::mechanical_reliability_perspective(WDS& anytown) const -> double
 {
-    assertm(m__formulation == Formulation::mr, "This functions should be run only for the mr formulation");
-
     // We do the mr simulation, get the results and calculate the mechanical reliability estimator
     
-    const auto results = sim::solvers::epanet::solve_hydraulics(*m__anytown, m__mrsim__settings);
+    const auto results = sim::solvers::epanet::solve_hydraulics(anytown, m__mrsim__settings);
     
     // If it fails hard (> 100) or can't satisfy the pressures for some reasons (> 0)
     // We return minimum reliability (0.0)
@@ -609,7 +1068,7 @@ auto Problem::mechanical_reliability_perspective() const -> double
 
     // If it worked, we simply calculate and return the mre..
 
-    auto mre = eval::metrics::PaezFilion::mechanical_reliability_estimator(*m__anytown);
+    auto mre = eval::metrics::PaezFilion::mechanical_reliability_estimator(anytown);
 
     // if only one value, simply return that
     if (mre.back().first == 0)
@@ -620,97 +1079,192 @@ auto Problem::mechanical_reliability_perspective() const -> double
     return mre.integrate_forward()/ mre.back().first;
 }
 
-auto Problem::firefighting_reliability_perspective() const -> double
+auto Problem::firefighting_reliability_perspective(const std::vector<double>& dvs, const double a_cost, const bool a_prunable) const -> FireflowReliability
 {
-    assertm(m__formulation == Formulation::fr, "This functions should be run only for the fr formulation");
+    assertm(m__ff_anytown != nullptr, "This functions should be run only when the fireflow network is loaded");
 
     // We calculate the firefighting reliability as the expected value of the ratio of supply over demand.
     // Therefore for each scenario, we calculate the aggregated values of supply, integrate over time.
     // We are assuming equal probability for each scenario as Anytown doesn't provide this
     // data.
-    constexpr double pi = 1.0/anytown::fireflow_test_values.size();
-    // Because of these assumptions, we can calculate it in real time...
+    constexpr std::size_t n_scenarios = anytown::fireflow_test_values.size();
+    constexpr double pi = 1.0/n_scenarios;
     // Let's note that if a simulation fails, we regard the entire simulation as failed to not make the EA exploit weird behaviours that could emerge.
+    std::array<double, n_scenarios> supply_ratios{};
+
+    // Each scenario adds at most pi to the reliability, so the individual can
+    // not do better than the scenarios scored so far plus pi for each of the
+    // remaining ones. It is dominated if a solution of the archive, not more
+    // expensive, is already more reliable than that.
+    const auto threshold = (m__ff_archive && a_prunable) ?
+        m__ff_archive->best_f1_up_to(a_cost) : std::nullopt;
+
+    struct
+    {
+        std::mutex mutex;
+        double scored = 0.0; // Sum of the ratios of the scenarios done so far
+        std::size_t n_done = 0;
+        std::atomic<bool> pruned{false};
+    } progress;
+
+    const auto upper_bound = [&progress]() {
+        return (progress.scored + (n_scenarios - progress.n_done))*pi;
+    };
+
+    // The scenarios are independent, so they are split in strides, one per
+    // task. Every task brings the replica of its thread to the decision vector
+    // once and then simulates its scenarios on it. The network before the fire
+    // is the same for all the scenarios, so it is solved once per task and every
+    // scenario starts from there.
+    // The workers share the time budget of the evaluation.
+    const std::size_t n_tasks = m__ff_workers ? std::min(n_scenarios, m__ff_workers->size()) : 1;
+    const auto deadline = sim::solvers::epanet::DeadlineScope::current();
+    const auto simulate_stride = [&](std::size_t a_task)
+    {
+        auto deadline_scope = sim::solvers::epanet::DeadlineScope(deadline);
+        auto ff_anytown = m__ff_replicas->lease();
+        update_dv__fireflow(*ff_anytown, ff_anytown.applied_dv(), dvs);
+
+        const auto pre_event = sim::solvers::epanet::solve_initial_state(*ff_anytown, m__ffsim_settings);
+
+        for (std::size_t i = a_task; i < n_scenarios && !progress.pruned; i += n_tasks)
+        {
+            supply_ratios[i] = fireflow_scenario(*ff_anytown, i, pre_event);
+
+            if (!threshold)
+                continue;
+
+            std::lock_guard<std::mutex> lock(progress.mutex);
+            progress.scored += supply_ratios[i];
+            ++progress.n_done;
+            if (-upper_bound() > *threshold)
+                progress.pruned = true;
+        }
+    };
+
+    if (m__ff_workers)
+        m__ff_workers->parallel_for(n_tasks, simulate_stride);
+    else
+        simulate_stride(0);
+
+    if (progress.pruned)
+    {
+        m__ff_n_pruned->fetch_add(1, std::memory_order_relaxed);
+        return {upper_bound(), true};
+    }
+
+    // Reduced in the order of the scenarios, so the result does not depend on the threads.
     double ff_rel = 0.0;
-    
-    unsigned int ff_test_idx = 0;
-    for (const auto& ff_test : anytown::fireflow_test_values)
-    {
-        // 1. Apply the additional demand;
-        // 2. simulate;
-        // 3. extract the values of total supply and demand, add the contribution to the reliability;
-        // 4. remove the additional demand.
-
-        // Let's find where to apply it. We also assume that every Anytown node has 1 demand only (let's check to make sure we don't mess it up).
-        // This will also help us in removing the demand after the simulation.
-        auto ph = m__ff_anytown->ph();
-        auto& junc = m__ff_anytown->junction(std::string(ff_test.junction_name));
-        assert(junc.demands().size() == 1);
-        assert([&]() -> bool {
-            int n_demands = 0;
-            int errorcode = EN_getnumdemands(ph, junc.EN_index(), &n_demands);
-            return errorcode == 0 && n_demands == 1;  // Success code AND exactly one demand
-        }());
-
-        // Add a constand demand equal to the required fire flow.
-        // I don't have the interface to add the demand to my class yet.
-        int errorcode = EN_adddemand(ph, junc.EN_index(),
-            ff_test.flow__gpm, "", "beme_fireflow");
-
-        // 2. --------------------
-        const auto results = sim::solvers::epanet::solve_hydraulics(*m__ff_anytown, m__ffsim_settings);
-        if (!m__inp_base_filename.empty()) {
-            auto orig_filename_stem = fsys::path(m__ff_anytown_filename).stem().string();
-		
-	        auto out_file = fsys::current_path()/fsys::path(
-                m__inp_base_filename + 
-                bemeio::other::sep__beme_filenames +
-                orig_filename_stem +
-                bemeio::other::sep__beme_filenames +
-                "FF-" + std::string(ff_test.junction_name) + 
-                bemeio::other::sep__beme_filenames +
-                "0" +
-                bemeio::other::ext__inp
-            );
-
-            int errco = EN_saveinpfile(this->m__ff_anytown->ph_, out_file.string().c_str());
-            assert(errco <= 100);
-
-            bevarmejo::io::stream_out(std::cout,
-                "EPANET '.inp' file saved in: ",
-                out_file.string(),
-                "\n"
-            );
+    for (const auto ratio : supply_ratios)
+        ff_rel += pi*ratio;
+
+    return {ff_rel, false};
+}
+
+auto Problem::fireflow_scenario(
+    WDS& ff_anytown,
+    std::size_t a_scenario,
+    const std::optional<sim::solvers::epanet::HydCheckpoint>& a_pre_event
+) const -> double
+{
+    const auto& ff_test = anytown::fireflow_test_values[a_scenario];
+
+    // 1. Apply the additional demand;
+    // 2. simulate;
+    // 3. extract the values of total supply and demand;
+    // 4. remove the additional demand.
+
+    // Let's find where to apply it. We also assume that every Anytown node has 1 demand only (let's check to make sure we don't mess it up).
+    // This will also help us in removing the demand after the simulation.
+    auto ph = ff_anytown.ph();
+    auto& junc = ff_anytown.junction(std::string(ff_test.junction_name));
+    assert(junc.demands().size() == 1);
+    assert([&]() -> bool {
+        int n_demands = 0;
+        int errorcode = EN_getnumdemands(ph, junc.EN_index(), &n_demands);
+        return errorcode == 0 && n_demands == 1;  // Success code AND exactly one demand
+    }());
+
+    // Add a constand demand equal to the required fire flow.
+    // I don't have the interface to add the demand to my class yet.
+    int errorcode = EN_adddemand(ph, junc.EN_index(),
+        ff_test.flow__gpm, "", "beme_fireflow");
+
+    // 2. --------------------
+    // Without the state before the fire (EPANET failed on it), from scratch.
+    // The replica is used again, so the demand is removed also when the
+    // simulation runs out of time (solve_hydraulics has already closed the
+    // solver by then).
+    const auto results = [&]() {
+        try
+        {
+            return a_pre_event ?
+                sim::solvers::epanet::solve_hydraulics(ff_anytown, m__ffsim_settings, *a_pre_event) :
+                sim::solvers::epanet::solve_hydraulics(ff_anytown, m__ffsim_settings);
         }
-        
-        // 3. --------------------
-        // Extract the values, but only if it was actually fully feasible. Otherwise, highest penalty (aka + 0, aka do nothing)
-        // It should not happen because it is PDA, but anyway...
-        if (sim::solvers::epanet::is_successful(results))
+        catch (const sim::solvers::epanet::SimulationTimeout&)
         {
-            auto total_d = eval::metrics::total_water_demand(*m__ff_anytown);
-            auto total_c= eval::metrics::total_water_consumption(*m__ff_anytown);
-
-            ff_rel += pi*total_c.integrate_forward()/total_d.integrate_forward();
+            int errorcode = EN_deletedemand(ph, junc.EN_index(), 2);
+            assert(errorcode <= 100);
+            throw;
         }
+    }();
+    if (!m__inp_base_filename.empty()) {
+        auto orig_filename_stem = fsys::path(m__ff_anytown_filename).stem().string();
+	
+        auto out_file = fsys::current_path()/fsys::path(
+            m__inp_base_filename + 
+            bemeio::other::sep__beme_filenames +
+            orig_filename_stem +
+            bemeio::other::sep__beme_filenames +
+            "FF-" + std::string(ff_test.junction_name) + 
+            bemeio::other::sep__beme_filenames +
+            "0" +
+            bemeio::other::ext__inp
+        );
 
-        // 4. -------------------
-        // We just make sure in debug mode that it always adds it as the second one...
-        assert([&]() -> bool {
-            int dem_idx = 0;
-            int errorcode = EN_getdemandindex(ph, junc.EN_index(), "beme_fireflow", &dem_idx);
-            return errorcode == 0 && dem_idx == 2;
-        }());
-        errorcode = EN_deletedemand(ph, junc.EN_index(), 2);
-        assert(errorcode <= 100);
+        int errco = EN_saveinpfile(ff_anytown.ph_, out_file.string().c_str());
+        assert(errco <= 100);
+
+        bevarmejo::io::stream_out(std::cout,
+            "EPANET '.inp' file saved in: ",
+            out_file.string(),
+            "\n"
+        );
     }
+    
+    // 3. --------------------
+    // Extract the values, but only if it was actually fully feasible. Otherwise, highest penalty (aka 0)
+    // It should not happen because it is PDA, but anyway...
+    double ratio = 0.0;
+    if (sim::solvers::epanet::is_successful(results))
+    {
+        auto total_d = eval::metrics::total_water_demand(ff_anytown);
+        auto total_c= eval::metrics::total_water_consumption(ff_anytown);
 
-    return ff_rel;
+        ratio = total_c.integrate_forward()/total_d.integrate_forward();
+    }
+
+    // 4. -------------------
+    // We just make sure in debug mode that it always adds it as the second one...
+    assert([&]() -> bool {
+        int dem_idx = 0;
+        int errorcode = EN_getdemandindex(ph, junc.EN_index(), "beme_fireflow", &dem_idx);
+        return errorcode == 0 && dem_idx == 2;
+    }());
+    errorcode = EN_deletedemand(ph, junc.EN_index(), 2);
+    assert(errorcode <= 100);
+
+    return ratio;
 }
 
-auto Problem::reset_dv(const std::vector<double>& dvs) const -> void
+auto Problem::reset_dv(
+    WDS& anytown,
+    const std::vector<double>& dvs,
+    const std::unordered_map<std::string, double>& old_HW_coeffs
+) const -> void
 {
-    m__anytown->cache_indices();
+    anytown.cache_indices();
 
     std::size_t gene_size = 0;
     auto curr_dv = dvs.begin();
@@ -718,17 +1272,17 @@ auto Problem::reset_dv(const std::vector<double>& dvs) const -> void
     // 1. Existing pipes:
     gene_size = anytown::fep2::dv_size*anytown::exis_pipes__el_names.size();
     bevarmejo::anytown::fep2::reset_dv__exis_pipes(
-        *m__anytown,
+        anytown,
         curr_dv,
         curr_dv+gene_size,
-        __old_HW_coeffs
+        old_HW_coeffs
     );
     curr_dv += gene_size;
         
     // 2. New pipes
     gene_size = anytown::fnp1::dv_size*anytown::new_pipes__el_names.size();
     bevarmejo::anytown::fnp1::reset_dv__new_pipes(
-        *m__anytown,
+        anytown,
         curr_dv,
         curr_dv+gene_size
     );
@@ -737,7 +1291,7 @@ auto Problem::reset_dv(const std::vector<double>& dvs) const -> void
     // 3. Tanks
     gene_size = anytown::fnt3::dv_size*anytown::max_n_installable_tanks;
     bevarmejo::anytown::fnt3::reset_dv__tanks(
-        *m__anytown,
+        anytown,
         curr_dv,
         curr_dv+gene_size
     );
@@ -748,46 +1302,179 @@ auto Problem::reset_dv(const std::vector<double>& dvs) const -> void
     {
         gene_size = anytown::pgo_dv::size;
         bevarmejo::anytown::pgo_dv::reset_dv__pumps(
-            *m__anytown,
+            anytown,
             curr_dv,
             curr_dv+gene_size
         );
         curr_dv += gene_size;
     }
+}
 
-    if (m__formulation == Formulation::fr)
+auto Problem::reset_dv__fireflow(
+    WDS& ff_anytown,
+    const std::vector<double>& dvs,
+    const std::unordered_map<std::string, double>& old_HW_coeffs
+) const -> void
+{
+    assertm(m__ff_anytown != nullptr, "This functions should be run only when the fireflow network is loaded");
+
+    ff_anytown.cache_indices();
+
+    std::size_t gene_size = 0;
+    auto curr_dv = dvs.begin();
+
+    // 1. Existing pipes:
+    gene_size = anytown::fep2::dv_size*anytown::exis_pipes__el_names.size();
+    bevarmejo::anytown::fep2::reset_dv__exis_pipes(
+        ff_anytown,
+        curr_dv,
+        curr_dv+gene_size,
+        old_HW_coeffs
+    );
+    curr_dv += gene_size;
+    
+    // 2. New pipes
+    gene_size = anytown::fnp1::dv_size*anytown::new_pipes__el_names.size();
+    bevarmejo::anytown::fnp1::reset_dv__new_pipes(
+        ff_anytown,
+        curr_dv,
+        curr_dv+gene_size
+    );
+    curr_dv += gene_size;
+
+    // 3. Tanks
+    gene_size = anytown::fnt3::dv_size*anytown::max_n_installable_tanks;
+    bevarmejo::anytown::fnt3::reset_dv__tanks(
+        ff_anytown,
+        curr_dv,
+        curr_dv+gene_size
+    );
+    curr_dv += gene_size;
+}
+
+auto Problem::update_dv(
+    WDS& anytown,
+    std::vector<double>& applied_dvs,
+    const std::vector<double>& dvs
+) const -> void
+{
+    if (applied_dvs == dvs)
+        return;
+
+    if (applied_dvs.empty())
     {
-        m__ff_anytown->cache_indices();
-        curr_dv = dvs.begin();
+        std::unordered_map<std::string, double> old_HW_coeffs;
+        apply_dv(anytown, dvs, old_HW_coeffs);
+        applied_dvs = dvs;
+        return;
+    }
+    assert(applied_dvs.size() == dvs.size());
 
-        // 1. Existing pipes:
-        gene_size = anytown::fep2::dv_size*anytown::exis_pipes__el_names.size();
-        bevarmejo::anytown::fep2::reset_dv__exis_pipes(
-            *m__ff_anytown,
-            curr_dv,
-            curr_dv+gene_size,
-            __old_HW_coeffs
-        );
-        curr_dv += gene_size;
-        
-        // 2. New pipes
-        gene_size = anytown::fnp1::dv_size*anytown::new_pipes__el_names.size();
-        bevarmejo::anytown::fnp1::reset_dv__new_pipes(
-            *m__ff_anytown,
-            curr_dv,
-            curr_dv+gene_size
-        );
-        curr_dv += gene_size;
+    // Same order as apply_dv: existing pipes, new pipes, tanks, (operations).
+    const auto exis_begin = dvs.begin();
+    const auto new_begin = exis_begin + anytown::fep2::dv_size*anytown::exis_pipes__el_names.size();
+    const auto tanks_begin = new_begin + anytown::fnp1::dv_size*anytown::new_pipes__el_names.size();
+    const auto tanks_end = tanks_begin + anytown::fnt3::dv_size*anytown::max_n_installable_tanks;
+    const auto applied = [&](auto a_it) { return applied_dvs.cbegin() + (a_it - dvs.begin()); };
 
-        // 3. Tanks
-        gene_size = anytown::fnt3::dv_size*anytown::max_n_installable_tanks;
-        bevarmejo::anytown::fnt3::reset_dv__tanks(
-            *m__ff_anytown,
-            curr_dv,
-            curr_dv+gene_size
-        );
-        curr_dv += gene_size;
+    const bool exis_differ = !std::equal(exis_begin, new_begin, applied(exis_begin));
+    const bool tanks_differ = !std::equal(tanks_begin, tanks_end, applied(tanks_begin));
+
+    // Elements that are not pre-provisioned would be added or deleted, the
+    // indices of the others would shift: start again from the prototype state.
+    if ((!m__prov_dup_pipes && exis_differ) || (!m__prov_tanks && tanks_differ))
+    {
+        reset_dv(anytown, applied_dvs, m__exis_pipes_HW_coeffs);
+        applied_dvs.clear();
+
+        std::unordered_map<std::string, double> old_HW_coeffs;
+        apply_dv(anytown, dvs, old_HW_coeffs);
+        applied_dvs = dvs;
+        return;
+    }
+
+    anytown.cache_indices();
+
+    // 1. Existing pipes:
+    anytown::fep2::update_dv__exis_pipes(anytown, m__exis_pipes_HW_coeffs, applied(exis_begin), exis_begin, new_begin, anytown::exi_pipe_options);
+
+    // 2. New pipes
+    anytown::fnp1::update_dv__new_pipes(anytown, applied(new_begin), new_begin, tanks_begin, anytown::new_pipe_options);
+
+    // 3. Tanks, a slot depends on the others (same location), so they are all installed again.
+    if (tanks_differ)
+    {
+        anytown::fnt3::reset_dv__tanks(anytown, applied(tanks_begin), applied(tanks_end));
+        anytown::fnt3::apply_dv__tanks(anytown, tanks_begin, tanks_end, anytown::tank_options, anytown::new_pipe_options);
+    }
+
+    // (4.) Operations are optimized only in the hydraulic reliability and operational efficiency perspective
+    if (m__formulation == Formulation::hr)
+    {
+        anytown::pgo_dv::update_dv__pumps(anytown, applied(tanks_end), tanks_end, tanks_end+anytown::pgo_dv::size);
+    }
+
+    applied_dvs = dvs;
+}
+
+auto Problem::update_dv__fireflow(
+    WDS& ff_anytown,
+    std::vector<double>& applied_dvs,
+    const std::vector<double>& dvs
+) const -> void
+{
+    assertm(m__ff_anytown != nullptr, "This functions should be run only when the fireflow network is loaded");
+
+    if (applied_dvs == dvs)
+        return;
+
+    if (applied_dvs.empty())
+    {
+        std::unordered_map<std::string, double> old_HW_coeffs;
+        apply_dv__fireflow(ff_anytown, dvs, old_HW_coeffs);
+        applied_dvs = dvs;
+        return;
+    }
+    assert(applied_dvs.size() == dvs.size());
+
+    // The operations (if any) are not applied to the fireflow network.
+    const auto exis_begin = dvs.begin();
+    const auto new_begin = exis_begin + anytown::fep2::dv_size*anytown::exis_pipes__el_names.size();
+    const auto tanks_begin = new_begin + anytown::fnp1::dv_size*anytown::new_pipes__el_names.size();
+    const auto tanks_end = tanks_begin + anytown::fnt3::dv_size*anytown::max_n_installable_tanks;
+    const auto applied = [&](auto a_it) { return applied_dvs.cbegin() + (a_it - dvs.begin()); };
+
+    const bool exis_differ = !std::equal(exis_begin, new_begin, applied(exis_begin));
+    const bool tanks_differ = !std::equal(tanks_begin, tanks_end, applied(tanks_begin));
+
+    if ((!m__prov_dup_pipes && exis_differ) || (!m__prov_tanks && tanks_differ))
+    {
+        reset_dv__fireflow(ff_anytown, applied_dvs, m__ff_exis_pipes_HW_coeffs);
+        applied_dvs.clear();
+
+        std::unordered_map<std::string, double> old_HW_coeffs;
+        apply_dv__fireflow(ff_anytown, dvs, old_HW_coeffs);
+        applied_dvs = dvs;
+        return;
     }
+
+    ff_anytown.cache_indices();
+
+    // 1. Existing pipes:
+    anytown::fep2::update_dv__exis_pipes(ff_anytown, m__ff_exis_pipes_HW_coeffs, applied(exis_begin), exis_begin, new_begin, anytown::exi_pipe_options);
+
+    // 2. New pipes
+    anytown::fnp1::update_dv__new_pipes(ff_anytown, applied(new_begin), new_begin, tanks_begin, anytown::new_pipe_options);
+
+    // 3. Tanks, installed again and then emptied down to 0 as in apply_dv__fireflow.
+    if (tanks_differ)
+    {
+        anytown::fnt3::reset_dv__tanks(ff_anytown, applied(tanks_begin), applied(tanks_end));
+        anytown::fnt3::apply_dv__tanks(ff_anytown, tanks_begin, tanks_end, anytown::tank_options, anytown::new_pipe_options);
+        lower_min_level__new_tanks(ff_anytown);
+    }
+
+    applied_dvs = dvs;
 }
 
 auto Problem::get_bounds() const -> std::pair<std::vector<double>, std::vector<double>>
@@ -824,9 +1511,64 @@ auto to_json(Json& j, const bevarmejo::anytown_systol25::Problem& prob) -> void
 		
 	j[io::key::at_eps_inp()] = prob.m__anytown_filename;
 
-    if (prob.m__formulation == Formulation::fr)
+    if (prob.m__early_abort)
+    {
+        j[io::key::early_abort()] = prob.m__early_abort;
+    }
+
+    if (prob.m__prov_dup_pipes)
+    {
+        j[io::key::prov_dup_pipes()] = prob.m__prov_dup_pipes;
+    }
+
+    if (prob.m__prov_tanks)
+    {
+        j[io::key::prov_tanks()] = prob.m__prov_tanks;
+    }
+
+    if (prob.m__eps_checkpoints)
+    {
+        j[io::key::eps_checkpoints()] = prob.m__eps_checkpoints->capacity();
+    }
+
+    if (prob.fitness_cache() != nullptr)
+    {
+        j[bemeio::key::fitness_cache()] = prob.fitness_cache()->capacity();
+    }
+
+    if (prob.coarse_screening() != nullptr)
+    {
+        j[bemeio::key::coarse_screening()] = prob.coarse_screening()->config();
+    }
+
+    if (prob.surrogate() != nullptr)
+    {
+        j[bemeio::key::surrogate()] = prob.surrogate()->config();
+    }
+
+    if (prob.eval_budget__s() > 0.0)
+    {
+        j[bemeio::key::eval_budget()] = prob.eval_budget__s();
+    }
+
+    if (prob.m__perspectives != std::vector<Formulation>{prob.m__formulation})
+    {
+        j[io::key::perspectives()] = prob.perspectives();
+    }
+
+    if (prob.m__ff_anytown)
     {
         j[io::key::at_ff_inp()] = prob.m__ff_anytown_filename;
+
+        if (prob.m__ff_workers)
+        {
+            j[io::key::ff_threads()] = prob.m__ff_workers->size();
+        }
+
+        if (prob.m__ff_archive)
+        {
+            j[io::key::ff_pruning()] = true;
+        }
     }
 
 	j["extra_info"] = prob.get_extra_info();
@@ -15,12 +15,14 @@ namespace fsys = std::filesystem;
 #include "bevarmejo/hydraulic_functions.hpp"
 #include "bevarmejo/wds/water_distribution_system.hpp"
 
+#include "bevarmejo/io/keys/beme.hpp"
 #include "bevarmejo/utility/io.hpp"
 namespace bemeio = bevarmejo::io;
 
 #include "bevarmejo/wds/utility/epanet/en_help.hpp"
 
 #include "bevarmejo/simulation/solvers/epanet/hydraulic.hpp"
+#include "bevarmejo/evaluation/metrics/accumulators.hpp"
 
 
 
@@ -45,28 +47,28 @@ Problem::Problem(const Json& settings, const bemeio::Paths& lookup_paths)
     // Load from the constexpr array the IDs of the pipes that can be changed.
     m_hanoi->submit_id_sequence(label::__changeable_pipes, std::vector<std::string>(changeable_pipe_ids.begin(), changeable_pipe_ids.end()));
 
+    // The fitness is evaluated on per-thread replicas, m_hanoi stays untouched.
+    m__replicas = std::make_shared<WDSReplicaPool>(WDSReplicaPool::replicate(m_hanoi));
+
     // Compute the cost of the diameters of the pipes as it is constant and the most expensive operation as it requires the std::pow
     // I do it here to avoid doing it at every fitness evaluation
     for (auto i = 0u; i!= n_available_diams; ++i) {
         m_diams_cost[i] = a * std::pow(available_diams_in[i], b);
+        m_diams_mm[i] = available_diams_in[i]/12.*MperFT*1000.;
     }
 
-    m__name = name;
-    m__extra_info = extra_info;
-}
-
-std::vector<double> Problem::fitness(const std::vector<double>& dv) const {
-
-    // Apply the dv
-    apply_dv(*m_hanoi, dv);
-
-    // calculte the cost as it doesn't depend on any simulation
-    double cost = this->cost(dv);
-
-    // Calculate the reliability 
-    //     I need to run the sim first 
-    sim::solvers::epanet::HydSimSettings settings;
+    // Same for the pipes, so that cost and apply_dv don't search the network.
+    m_hanoi->cache_indices();
+    std::size_t i = 0;
+    for (auto&& [id, pipe] : m_hanoi->subnetwork_with_order<WDS::Pipe>(label::__changeable_pipes)) {
+        m_plan_EN_index[i] = pipe.EN_index();
+        for (std::size_t j = 0; j < n_available_diams; ++j)
+            m_plan_costs[i*n_available_diams+j] = m_diams_cost[j] * pipe.length().value();
+        ++i;
+    }
+    assert(i == n_dv);
 
+    // The simulation settings do not change from one evaluation to the next.
     long h_step = 0;
     int errorcode = EN_gettimeparam(m_hanoi->ph(), EN_HYDSTEP, &h_step);
     assert(errorcode < 100);
@@ -77,13 +79,72 @@ std::vector<double> Problem::fitness(const std::vector<double>& dv) const {
     errorcode = EN_gettimeparam(m_hanoi->ph(), EN_DURATION, &horizon);
     assert(errorcode < 100);
 
-	settings.resolution(h_step);
-	settings.report_resolution(r_step);
-	settings.horizon(horizon);
+    m_sim_settings.resolution(h_step);
+    m_sim_settings.report_resolution(r_step);
+    m_sim_settings.horizon(horizon);
+
+    // The resilience index and the pressure deficiency are computed while
+    // simulating, so the elements don't need to store any result.
+    m_sim_settings.results_profile(bevarmejo::epanet::ResultsProfile::none());
+
+    m__name = name;
+    m__extra_info = extra_info;
+
+    // Islands built from the same settings share the fitness already evaluated.
+    if (bemeio::key::fitness_cache.exists_in(settings)) {
+        enable_fitness_cache(
+            m__name + settings.dump(),
+            settings.at(bemeio::key::fitness_cache.as_in(settings)).get<std::size_t>()
+        );
+    }
+
+    // Optional: skip the candidates a surrogate predicts to be infeasible or dominated.
+    if (bemeio::key::surrogate.exists_in(settings)) {
+        enable_surrogate(settings.at(bemeio::key::surrogate.as_in(settings)).get<Surrogate::Config>());
+    }
+}
+
+std::vector<double> Problem::fitness(const std::vector<double>& dv) const {
+    // The decision vector of Hanoi has the same ordering in pagmo and beme.
+    return provisional_fitness([this, &dv]() {
+        return cached_fitness(dv, [this, &dv]() {
+            return surrogate_fitness(dv, [this, &dv]() { return evaluate(dv); });
+        });
+    });
+}
+
+std::vector<double> Problem::evaluate(const std::vector<double>& dv) const {
+
+    // Work on the network of this thread, so that fitness can be called concurrently.
+    auto hanoi = m__replicas->lease();
+
+    // Apply the dv, only the pipes that differ from the last evaluation on this replica
+    apply_dv(*hanoi, hanoi.applied_dv(), dv);
+
+    // calculte the cost as it doesn't depend on any simulation
+    double cost = this->cost(dv);
 
-	auto results = sim::solvers::epanet::solve_hydraulics(*m_hanoi, settings);
+    // Calculate the reliability 
+    //     I need to run the sim first 
+	auto resilience = eval::metrics::OnlineResilienceIndex(min_head_m);
+	auto pressure_deficit = eval::metrics::OnlinePressureDeficiency(min_head_m, /*relative=*/ true);
+
+	// Hanoi only changes the diameters, so the solver of the replica stays open
+	// from one evaluation to the next. Only the first step is used, thus a
+	// zero horizon is solved as a single steady state, without the EPS bookkeeping.
+	bool success = false;
+	if (m_sim_settings.horizon() == 0)
+	{
+		const int errorcode = sim::solvers::epanet::solve_snapshot(hanoi.session(), m_sim_settings, {resilience, pressure_deficit});
+		success = errorcode <= 100;
+	}
+	else
+	{
+		auto results = sim::solvers::epanet::solve_hydraulics(hanoi.session(), m_sim_settings, {resilience, pressure_deficit});
+		success = sim::solvers::epanet::is_successful_with_warnings(results);
+	}
 
-	if (!sim::solvers::epanet::is_successful_with_warnings(results))
+	if (!success)
 	{
 		bevarmejo::io::stream_out( std::cerr, "Error in the hydraulic simulation. \n");
 		// reset_dv(m__anytown, dvs);
@@ -92,11 +153,11 @@ std::vector<double> Problem::fitness(const std::vector<double>& dv) const {
 	}
     
     // Change sign as reliability needs to be maximized
-    double ir = resilience_index_from_min_pressure(*m_hanoi, min_head_m).when_t(0);
+    double ir = resilience.index().first();
     if (ir > 0.) // means it worked
         ir = -ir;
     else // penalty based on head deficit
-        ir = pressure_deficiency(*m_hanoi, min_head_m, /*relative=*/ true).when_t(0);
+        ir = pressure_deficit.deficiency().first();
 
     // Return the fitness
     return {cost, ir};
@@ -117,45 +178,38 @@ double Problem::cost(const std::vector<double>& dv) const
     // C sum_{i=0}^{n_pipe} (pipe_i = a * D_i^b * L_i)
 
     double value = 0.;
-    auto pipes = m_hanoi->subnetwork_with_order<WDS::Pipe>(label::__changeable_pipes);
-    auto itp = pipes.begin();
-    auto itd = dv.begin();
-    assert(pipes.size() == dv.size());
-    while (itp != pipes.end()) {
-        auto&& [id, pipe] = *itp;
-       
-        //C  +=   a * D_i^b                                  * L_i
-        value += m_diams_cost[static_cast<std::size_t>(*itd)] * pipe.length().value();
-
-        ++itp;
-        ++itd;
+    assert(dv.size() == n_dv);
+    for (std::size_t i = 0; i < n_dv; ++i) {
+        //C  +=   a * D_i^b * L_i (precomputed in the plan)
+        value += m_plan_costs[i*n_available_diams+static_cast<std::size_t>(dv[i])];
     }
     
     return value;
 }
 
-void Problem::apply_dv(WaterDistributionSystem& a_wds, const std::vector<double>& dv) const
+void Problem::apply_dv(WaterDistributionSystem& a_wds, std::vector<double>& a_applied_dv, const std::vector<double>& dv) const
 {
+    if (a_applied_dv == dv)
+        return;
+
     // Apply the decision variables to the network
     // I use the integer of the decision variable to choose the index of the diam 
     // from the available diameters. So between 0 and size of available diameters array.
-    a_wds.cache_indices();
-
-    auto pipes = a_wds.subnetwork_with_order<WDS::Pipe>(label::__changeable_pipes);
-    auto itp = pipes.begin();
-    auto itd = dv.begin();
-    assert(pipes.size() == dv.size());
-    while (itp != pipes.end()) {
-        double diam_mm = available_diams_in.at(static_cast<std::size_t>(*itd))/12.*MperFT*1000.;
-        auto&& [id, pipe] = *itp;
-
-        // unfortunatley I have to do the same in EPANET
-        int errco = 0;
-        errco = EN_setlinkvalue(a_wds.ph_, pipe.EN_index(), EN_DIAMETER, diam_mm);
-
-        ++itp;
-        ++itd;
+    // The EPANET indices come from the plan, no need to look for the pipes.
+    const bool all_pipes = a_applied_dv.empty();
+    assert(dv.size() == n_dv);
+    assert(all_pipes || a_applied_dv.size() == dv.size());
+    for (std::size_t i = 0; i < n_dv; ++i) {
+        if (!all_pipes && a_applied_dv[i] == dv[i])
+            continue;
+
+        double diam_mm = m_diams_mm.at(static_cast<std::size_t>(dv[i]));
+
+        int errco = EN_setlinkvalue(a_wds.ph_, m_plan_EN_index[i], EN_DIAMETER, diam_mm);
+        assert(errco <= 100);
     }
+
+    a_applied_dv = dv;
 }
     
 } // namespace fbiobj
@@ -0,0 +1,171 @@
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <utility>
+
+#include "bevarmejo/utility/exceptions.hpp"
+
+#include "bevarmejo/simulation/solvers/epanet/hyd_checkpoint.hpp"
+
+namespace bevarmejo::sim::solvers::epanet
+{
+
+namespace {
+
+// Finaliser of splitmix64, spreads the bits of the combined hash.
+constexpr auto mix(std::uint64_t x) noexcept -> std::uint64_t
+{
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebULL;
+    x ^= x >> 31;
+    return x;
+}
+
+} // namespace
+
+/*------- Member functions -------*/
+// (constructor)
+HydCheckpointCache::HydCheckpointCache(const time::Instant a_period__s, const std::size_t a_capacity) :
+    m__period__s(a_period__s),
+    m__capacity(a_capacity),
+    m__mutex(),
+    m__lru(),
+    m__index(),
+    m__stats()
+{
+    beme_throw_if(a_period__s <= 0, std::invalid_argument,
+        "Impossible to create the cache of the hydraulic checkpoints.",
+        "The period of the schedule must be a positive number.",
+        "Period: ", a_period__s);
+
+    beme_throw_if(a_capacity == 0, std::invalid_argument,
+        "Impossible to create the cache of the hydraulic checkpoints.",
+        "The capacity must be greater than zero.");
+}
+
+/*------- Element access -------*/
+auto HydCheckpointCache::period() const noexcept -> time::Instant
+{
+    return m__period__s;
+}
+
+auto HydCheckpointCache::find_longest(const std::vector<double>& a_design, const Schedule& a_schedule) -> std::pair<std::shared_ptr<const HydCheckpoint>, std::size_t>
+{
+    const auto design_hash = hash(a_design.begin(), a_design.end());
+
+    std::lock_guard<std::mutex> lock(m__mutex);
+
+    for (std::size_t k = a_schedule.size(); k; --k)
+    {
+        const auto h = hash(a_schedule.begin(), a_schedule.begin()+k, design_hash);
+        const auto it = find(h, a_design, a_schedule, k);
+        if (it == m__index.end())
+            continue;
+
+        m__lru.splice(m__lru.begin(), m__lru, it->second);
+        m__stats.resumed.fetch_add(1, std::memory_order_relaxed);
+        m__stats.periods_skipped.fetch_add(k, std::memory_order_relaxed);
+        return {it->second->checkpoint, k};
+    }
+
+    return {nullptr, 0};
+}
+
+auto HydCheckpointCache::contains(const std::vector<double>& a_design, const Schedule& a_schedule, const std::size_t a_prefix_size) const -> bool
+{
+    const auto h = hash(a_schedule.begin(), a_schedule.begin()+a_prefix_size, hash(a_design.begin(), a_design.end()));
+
+    std::lock_guard<std::mutex> lock(m__mutex);
+    return find(h, a_design, a_schedule, a_prefix_size) != m__index.end();
+}
+
+auto HydCheckpointCache::stats() const noexcept -> const Stats&
+{
+    return m__stats;
+}
+
+/*------- Capacity -------*/
+auto HydCheckpointCache::size() const -> std::size_t
+{
+    std::lock_guard<std::mutex> lock(m__mutex);
+    return m__lru.size();
+}
+
+auto HydCheckpointCache::capacity() const noexcept -> std::size_t
+{
+    return m__capacity;
+}
+
+/*------- Modifiers -------*/
+void HydCheckpointCache::insert(const std::vector<double>& a_design, const Schedule& a_schedule, const std::size_t a_prefix_size, std::shared_ptr<const HydCheckpoint> a_checkpoint)
+{
+    assert(a_prefix_size <= a_schedule.size());
+    const auto h = hash(a_schedule.begin(), a_schedule.begin()+a_prefix_size, hash(a_design.begin(), a_design.end()));
+
+    std::lock_guard<std::mutex> lock(m__mutex);
+
+    // Another thread may have simulated the same prefix in the meantime.
+    if (const auto it = find(h, a_design, a_schedule, a_prefix_size); it != m__index.end())
+    {
+        m__lru.splice(m__lru.begin(), m__lru, it->second);
+        return;
+    }
+
+    if (m__lru.size() >= m__capacity)
+    {
+        const auto& oldest = m__lru.back();
+        auto [ofirst, olast] = m__index.equal_range(oldest.hash);
+        for (auto it = ofirst; it != olast; ++it)
+        {
+            if (&*it->second == &oldest)
+            {
+                m__index.erase(it);
+                break;
+            }
+        }
+        m__lru.pop_back();
+    }
+
+    m__lru.push_front(Entry{h, a_design, Schedule(a_schedule.begin(), a_schedule.begin()+a_prefix_size), std::move(a_checkpoint)});
+    m__index.emplace(h, m__lru.begin());
+}
+
+auto HydCheckpointCache::find(const std::uint64_t a_hash, const std::vector<double>& a_design, const Schedule& a_schedule, const std::size_t a_prefix_size) const -> decltype(m__index)::const_iterator
+{
+    // Different keys may have the same hash, the match must be exact.
+    auto [first, last] = m__index.equal_range(a_hash);
+    for (auto it = first; it != last; ++it)
+    {
+        const auto& entry = *it->second;
+        if (entry.prefix.size() == a_prefix_size && entry.design == a_design &&
+            std::equal(entry.prefix.begin(), entry.prefix.end(), a_schedule.begin()))
+            return it;
+    }
+    return m__index.end();
+}
+
+/*------- Hash -------*/
+auto HydCheckpointCache::hash(std::vector<double>::const_iterator a_first, std::vector<double>::const_iterator a_last, std::uint64_t a_seed) noexcept -> std::uint64_t
+{
+    std::uint64_t h = mix(a_seed) ^ mix(static_cast<std::uint64_t>(a_last - a_first));
+    for (auto it = a_first; it != a_last; ++it)
+    {
+        double value = *it;
+        // +0.0 and -0.0 compare equal, so they must hash the same.
+        if (value == 0.0)
+            value = 0.0;
+
+        std::uint64_t bits = 0;
+        std::memcpy(&bits, &value, sizeof(bits));
+        h = mix(h ^ (bits + 0x9e3779b97f4a7c15ULL + (h << 6) + (h >> 2)));
+    }
+    return h;
+}
+
+} // namespace bevarmejo::sim::solvers::epanet
@@ -1,9 +1,15 @@
+#include <algorithm>
+#include <chrono>
+#include <functional>
 #include <memory>
+#include <optional>
+#include <vector>
 
 #include "epanet2_2.h"
 #include "types.h"
 
 #include "bevarmejo/utility/exceptions.hpp"
+#include "bevarmejo/wds/utility/epanet/results_buffer.hpp"
 
 #include "bevarmejo/simulation/hyd_sim_settings.hpp"
 #include "bevarmejo/simulation/solvers/epanet/hydraulic.hpp"
@@ -17,14 +23,16 @@ HydSimSettings::HydSimSettings() :
     inherited(),
     m__report_resolution__s(resolution() > horizon() ? resolution() : horizon()),
     m__wdm(std::make_unique<DemandDrivenAnalysis>()),
-    m__demand_multiplier(1.0)
+    m__demand_multiplier(1.0),
+    m__results_profile(bevarmejo::epanet::ResultsProfile::all())
 { }
 
 HydSimSettings::HydSimSettings(const HydSimSettings& other) :
     inherited(other),
     m__report_resolution__s(other.m__report_resolution__s),
     m__wdm(other.m__wdm ? other.m__wdm->clone() : nullptr),
-    m__demand_multiplier(other.m__demand_multiplier)
+    m__demand_multiplier(other.m__demand_multiplier),
+    m__results_profile(other.m__results_profile)
 { }
 
 HydSimSettings& HydSimSettings::operator=(const HydSimSettings& other)
@@ -34,6 +42,7 @@ HydSimSettings& HydSimSettings::operator=(const HydSimSettings& other)
         m__report_resolution__s = other.m__report_resolution__s;
         m__wdm = other.m__wdm ? other.m__wdm->clone() : nullptr;
         m__demand_multiplier = other.m__demand_multiplier;
+        m__results_profile = other.m__results_profile;
     }
     return *this;
 }
@@ -48,6 +57,11 @@ auto HydSimSettings::demand_multiplier() const noexcept -> double
     return m__demand_multiplier;
 }
 
+auto HydSimSettings::results_profile() const noexcept -> const bevarmejo::epanet::ResultsProfile&
+{
+    return m__results_profile;
+}
+
 auto HydSimSettings::report_resolution(time_t a_resolution) -> HydSimSettings&
 {
     beme_throw_if(a_resolution <= 0, std::invalid_argument,
@@ -94,6 +108,13 @@ auto HydSimSettings::demand_multiplier(double a_multiplier) -> HydSimSettings&
     return *this;
 }
 
+auto HydSimSettings::results_profile(const bevarmejo::epanet::ResultsProfile& a_profile) -> HydSimSettings&
+{
+    m__results_profile = a_profile;
+
+    return *this;
+}
+
 auto HydSimSettings::apply_water_demand_model(EN_Project a_ph) const -> void
 {
     // If uses DDA
@@ -133,17 +154,271 @@ auto HydSimSettings::apply_water_demand_model(EN_Project a_ph) const -> void
 
 }
 
+auto HydSimSettings::has_same_solver_setup(const HydSimSettings& other) const noexcept -> bool
+{
+    if (start_time() != other.start_time() ||
+        horizon() != other.horizon() ||
+        resolution() != other.resolution() ||
+        m__report_resolution__s != other.m__report_resolution__s ||
+        m__demand_multiplier != other.m__demand_multiplier)
+    {
+        return false;
+    }
+
+    const auto* pda = dynamic_cast<const PressureDrivenAnalysis*>(m__wdm.get());
+    const auto* other_pda = dynamic_cast<const PressureDrivenAnalysis*>(other.m__wdm.get());
+    if (pda == nullptr || other_pda == nullptr)
+    {
+        return pda == other_pda; // Both DDA
+    }
+
+    return pda->minimum_pressure__m() == other_pda->minimum_pressure__m() &&
+        pda->required_pressure__m() == other_pda->required_pressure__m() &&
+        pda->pressure_exponent() == other_pda->pressure_exponent();
+}
+
 // Forward declaration of the internal functions
 namespace detail
 {
 
+// Where the checkpoints of a simulation are looked up and saved.
+struct CheckpointContext
+{
+    HydCheckpointCache& cache;
+    const std::vector<double>& design;
+    const std::vector<double>& schedule;
+};
+
+void apply_settings(bevarmejo::WaterDistributionSystem& a_wds, const HydSimSettings& a_settings) noexcept;
 void prepare_internal_solver(bevarmejo::WaterDistributionSystem& a_wds, const HydSimSettings& a_settings) noexcept;
-void retrieve_results(const int errorcode, const time_t t, bevarmejo::WaterDistributionSystem& a_wds, HydSimResults& res);
+auto run_hydraulics(bevarmejo::WaterDistributionSystem& a_wds, const HydSimSettings& a_settings, const StepAccumulators& a_accumulators, const StepPredicate& a_should_stop, const CheckpointContext* a_checkpoints = nullptr) -> HydSimResults;
+void capture_solver_state(const bevarmejo::WaterDistributionSystem& a_wds, HydCheckpoint& a_checkpoint);
+void restore_solver_state(bevarmejo::WaterDistributionSystem& a_wds, const HydCheckpoint& a_checkpoint);
+auto capture_checkpoint(const bevarmejo::WaterDistributionSystem& a_wds, const HydSimResults& a_res, const StepAccumulators& a_accumulators) -> std::shared_ptr<HydCheckpoint>;
+void restore_checkpoint(bevarmejo::WaterDistributionSystem& a_wds, HydSimResults& a_res, const StepAccumulators& a_accumulators, const HydCheckpoint& a_checkpoint);
+void save_checkpoint(const bevarmejo::WaterDistributionSystem& a_wds, const HydSimResults& a_res, const StepAccumulators& a_accumulators, const CheckpointContext& a_checkpoints);
+void retrieve_results(const int errorcode, const time_t t, bevarmejo::WaterDistributionSystem& a_wds, HydSimResults& res, bevarmejo::epanet::ResultsBuffer& a_buffer, const StepAccumulators& a_accumulators);
 void release_internal_solver(bevarmejo::WaterDistributionSystem& a_wds) noexcept;
+void check_deadline();
 
 } // namespace detail
 
+namespace {
+
+thread_local DeadlineScope::Deadline tl_deadline;
+
+// Prepares the solver and releases it at the end of the scope, also when the
+// simulation throws (e.g., SimulationTimeout): EPANET refuses to add or delete
+// elements while the solver is open.
+class InternalSolverScope final
+{
+private:
+    bevarmejo::WaterDistributionSystem& m__wds;
+
+public:
+    InternalSolverScope(bevarmejo::WaterDistributionSystem& a_wds, const HydSimSettings& a_settings) noexcept :
+        m__wds(a_wds)
+    {
+        detail::prepare_internal_solver(m__wds, a_settings);
+    }
+
+    InternalSolverScope(const InternalSolverScope&) = delete;
+    InternalSolverScope& operator=(const InternalSolverScope&) = delete;
+
+    ~InternalSolverScope()
+    {
+        detail::release_internal_solver(m__wds);
+    }
+};
+
+} // namespace
+
+/*------- HydSimSession -------*/
+HydSimSession::HydSimSession(bevarmejo::WaterDistributionSystem& a_wds) noexcept :
+    m__wds(&a_wds),
+    m__applied_settings()
+{ }
+
+HydSimSession::~HydSimSession()
+{
+    close();
+}
+
+auto HydSimSession::wds() const noexcept -> bevarmejo::WaterDistributionSystem&
+{
+    return *m__wds;
+}
+
+auto HydSimSession::is_open() const noexcept -> bool
+{
+    auto ph = m__wds->ph();
+    return ph != nullptr && ph->hydraul.OpenHflag;
+}
+
+void HydSimSession::prepare(const HydSimSettings& a_settings)
+{
+    auto ph = m__wds->ph();
+    assert(ph != nullptr);
+
+    // The solver may have been closed from outside (e.g., a simulation without
+    // the session), in that case nothing can be assumed on the settings.
+    if (!is_open())
+    {
+        m__applied_settings.reset();
+
+        int errorcode = EN_openH(ph);
+        beme_throw_if_EN_error(errorcode,
+            "Impossible to open the hydraulic session.",
+            "Error originating from the EPANET API while opening the hydraulic solver.");
+    }
+
+    if (!m__applied_settings || !m__applied_settings->has_same_solver_setup(a_settings))
+    {
+        detail::apply_settings(*m__wds, a_settings);
+        m__applied_settings = a_settings;
+    }
+
+    // Re-initialise also the flows (10 = EN_INITFLOW without EN_SAVE, the
+    // results are read step by step and never written to the scratch file),
+    // so that every simulation starts from the same state it would have right
+    // after EN_openH.
+    int errorcode = EN_initH(ph, 10);
+    assert(errorcode <= 100);
+}
+
+void HydSimSession::close() noexcept
+{
+    if (is_open())
+    {
+        detail::release_internal_solver(*m__wds);
+    }
+    m__applied_settings.reset();
+}
+
+/*------- DeadlineScope -------*/
+DeadlineScope::DeadlineScope(const Deadline a_deadline) noexcept :
+    m__previous(tl_deadline)
+{
+    tl_deadline = a_deadline;
+}
+
+DeadlineScope::~DeadlineScope()
+{
+    tl_deadline = m__previous;
+}
+
+auto DeadlineScope::current() noexcept -> Deadline
+{
+    return tl_deadline;
+}
+
 auto solve_hydraulics(bevarmejo::WaterDistributionSystem& a_wds, const HydSimSettings& a_settings) -> HydSimResults
+{
+    return solve_hydraulics(a_wds, a_settings, StepAccumulators{});
+}
+
+auto solve_hydraulics(bevarmejo::WaterDistributionSystem& a_wds, const HydSimSettings& a_settings, const StepAccumulators& a_accumulators) -> HydSimResults
+{
+    return solve_hydraulics(a_wds, a_settings, a_accumulators, StepPredicate{});
+}
+
+auto solve_hydraulics(bevarmejo::WaterDistributionSystem& a_wds, const HydSimSettings& a_settings, const StepAccumulators& a_accumulators, const StepPredicate& a_should_stop) -> HydSimResults
+{
+    auto solver = InternalSolverScope(a_wds, a_settings);
+
+    return detail::run_hydraulics(a_wds, a_settings, a_accumulators, a_should_stop);
+}
+
+auto solve_hydraulics(bevarmejo::WaterDistributionSystem& a_wds, const HydSimSettings& a_settings, const StepAccumulators& a_accumulators, const StepPredicate& a_should_stop, HydCheckpointCache& a_cache, const std::vector<double>& a_design, const std::vector<double>& a_schedule) -> HydSimResults
+{
+    // The elements are not part of the checkpoints.
+    beme_throw_if(!a_settings.results_profile().empty(), std::invalid_argument,
+        "Impossible to simulate with the hydraulic checkpoints.",
+        "The settings must not store any result in the elements (ResultsProfile::none()).");
+
+    auto solver = InternalSolverScope(a_wds, a_settings);
+
+    const auto checkpoints = detail::CheckpointContext{a_cache, a_design, a_schedule};
+    return detail::run_hydraulics(a_wds, a_settings, a_accumulators, a_should_stop, &checkpoints);
+}
+
+auto solve_hydraulics(bevarmejo::WaterDistributionSystem& a_wds, const HydSimSettings& a_settings, const HydCheckpoint& a_initial_state) -> HydSimResults
+{
+    assert(a_initial_state.t == 0 && a_initial_state.results.empty());
+
+    auto solver = InternalSolverScope(a_wds, a_settings);
+
+    // The first step starts from the flows, heads and statuses of the state
+    // instead of the ones EN_initH gives.
+    detail::restore_solver_state(a_wds, a_initial_state);
+
+    return detail::run_hydraulics(a_wds, a_settings, {}, {});
+}
+
+auto solve_initial_state(bevarmejo::WaterDistributionSystem& a_wds, const HydSimSettings& a_settings) -> std::optional<HydCheckpoint>
+{
+    auto solver = InternalSolverScope(a_wds, a_settings);
+
+    // Only the first step, nothing is committed to the network.
+    long t = 0;
+    int errorcode = EN_runH(a_wds.ph(), &t);
+
+    auto state = std::optional<HydCheckpoint>{};
+    if (errorcode <= 100)
+    {
+        state.emplace();
+        detail::capture_solver_state(a_wds, *state);
+    }
+
+    return state;
+}
+
+auto solve_hydraulics(HydSimSession& a_session, const HydSimSettings& a_settings, const StepAccumulators& a_accumulators, const StepPredicate& a_should_stop) -> HydSimResults
+{
+    a_session.prepare(a_settings);
+
+    // The session stays open only after a complete simulation, a timeout must
+    // not leave the solver open on the network.
+    try
+    {
+        return detail::run_hydraulics(a_session.wds(), a_settings, a_accumulators, a_should_stop);
+    }
+    catch (...)
+    {
+        a_session.close();
+        throw;
+    }
+}
+
+auto solve_snapshot(HydSimSession& a_session, const HydSimSettings& a_settings, const StepAccumulators& a_accumulators) -> int
+{
+    a_session.prepare(a_settings);
+
+    auto& wds = a_session.wds();
+
+    auto accumulated_results = bevarmejo::epanet::ResultsProfile::none();
+    for (auto& acc : a_accumulators)
+    {
+        acc.get().reset(wds);
+        accumulated_results.merge(acc.get().required_results());
+    }
+    auto buffer = bevarmejo::epanet::ResultsBuffer(wds, bevarmejo::epanet::ResultsProfile::none(), accumulated_results);
+
+    time_t t = 0;
+    const int errorcode = EN_runH(wds.ph(), &t);
+    if (errorcode > 100)
+        return errorcode;
+
+    buffer.retrieve();
+    for (auto& acc : a_accumulators)
+    {
+        acc.get().accumulate(wds, buffer, t);
+    }
+
+    return errorcode;
+}
+
+auto detail::run_hydraulics(bevarmejo::WaterDistributionSystem& a_wds, const HydSimSettings& a_settings, const StepAccumulators& a_accumulators, const StepPredicate& a_should_stop, const CheckpointContext* a_checkpoints) -> HydSimResults
 {
     // Reset previous results and allocate memory for the new ones
     a_wds.clear_results();
@@ -155,7 +430,25 @@ auto solve_hydraulics(bevarmejo::WaterDistributionSystem& a_wds, const HydSimSet
 
     auto res = HydSimResults(a_wds.result_time_series());
 
-    detail::prepare_internal_solver(a_wds, a_settings);
+    // Columns for the results of all the elements, allocated once and reused
+    // at every hydraulic step.
+    // The accumulators may read quantities that the elements do not store.
+    auto accumulated_results = bevarmejo::epanet::ResultsProfile::none();
+    for (auto& acc : a_accumulators)
+    {
+        acc.get().reset(a_wds);
+        accumulated_results.merge(acc.get().required_results());
+    }
+    auto buffer = bevarmejo::epanet::ResultsBuffer(a_wds, a_settings.results_profile(), accumulated_results);
+
+    // Skip the periods already simulated by another individual with the same
+    // design and the same schedule so far.
+    if (a_checkpoints != nullptr)
+    {
+        const auto checkpoint = a_checkpoints->cache.find_longest(a_checkpoints->design, a_checkpoints->schedule).first;
+        if (checkpoint != nullptr)
+            detail::restore_checkpoint(a_wds, res, a_accumulators, *checkpoint);
+    }
 
     // Run the simulation
     time_t t = 0; // current time
@@ -163,6 +456,11 @@ auto solve_hydraulics(bevarmejo::WaterDistributionSystem& a_wds, const HydSimSet
 
     do
     {
+        // The state before solving the first step of a period is where the
+        // individuals sharing the schedule up to that period can resume from.
+        if (a_checkpoints != nullptr)
+            detail::save_checkpoint(a_wds, res, a_accumulators, *a_checkpoints);
+
         int errorcode = EN_runH(ph, &t);
 
 #if BEME_VERSION < 240401
@@ -178,7 +476,7 @@ auto solve_hydraulics(bevarmejo::WaterDistributionSystem& a_wds, const HydSimSet
         {
 #endif
         // Retrieve_results guarantees that all results were written or none.
-        detail::retrieve_results(errorcode, t, a_wds, res);
+        detail::retrieve_results(errorcode, t, a_wds, res, buffer, a_accumulators);
 
         // In early termination mode, a warning is sufficient to stop the simulation.
         // (This may be useful to save some runtime for very bad solutions.)
@@ -188,17 +486,24 @@ auto solve_hydraulics(bevarmejo::WaterDistributionSystem& a_wds, const HydSimSet
             break;
         }
 
+        // The caller may already know the outcome from the steps simulated so far.
+        if (a_should_stop && a_should_stop(a_wds, buffer, t))
+        {
+            break;
+        }
+
 #if BEME_VERSION < 240401
         }
 #endif
+
+        // Some networks take very long to converge, give up once out of time.
+        detail::check_deadline();
       
         errorcode = EN_nextH(ph, &delta_t);
         assert(errorcode < 100);
     }
     while (delta_t > 0);
 
-    detail::release_internal_solver(a_wds);
-
     return res;
 }
 
@@ -228,7 +533,7 @@ auto is_successful_with_warnings(const HydSimResults& a_result) noexcept -> bool
     return true;
 }
 
-auto detail::prepare_internal_solver(bevarmejo::WaterDistributionSystem& a_wds, const HydSimSettings& a_settings) noexcept -> void
+auto detail::apply_settings(bevarmejo::WaterDistributionSystem& a_wds, const HydSimSettings& a_settings) noexcept -> void
 {
     auto ph = a_wds.ph();
     assert(ph != nullptr);
@@ -250,15 +555,27 @@ auto detail::prepare_internal_solver(bevarmejo::WaterDistributionSystem& a_wds,
 
     errorcode = EN_setoption(ph, EN_DEMANDMULT, a_settings.demand_multiplier());
     assert(errorcode <= 100);
+}
+
+auto detail::prepare_internal_solver(bevarmejo::WaterDistributionSystem& a_wds, const HydSimSettings& a_settings) noexcept -> void
+{
+    auto ph = a_wds.ph();
+    assert(ph != nullptr);
+
+    // A HydSimSession may have left the solver open on this network.
+    if (ph->hydraul.OpenHflag)
+        detail::release_internal_solver(a_wds);
+
+    detail::apply_settings(a_wds, a_settings);
     
-    errorcode = EN_openH(ph);
+    int errorcode = EN_openH(ph);
     assert(errorcode <= 100);
     
     errorcode = EN_initH(ph, 10);
     assert(errorcode <= 100);
 }
 
-void detail::retrieve_results(const int errorcode, const time_t t, bevarmejo::WaterDistributionSystem& a_wds, HydSimResults& res)
+void detail::retrieve_results(const int errorcode, const time_t t, bevarmejo::WaterDistributionSystem& a_wds, HydSimResults& res, bevarmejo::epanet::ResultsBuffer& a_buffer, const StepAccumulators& a_accumulators)
 {
     // First we need to add the time to the time series of results.
     // Then I can add the value to all the QuantitySeries linked to that result.
@@ -266,14 +583,24 @@ void detail::retrieve_results(const int errorcode, const time_t t, bevarmejo::Wa
 
     res.commit(t, errorcode);
 
+    // Get each quantity for the whole network in one go, then each element 
+    // just picks its values from the columns.
+    a_buffer.retrieve();
+
     for (auto&& [id, node] : a_wds.nodes())
     {
-        node.retrieve_EN_results();
+        node.retrieve_EN_results(a_buffer);
     }
 
     for (auto&& [id, link] : a_wds.links())
     {
-        link.retrieve_EN_results();
+        link.retrieve_EN_results(a_buffer);
+    }
+
+    // Online metrics read the same columns, no second pass over the elements.
+    for (auto& acc : a_accumulators)
+    {
+        acc.get().accumulate(a_wds, a_buffer, t);
     }
 
     // TODO: check that all results were actually retrieve, some try catch blocks and noexcept this function.
@@ -281,6 +608,119 @@ void detail::retrieve_results(const int errorcode, const time_t t, bevarmejo::Wa
     return;
 }
 
+auto detail::capture_checkpoint(const bevarmejo::WaterDistributionSystem& a_wds, const HydSimResults& a_res, const StepAccumulators& a_accumulators) -> std::shared_ptr<HydCheckpoint>
+{
+    auto checkpoint = std::make_shared<HydCheckpoint>();
+    detail::capture_solver_state(a_wds, *checkpoint);
+
+    for (const auto& [t, v] : a_res)
+        checkpoint->results.emplace_back(t, v);
+
+    checkpoint->accumulators.reserve(a_accumulators.size());
+    for (const auto& acc : a_accumulators)
+        checkpoint->accumulators.push_back(acc.get().save_state());
+
+    return checkpoint;
+}
+
+void detail::restore_checkpoint(bevarmejo::WaterDistributionSystem& a_wds, HydSimResults& a_res, const StepAccumulators& a_accumulators, const HydCheckpoint& a_checkpoint)
+{
+    assert(a_checkpoint.accumulators.size() == a_accumulators.size());
+
+    for (const auto& [t, v] : a_checkpoint.results)
+    {
+        a_wds.result_time_series().commit(t);
+        a_res.commit(t, v);
+    }
+
+    detail::restore_solver_state(a_wds, a_checkpoint);
+
+    // The accumulators have already been reset (bound to this network).
+    for (std::size_t i = 0; i < a_accumulators.size(); ++i)
+        a_accumulators[i].get().restore_state(a_checkpoint.accumulators[i]);
+}
+
+void detail::capture_solver_state(const bevarmejo::WaterDistributionSystem& a_wds, HydCheckpoint& a_checkpoint)
+{
+    auto ph = a_wds.ph();
+    const auto& net = ph->network;
+    const auto& hyd = ph->hydraul;
+
+    a_checkpoint.t = ph->times.Htime;
+    a_checkpoint.next_report_t = ph->times.Rtime;
+
+    const auto n_nodes = net.Nnodes+1;
+    a_checkpoint.node_heads.assign(hyd.NodeHead, hyd.NodeHead+n_nodes);
+    a_checkpoint.node_demands.assign(hyd.NodeDemand, hyd.NodeDemand+n_nodes);
+    a_checkpoint.node_full_demands.assign(hyd.FullDemand, hyd.FullDemand+n_nodes);
+    a_checkpoint.node_demand_flows.assign(hyd.DemandFlow, hyd.DemandFlow+n_nodes);
+    a_checkpoint.node_emitter_flows.assign(hyd.EmitterFlow, hyd.EmitterFlow+n_nodes);
+
+    const auto n_links = net.Nlinks+1;
+    a_checkpoint.link_flows.assign(hyd.LinkFlow, hyd.LinkFlow+n_links);
+    a_checkpoint.link_settings.assign(hyd.LinkSetting, hyd.LinkSetting+n_links);
+    a_checkpoint.link_status.assign(hyd.LinkStatus, hyd.LinkStatus+n_links);
+    a_checkpoint.link_old_status.assign(hyd.OldStatus, hyd.OldStatus+n_links+net.Ntanks);
+
+    a_checkpoint.tank_volumes.resize(net.Ntanks+1);
+    for (int i = 1; i <= net.Ntanks; ++i)
+        a_checkpoint.tank_volumes[i] = net.Tank[i].V;
+}
+
+void detail::restore_solver_state(bevarmejo::WaterDistributionSystem& a_wds, const HydCheckpoint& a_checkpoint)
+{
+    auto ph = a_wds.ph();
+    auto& net = ph->network;
+    auto& hyd = ph->hydraul;
+
+    // Same network as the one of the checkpoint.
+    assert(a_checkpoint.node_heads.size() == static_cast<std::size_t>(net.Nnodes+1));
+    assert(a_checkpoint.link_flows.size() == static_cast<std::size_t>(net.Nlinks+1));
+    assert(a_checkpoint.tank_volumes.size() == static_cast<std::size_t>(net.Ntanks+1));
+
+    ph->times.Htime = a_checkpoint.t;
+    ph->times.Rtime = a_checkpoint.next_report_t;
+
+    std::copy(a_checkpoint.node_heads.begin(), a_checkpoint.node_heads.end(), hyd.NodeHead);
+    std::copy(a_checkpoint.node_demands.begin(), a_checkpoint.node_demands.end(), hyd.NodeDemand);
+    std::copy(a_checkpoint.node_full_demands.begin(), a_checkpoint.node_full_demands.end(), hyd.FullDemand);
+    std::copy(a_checkpoint.node_demand_flows.begin(), a_checkpoint.node_demand_flows.end(), hyd.DemandFlow);
+    std::copy(a_checkpoint.node_emitter_flows.begin(), a_checkpoint.node_emitter_flows.end(), hyd.EmitterFlow);
+
+    std::copy(a_checkpoint.link_flows.begin(), a_checkpoint.link_flows.end(), hyd.LinkFlow);
+    std::copy(a_checkpoint.link_settings.begin(), a_checkpoint.link_settings.end(), hyd.LinkSetting);
+    for (std::size_t i = 0; i < a_checkpoint.link_status.size(); ++i)
+        hyd.LinkStatus[i] = static_cast<StatusType>(a_checkpoint.link_status[i]);
+    for (std::size_t i = 0; i < a_checkpoint.link_old_status.size(); ++i)
+        hyd.OldStatus[i] = static_cast<StatusType>(a_checkpoint.link_old_status[i]);
+
+    for (int i = 1; i <= net.Ntanks; ++i)
+        net.Tank[i].V = a_checkpoint.tank_volumes[i];
+}
+
+void detail::save_checkpoint(const bevarmejo::WaterDistributionSystem& a_wds, const HydSimResults& a_res, const StepAccumulators& a_accumulators, const CheckpointContext& a_checkpoints)
+{
+    const time_t t = a_wds.ph()->times.Htime;
+    const time_t period = a_checkpoints.cache.period();
+    if (t == 0 || t % period != 0)
+        return;
+
+    const auto n_periods = static_cast<std::size_t>(t/period);
+    if (n_periods > a_checkpoints.schedule.size() ||
+        a_checkpoints.cache.contains(a_checkpoints.design, a_checkpoints.schedule, n_periods))
+        return;
+
+    a_checkpoints.cache.insert(a_checkpoints.design, a_checkpoints.schedule, n_periods,
+        detail::capture_checkpoint(a_wds, a_res, a_accumulators));
+}
+
+void detail::check_deadline()
+{
+    beme_throw_if(tl_deadline && DeadlineScope::Clock::now() > *tl_deadline, SimulationTimeout,
+        "Impossible to complete the hydraulic simulation.",
+        "The deadline of the simulation has passed.");
+}
+
 auto detail::release_internal_solver(bevarmejo::WaterDistributionSystem& a_wds) noexcept -> void
 {
     auto ph = a_wds.ph();
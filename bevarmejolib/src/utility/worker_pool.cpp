@@ -0,0 +1,143 @@
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+#include "worker_pool.hpp"
+
+namespace bevarmejo {
+
+namespace {
+
+// Pool the current thread works for, if any (to detect nested calls).
+thread_local const WorkerPool* tl__current_pool = nullptr;
+
+} // namespace
+
+/*------- Member functions -------*/
+// (constructor)
+WorkerPool::WorkerPool(std::size_t a_n_workers) :
+    m__workers(),
+    m__mutex(),
+    m__cv(),
+    m__jobs(),
+    m__stop(false)
+{
+    if (a_n_workers == 0)
+        a_n_workers = std::max(1u, std::thread::hardware_concurrency());
+
+    m__workers.reserve(a_n_workers);
+    for (std::size_t i = 0; i < a_n_workers; ++i)
+        m__workers.emplace_back([this]() { work(); });
+}
+
+// (destructor)
+WorkerPool::~WorkerPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(m__mutex);
+        m__stop = true;
+    }
+    m__cv.notify_all();
+
+    for (auto& worker : m__workers)
+        worker.join();
+}
+
+/*------- Capacity -------*/
+auto WorkerPool::size() const noexcept -> std::size_t
+{
+    return m__workers.size();
+}
+
+/*------- Operations -------*/
+void WorkerPool::parallel_for(std::size_t a_n_tasks, const Task& a_task)
+{
+    if (a_n_tasks == 0)
+        return;
+
+    if (tl__current_pool == this || a_n_tasks == 1)
+    {
+        for (std::size_t i = 0; i < a_n_tasks; ++i)
+            a_task(i);
+        return;
+    }
+
+    // Shared by the jobs of this call, it lives on this stack as we wait for
+    // all of them before returning.
+    struct Batch
+    {
+        std::atomic<std::size_t> next{0};
+        std::atomic<bool> failed{false};
+        std::mutex mutex;
+        std::condition_variable cv;
+        std::size_t n_running = 0;
+        std::exception_ptr error;
+    } batch;
+
+    const std::size_t n_jobs = std::min(a_n_tasks, size());
+    batch.n_running = n_jobs;
+
+    auto job = [&batch, &a_task, a_n_tasks]()
+    {
+        for (auto i = batch.next++; i < a_n_tasks && !batch.failed; i = batch.next++)
+        {
+            try
+            {
+                a_task(i);
+            }
+            catch (...)
+            {
+                std::lock_guard<std::mutex> lock(batch.mutex);
+                if (!batch.error)
+                    batch.error = std::current_exception();
+                batch.failed = true;
+            }
+        }
+
+        std::lock_guard<std::mutex> lock(batch.mutex);
+        --batch.n_running;
+        batch.cv.notify_one();
+    };
+
+    {
+        std::lock_guard<std::mutex> lock(m__mutex);
+        for (std::size_t j = 0; j < n_jobs; ++j)
+            m__jobs.emplace_back(job);
+    }
+    m__cv.notify_all();
+
+    std::unique_lock<std::mutex> lock(batch.mutex);
+    batch.cv.wait(lock, [&batch]() { return batch.n_running == 0; });
+
+    if (batch.error)
+        std::rethrow_exception(batch.error);
+}
+
+void WorkerPool::work()
+{
+    tl__current_pool = this;
+
+    while (true)
+    {
+        std::function<void ()> job;
+        {
+            std::unique_lock<std::mutex> lock(m__mutex);
+            m__cv.wait(lock, [this]() { return m__stop || !m__jobs.empty(); });
+
+            if (m__stop && m__jobs.empty())
+                return;
+
+            job = std::move(m__jobs.front());
+            m__jobs.pop_front();
+        }
+        job();
+    }
+}
+
+} // namespace bevarmejo
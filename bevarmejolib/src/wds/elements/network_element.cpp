@@ -2,6 +2,7 @@
 
 #include "bevarmejo/wds/utility/quantity_series.hpp"
 #include "bevarmejo/wds/element.hpp"
+#include "bevarmejo/wds/utility/epanet/results_buffer.hpp"
 #include "bevarmejo/wds/water_distribution_system.hpp"
 
 #include "elements/network_element.hpp"
@@ -26,4 +27,9 @@ void NetworkElement::retrieve_EN_results()
     // and knowing that all other properties are already retrieved.  
 }
 
+void NetworkElement::retrieve_EN_results(const epanet::ResultsBuffer& a_results)
+{
+    // User-defined results are not part of the columns, see above.
+}
+
 } // namespace bevarmejo::wds
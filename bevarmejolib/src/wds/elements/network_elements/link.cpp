@@ -5,6 +5,7 @@
 #include "types.h"
 
 #include "bevarmejo/wds/utility/epanet/en_help.hpp"
+#include "bevarmejo/wds/utility/epanet/results_buffer.hpp"
 
 #include "bevarmejo/utility/exceptions.hpp"
 
@@ -141,6 +142,26 @@ void Link::__retrieve_EN_results()
     m__flow.commit(t, val);
 }
 
+void Link::retrieve_EN_results(const epanet::ResultsBuffer& a_results)
+{
+    inherited::retrieve_EN_results(a_results);
+
+    this->__retrieve_EN_results(a_results);
+}
+
+void Link::__retrieve_EN_results(const epanet::ResultsBuffer& a_results)
+{
+    assert(m__en_index != 0);
+
+    using Q = epanet::ResultsBuffer::LinkQuantity;
+    if (!a_results.records(this->type_code(), epanet::ResultsProfile::Quantity::Flow))
+        return;
+
+    auto t = m__wds.current_result_time();
+
+    m__flow.commit(t, a_results.link(Q::Flow, m__en_index));
+}
+
 void Link::from_node(Node_ptr a_node)
 {
     m__from_node = a_node;
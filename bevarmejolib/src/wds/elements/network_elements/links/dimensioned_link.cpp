@@ -5,6 +5,7 @@
 #include "types.h"
 
 #include "bevarmejo/wds/utility/epanet/en_help.hpp"
+#include "bevarmejo/wds/utility/epanet/results_buffer.hpp"
 
 #include "bevarmejo/utility/exceptions.hpp"
 
@@ -138,4 +139,24 @@ void DimensionedLink::__retrieve_EN_results()
     m__velocity.commit(t, val);
 }
 
+void DimensionedLink::retrieve_EN_results(const epanet::ResultsBuffer& a_results)
+{
+    inherited::retrieve_EN_results(a_results);
+
+    this->__retrieve_EN_results(a_results);
+}
+
+void DimensionedLink::__retrieve_EN_results(const epanet::ResultsBuffer& a_results)
+{
+    assert(m__en_index > 0);
+
+    using Q = epanet::ResultsBuffer::LinkQuantity;
+    if (!a_results.records(this->type_code(), epanet::ResultsProfile::Quantity::Velocity))
+        return;
+
+    auto t = m__wds.current_result_time();
+
+    m__velocity.commit(t, a_results.link(Q::Velocity, m__en_index));
+}
+
 } // namespace bevarmejo::wds
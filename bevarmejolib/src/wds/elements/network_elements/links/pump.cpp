@@ -5,6 +5,7 @@
 #include "epanet2_2.h"
 
 #include "bevarmejo/wds/utility/epanet/en_help.hpp"
+#include "bevarmejo/wds/utility/epanet/results_buffer.hpp"
 
 #include "bevarmejo/utility/exceptions.hpp"
 
@@ -200,4 +201,28 @@ void Pump::__retrieve_EN_results()
     // // Efficiency is dimensionless
 }
 
+void Pump::retrieve_EN_results(const epanet::ResultsBuffer& a_results)
+{
+    inherited::retrieve_EN_results(a_results);
+
+    this->__retrieve_EN_results(a_results);
+}
+
+void Pump::__retrieve_EN_results(const epanet::ResultsBuffer& a_results)
+{
+    assert(m__en_index > 0);
+
+    using Q = epanet::ResultsBuffer::LinkQuantity;
+    using P = epanet::ResultsProfile::Quantity;
+    auto t = m__wds.current_result_time();
+    const auto code = this->type_code();
+
+    if (a_results.records(code, P::Energy))
+        m__instant_energy.commit(t, a_results.link(Q::Energy, m__en_index));
+    if (a_results.records(code, P::State))
+        m__state.commit(t, static_cast<int>(a_results.link(Q::Status, m__en_index)));
+    if (a_results.records(code, P::Efficiency))
+        m__efficiency.commit(t, a_results.link(Q::Efficiency, m__en_index));
+}
+
 } // namespace bevarmejo::wds
@@ -8,6 +8,8 @@
 #include "epanet2_2.h"
 #include "types.h"
 
+#include "bevarmejo/wds/utility/epanet/results_buffer.hpp"
+
 #include "bevarmejo/wds/element.hpp"
 #include "bevarmejo/wds/elements/network_element.hpp"
 #include "bevarmejo/wds/elements/network_elements/link.hpp"
@@ -207,6 +209,30 @@ void Node::__retrieve_EN_results()
     m__pressure.commit(t, val);
 }
 
+void Node::retrieve_EN_results(const epanet::ResultsBuffer& a_results)
+{
+    inherited::retrieve_EN_results(a_results);
+
+    this->__retrieve_EN_results(a_results);
+}
+
+void Node::__retrieve_EN_results(const epanet::ResultsBuffer& a_results)
+{
+    assert(m__en_index > 0);
+
+    using Q = epanet::ResultsBuffer::NodeQuantity;
+    using P = epanet::ResultsProfile::Quantity;
+    auto t = m__wds.current_result_time();
+    const auto code = this->type_code();
+
+    if (a_results.records(code, P::Head))
+        m__head.commit(t, a_results.node(Q::Head, m__en_index));
+    if (a_results.records(code, P::Outflow))
+        m__outflow.commit(t, a_results.node(Q::Outflow, m__en_index));
+    if (a_results.records(code, P::Pressure))
+        m__pressure.commit(t, a_results.node(Q::Pressure, m__en_index));
+}
+
 void Node::x_coord(double a_x_coord)
 {
     m__x_coord = a_x_coord;
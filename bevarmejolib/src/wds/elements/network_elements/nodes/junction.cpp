@@ -1,11 +1,13 @@
 #include <cassert>
 #include <string>
 #include <unordered_map>
+#include <utility>
 
 #include "epanet2_2.h"
 #include "types.h"
 
 #include "bevarmejo/wds/utility/epanet/en_help.hpp"
+#include "bevarmejo/wds/utility/epanet/results_buffer.hpp"
 
 #include "bevarmejo/wds/elements/pattern.hpp"
 #include "bevarmejo/wds/utility/quantity_series.hpp"
@@ -91,6 +93,22 @@ auto Junction::demand_undelivered() const -> const FlowSeries&
     return m__undelivered_demand;
 }
 
+auto Junction::demand_requested(const epanet::ResultsBuffer& a_results) const -> double
+{
+    assert(m__en_index > 0);
+
+    using Q = epanet::ResultsBuffer::NodeQuantity;
+    const auto [consumption, undelivered] = this->__split_EN_outflow(
+        a_results.node(Q::Outflow, m__en_index),
+        a_results.node(Q::Head, m__en_index),
+        a_results.node(Q::DemandDeficit, m__en_index),
+        a_results.node(Q::EmitterFlow, m__en_index),
+        a_results.node(Q::LeakageFlow, m__en_index)
+    );
+
+    return consumption + undelivered;
+}
+
 /*------- Capacity -------*/
 
 /*------- Modifiers -------*/
@@ -199,11 +217,11 @@ void Junction::__retrieve_EN_results()
         "Junction ID: ", m__name);
     emitter_flow = epanet::convert_flow_to_L_per_s(ph, emitter_flow);
 
+    double leakage_flow = 0.0;
 #if BEME_VERSION >= 250200
     // After v25.02.00 we started using a new EPANET version (Commit at 2024/07/12).
     // This new version allows to retireve a couple more info from the API.
     // Mainly the leakage and the ...
-    double leakage_flow = 0.0;
     errorcode = EN_getnodevalue(ph, m__en_index, EN_LEAKAGEFLOW, &leakage_flow);
     beme_throw_if_EN_error(errorcode,
         "Impossible to retrieve the properties of the junction.",
@@ -212,33 +230,66 @@ void Junction::__retrieve_EN_results()
     leakage_flow = epanet::convert_flow_to_L_per_s(ph, leakage_flow);
 #endif
     
+    this->__commit_EN_demand_results(t, undeliv, emitter_flow, leakage_flow);
+}
+
+void Junction::retrieve_EN_results(const epanet::ResultsBuffer& a_results)
+{
+    inherited::retrieve_EN_results(a_results);
+
+    this->__retrieve_EN_results(a_results);
+}
+
+void Junction::__retrieve_EN_results(const epanet::ResultsBuffer& a_results)
+{
+    assert(m__en_index > 0);
+
+    using Q = epanet::ResultsBuffer::NodeQuantity;
+    if (!a_results.records(this->type_code(), epanet::ResultsProfile::Quantity::Demand))
+        return;
+
+    auto t = m__wds.current_result_time();
+
+    this->__commit_EN_demand_results(t,
+        a_results.node(Q::DemandDeficit, m__en_index),
+        a_results.node(Q::EmitterFlow, m__en_index),
+        a_results.node(Q::LeakageFlow, m__en_index)
+    );
+}
+
+void Junction::__commit_EN_demand_results(const time::Instant t, const double undeliv, const double emitter_flow, const double leakage_flow)
+{
+    // Split the outflow (already committed by the Node) in consumption and
+    // undelivered demand.
+    const auto [consumption, undelivered] = this->__split_EN_outflow(
+        m__outflow.when_t(t), m__head.when_t(t), undeliv, emitter_flow, leakage_flow);
+
+    m__consumption.commit(t, consumption);
+    m__undelivered_demand.commit(t, undelivered);
+    m__demand.commit(t, consumption + undelivered);
+}
+
+auto Junction::__split_EN_outflow(const double outflow, const double head, const double undeliv, const double emitter_flow, const double leakage_flow) const -> std::pair<double, double>
+{
+    // All the flows are in L/s.
+    auto ph = m__wds.ph();
+
     // If a Junction with a demand is experiencing a negative pressure with a DDA,
     // the demand was not satisfied and it should go as a demand undelivered.
     // This is equivalent to check if the warning flag of EPANET is set to 6.
-    double outflow = m__outflow.when_t(t);
 #if BEME_VERSION <241100
     // HOTFIX, a junction must not experience negative pressure, head could be
     // slighlty above zero, but below the elevation and water would not flow out.
     // A simple oversight in the code, that may have caused wrong calculations in the past.
-    if (ph->hydraul.DemandModel == DDA && outflow > 0 &&  m__head.when_t(t) < 0)
+    if (ph->hydraul.DemandModel == DDA && outflow > 0 &&  head < 0)
 #else
-    if (ph->hydraul.DemandModel == DDA && outflow > 0 &&  m__head.when_t(t) < m__elevation)
+    if (ph->hydraul.DemandModel == DDA && outflow > 0 &&  head < m__elevation)
 #endif
     {
-        m__demand.commit(t, outflow);
-        m__consumption.commit(t, 0);
-        m__undelivered_demand.commit(t, outflow);
-    }
-    else
-    {
-#if BEME_VERSION >= 250200
-        m__consumption.commit(t, outflow - emitter_flow - leakage_flow);
-#else
-        m__consumption.commit(t, outflow - emitter_flow);
-#endif
-        m__undelivered_demand.commit(t, undeliv);
-        m__demand.commit(t, m__consumption.when_t(t) + m__undelivered_demand.when_t(t));
+        return {0.0, outflow};
     }
+
+    return {outflow - emitter_flow - leakage_flow, undeliv}; // leakage is always 0 before v25.02.00
 }
 
 } // namespace bevarmejo::wds
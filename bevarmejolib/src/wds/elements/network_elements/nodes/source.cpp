@@ -3,6 +3,8 @@
 #include "epanet2_2.h"
 #include "types.h"
 
+#include "bevarmejo/wds/utility/epanet/results_buffer.hpp"
+
 #include "bevarmejo/utility/exceptions.hpp"
 
 #include "bevarmejo/wds/element.hpp"
@@ -88,5 +90,27 @@ void Source::__retrieve_EN_results()
     m__source_elevation.commit(t, val);
 }
 
+void Source::retrieve_EN_results(const epanet::ResultsBuffer& a_results)
+{
+    inherited::retrieve_EN_results(a_results);
+
+    this->__retrieve_EN_results(a_results);
+}
+
+void Source::__retrieve_EN_results(const epanet::ResultsBuffer& a_results)
+{
+    assert( m__en_index > 0 );
+
+    using Q = epanet::ResultsBuffer::NodeQuantity;
+    using P = epanet::ResultsProfile::Quantity;
+    auto t = m__wds.current_result_time();
+    const auto code = this->type_code();
+
+    if (a_results.records(code, P::Inflow))
+        m__inflow.commit(t, a_results.node(Q::Outflow, m__en_index));
+    if (a_results.records(code, P::Head))
+        m__source_elevation.commit(t, a_results.node(Q::Head, m__en_index));
+}
+
 
 } // namespace bevarmejo::wds
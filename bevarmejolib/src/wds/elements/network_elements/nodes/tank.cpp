@@ -6,6 +6,7 @@
 #include "types.h"
 
 #include "bevarmejo/wds/utility/epanet/en_help.hpp"
+#include "bevarmejo/wds/utility/epanet/results_buffer.hpp"
 
 #include "bevarmejo/wds/elements/curve.hpp"
 #include "bevarmejo/wds/elements/curves.hpp"
@@ -248,4 +249,25 @@ void Tank::__retrieve_EN_results()
     m__volume.commit(t, val);
 }
 
+void Tank::retrieve_EN_results(const epanet::ResultsBuffer& a_results)
+{
+    inherited::retrieve_EN_results(a_results);
+
+    this->__retrieve_EN_results(a_results);
+}
+
+void Tank::__retrieve_EN_results(const epanet::ResultsBuffer& a_results)
+{
+    assert(m__en_index > 0);
+
+    using Q = epanet::ResultsBuffer::NodeQuantity;
+    using P = epanet::ResultsProfile::Quantity;
+    auto t = m__wds.current_result_time();
+
+    if (a_results.records(this->type_code(), P::Level))
+        m__level.commit(t, a_results.node(Q::TankLevel, m__en_index));
+    if (a_results.records(this->type_code(), P::Volume))
+        m__volume.commit(t, a_results.node(Q::TankVolume, m__en_index));
+}
+
 } // namespace bevarmejo::wds
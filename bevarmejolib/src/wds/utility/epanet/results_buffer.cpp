@@ -0,0 +1,196 @@
+#include <cassert>
+#include <cstddef>
+#include <stdexcept>
+#include <vector>
+
+#include "epanet2_2.h"
+#include "types.h"
+
+#include "bevarmejo/utility/exceptions.hpp"
+#include "bevarmejo/wds/utility/epanet/en_help.hpp"
+
+#include "bevarmejo/wds/water_distribution_system.hpp"
+
+#include "bevarmejo/wds/utility/epanet/results_buffer.hpp"
+
+namespace bevarmejo::epanet
+{
+
+namespace detail {
+
+template <typename Q>
+constexpr auto idx(Q a_quantity) noexcept -> std::size_t
+{
+    return static_cast<std::size_t>(a_quantity);
+}
+
+} // namespace detail
+
+/*------- Member functions -------*/
+// (constructor)
+ResultsBuffer::ResultsBuffer(const WaterDistributionSystem& a_wds) :
+    ResultsBuffer(a_wds, ResultsProfile::all())
+{ }
+
+ResultsBuffer::ResultsBuffer(const WaterDistributionSystem& a_wds, const ResultsProfile& a_profile) :
+    ResultsBuffer(a_wds, a_profile, ResultsProfile::none())
+{ }
+
+ResultsBuffer::ResultsBuffer(const WaterDistributionSystem& a_wds, const ResultsProfile& a_profile, const ResultsProfile& a_extra_columns) :
+    m__ph(a_wds.ph()),
+    m__n_nodes(0),
+    m__n_links(0),
+    m__has_tanks(a_wds.has_tanks()),
+    m__has_pumps(a_wds.n_pumps() > 0),
+    m__profile(a_profile),
+    m__nodes(),
+    m__links(),
+    m__node_factors(),
+    m__link_factors()
+{
+    assert(m__ph != nullptr);
+
+    int errorcode = EN_getcount(m__ph, EN_NODECOUNT, &m__n_nodes);
+    assert(errorcode <= 100);
+    errorcode = EN_getcount(m__ph, EN_LINKCOUNT, &m__n_links);
+    assert(errorcode <= 100);
+
+    // Allocate only the columns that the elements store or the caller reads.
+    using E = ResultsProfile::Element;
+    using P = ResultsProfile::Quantity;
+    const auto columns = ResultsProfile(m__profile).merge(a_extra_columns);
+    const bool demands = columns.records(E::Junction, P::Demand);
+
+    auto allocate_node_column = [this](NodeQuantity q, bool needed) {
+        if (needed) m__nodes[detail::idx(q)].assign(m__n_nodes, 0.0);
+    };
+    auto allocate_link_column = [this](LinkQuantity q, bool needed) {
+        if (needed) m__links[detail::idx(q)].assign(m__n_links, 0.0);
+    };
+
+    allocate_node_column(NodeQuantity::Head, columns.any(P::Head));
+    allocate_node_column(NodeQuantity::Outflow, columns.any(P::Outflow) || columns.any(P::Inflow));
+    allocate_node_column(NodeQuantity::Pressure, columns.any(P::Pressure));
+    allocate_node_column(NodeQuantity::DemandDeficit, demands);
+    allocate_node_column(NodeQuantity::EmitterFlow, demands);
+    allocate_node_column(NodeQuantity::LeakageFlow, demands); // Stays zero before 2.3 (no leakage model).
+    allocate_node_column(NodeQuantity::TankLevel, m__has_tanks && columns.records(E::Tank, P::Level));
+    allocate_node_column(NodeQuantity::TankVolume, m__has_tanks && columns.records(E::Tank, P::Volume));
+
+    allocate_link_column(LinkQuantity::Flow, columns.any(P::Flow));
+    allocate_link_column(LinkQuantity::Velocity, columns.records(E::Pipe, P::Velocity));
+    allocate_link_column(LinkQuantity::Energy, m__has_pumps && columns.records(E::Pump, P::Energy));
+    allocate_link_column(LinkQuantity::Status, m__has_pumps && columns.records(E::Pump, P::State));
+    allocate_link_column(LinkQuantity::Efficiency, m__has_pumps && columns.records(E::Pump, P::Efficiency));
+
+    // The units can not change during a simulation, so the conversion factors
+    // are computed here once (same conversions of the elements).
+    const bool is_US = m__ph->parser.Unitsflag == US;
+    const double flow_factor = convert_flow_to_L_per_s(m__ph, 1.0);
+
+    m__node_factors[detail::idx(NodeQuantity::Head)] = is_US ? MperFT : 1.0;
+    m__node_factors[detail::idx(NodeQuantity::Outflow)] = flow_factor;
+    m__node_factors[detail::idx(NodeQuantity::Pressure)] = is_US ? MperFT/PSIperFT : 1.0;
+    m__node_factors[detail::idx(NodeQuantity::DemandDeficit)] = flow_factor;
+    m__node_factors[detail::idx(NodeQuantity::EmitterFlow)] = flow_factor;
+    m__node_factors[detail::idx(NodeQuantity::LeakageFlow)] = flow_factor;
+    m__node_factors[detail::idx(NodeQuantity::TankLevel)] = is_US ? MperFT : 1.0;
+    m__node_factors[detail::idx(NodeQuantity::TankVolume)] = is_US ? M3perFT3 : 1.0;
+
+    m__link_factors[detail::idx(LinkQuantity::Flow)] = flow_factor;
+    m__link_factors[detail::idx(LinkQuantity::Velocity)] = is_US ? MperFT : 1.0; // from ft/s to m/s
+    m__link_factors[detail::idx(LinkQuantity::Energy)] = 1.0; // Always in kW
+    m__link_factors[detail::idx(LinkQuantity::Status)] = 1.0;
+    m__link_factors[detail::idx(LinkQuantity::Efficiency)] = 1.0;
+}
+
+/*------- Element access -------*/
+auto ResultsBuffer::node(NodeQuantity a_quantity, int a_en_index) const -> double
+{
+    assert(a_en_index > 0 && a_en_index <= m__n_nodes);
+    assert(!m__nodes[detail::idx(a_quantity)].empty() && "Quantity not recorded by the profile.");
+    return m__nodes[detail::idx(a_quantity)][a_en_index-1];
+}
+
+auto ResultsBuffer::link(LinkQuantity a_quantity, int a_en_index) const -> double
+{
+    assert(a_en_index > 0 && a_en_index <= m__n_links);
+    assert(!m__links[detail::idx(a_quantity)].empty() && "Quantity not recorded by the profile.");
+    return m__links[detail::idx(a_quantity)][a_en_index-1];
+}
+
+auto ResultsBuffer::column(NodeQuantity a_quantity) const noexcept -> const Column&
+{
+    return m__nodes[detail::idx(a_quantity)];
+}
+
+auto ResultsBuffer::column(LinkQuantity a_quantity) const noexcept -> const Column&
+{
+    return m__links[detail::idx(a_quantity)];
+}
+
+auto ResultsBuffer::profile() const noexcept -> const ResultsProfile&
+{
+    return m__profile;
+}
+
+auto ResultsBuffer::records(unsigned int a_type_code, ResultsProfile::Quantity a_quantity) const noexcept -> bool
+{
+    return m__profile.records(a_type_code, a_quantity);
+}
+
+/*------- Modifiers -------*/
+void ResultsBuffer::retrieve()
+{
+    auto retrieve_column = [this](auto& col, const double factor, auto en_getvalues, int en_property, const char* en_property_name)
+    {
+        if (col.empty())
+            return;
+
+        int errorcode = en_getvalues(m__ph, en_property, col.data());
+        beme_throw_if_EN_error(errorcode,
+            "Impossible to retrieve the results of the network.",
+            "Error originating from the EPANET API while retrieving values: ", en_property_name);
+
+        if (factor != 1.0)
+        {
+            for (auto& val : col)
+                val *= factor;
+        }
+    };
+
+    auto retrieve_node_column = [this, &retrieve_column](NodeQuantity q, int en_property, const char* en_property_name)
+    {
+        retrieve_column(m__nodes[detail::idx(q)], m__node_factors[detail::idx(q)], EN_getnodevalues, en_property, en_property_name);
+    };
+
+    auto retrieve_link_column = [this, &retrieve_column](LinkQuantity q, int en_property, const char* en_property_name)
+    {
+        retrieve_column(m__links[detail::idx(q)], m__link_factors[detail::idx(q)], EN_getlinkvalues, en_property, en_property_name);
+    };
+
+    retrieve_node_column(NodeQuantity::Head, EN_HEAD, "EN_HEAD");
+    retrieve_node_column(NodeQuantity::Outflow, EN_DEMAND, "EN_DEMAND");
+    retrieve_node_column(NodeQuantity::Pressure, EN_PRESSURE, "EN_PRESSURE");
+    retrieve_node_column(NodeQuantity::DemandDeficit, EN_DEMANDDEFICIT, "EN_DEMANDDEFICIT");
+    retrieve_node_column(NodeQuantity::EmitterFlow, EN_EMITTERFLOW, "EN_EMITTERFLOW");
+#if BEME_VERSION >= 250200
+    retrieve_node_column(NodeQuantity::LeakageFlow, EN_LEAKAGEFLOW, "EN_LEAKAGEFLOW");
+#endif
+    if (m__has_tanks)
+    {
+        retrieve_node_column(NodeQuantity::TankLevel, EN_TANKLEVEL, "EN_TANKLEVEL");
+        retrieve_node_column(NodeQuantity::TankVolume, EN_TANKVOLUME, "EN_TANKVOLUME");
+    }
+
+    retrieve_link_column(LinkQuantity::Flow, EN_FLOW, "EN_FLOW");
+    retrieve_link_column(LinkQuantity::Velocity, EN_VELOCITY, "EN_VELOCITY");
+    if (m__has_pumps)
+    {
+        retrieve_link_column(LinkQuantity::Energy, EN_ENERGY, "EN_ENERGY");
+        retrieve_link_column(LinkQuantity::Status, EN_STATUS, "EN_STATUS");
+        retrieve_link_column(LinkQuantity::Efficiency, EN_PUMP_EFFIC, "EN_PUMP_EFFIC");
+    }
+}
+
+} // namespace bevarmejo::epanet
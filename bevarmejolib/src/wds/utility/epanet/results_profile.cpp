@@ -0,0 +1,118 @@
+#include <cstddef>
+#include <initializer_list>
+
+#include "bevarmejo/wds/elements/network_elements/nodes/junction.hpp"
+#include "bevarmejo/wds/elements/network_elements/nodes/reservoir.hpp"
+#include "bevarmejo/wds/elements/network_elements/nodes/tank.hpp"
+#include "bevarmejo/wds/elements/network_elements/links/pipe.hpp"
+#include "bevarmejo/wds/elements/network_elements/links/pump.hpp"
+
+#include "bevarmejo/wds/utility/epanet/results_profile.hpp"
+
+namespace bevarmejo::epanet
+{
+
+namespace {
+
+template <typename E>
+constexpr auto idx(E a_enum) noexcept -> std::size_t
+{
+    return static_cast<std::size_t>(a_enum);
+}
+
+} // namespace
+
+/*------- Member functions -------*/
+// (constructor)
+ResultsProfile::ResultsProfile() :
+    m__quantities()
+{
+    for (auto& quantities : m__quantities)
+        quantities.set();
+}
+
+auto ResultsProfile::all() -> ResultsProfile
+{
+    return ResultsProfile();
+}
+
+auto ResultsProfile::none() -> ResultsProfile
+{
+    auto profile = ResultsProfile();
+    for (auto& quantities : profile.m__quantities)
+        quantities.reset();
+
+    return profile;
+}
+
+/*------- Element access -------*/
+auto ResultsProfile::records(Element a_element, Quantity a_quantity) const noexcept -> bool
+{
+    return m__quantities[idx(a_element)].test(idx(a_quantity));
+}
+
+auto ResultsProfile::records(unsigned int a_type_code, Quantity a_quantity) const noexcept -> bool
+{
+    switch (a_type_code)
+    {
+    case wds::TypeTraits<wds::Junction>::code:
+        return records(Element::Junction, a_quantity);
+    case wds::TypeTraits<wds::Reservoir>::code:
+        return records(Element::Reservoir, a_quantity);
+    case wds::TypeTraits<wds::Tank>::code:
+        return records(Element::Tank, a_quantity);
+    case wds::TypeTraits<wds::Pipe>::code:
+        return records(Element::Pipe, a_quantity);
+    case wds::TypeTraits<wds::Pump>::code:
+        return records(Element::Pump, a_quantity);
+    default:
+        // Elements without results in EPANET.
+        return false;
+    }
+}
+
+auto ResultsProfile::any(Quantity a_quantity) const noexcept -> bool
+{
+    for (const auto& quantities : m__quantities)
+    {
+        if (quantities.test(idx(a_quantity)))
+            return true;
+    }
+    return false;
+}
+
+auto ResultsProfile::empty() const noexcept -> bool
+{
+    for (const auto& quantities : m__quantities)
+    {
+        if (quantities.any())
+            return false;
+    }
+    return true;
+}
+
+/*------- Modifiers -------*/
+auto ResultsProfile::record(Element a_element, std::initializer_list<Quantity> a_quantities) -> ResultsProfile&
+{
+    auto& quantities = m__quantities[idx(a_element)];
+    for (const auto q : a_quantities)
+        quantities.set(idx(q));
+
+    if (a_element == Element::Junction && quantities.test(idx(Quantity::Demand)))
+    {
+        quantities.set(idx(Quantity::Head));
+        quantities.set(idx(Quantity::Outflow));
+    }
+
+    return *this;
+}
+
+auto ResultsProfile::merge(const ResultsProfile& a_other) -> ResultsProfile&
+{
+    for (std::size_t i = 0; i < m__quantities.size(); ++i)
+        m__quantities[i] |= a_other.m__quantities[i];
+
+    return *this;
+}
+
+} // namespace bevarmejo::epanet
@@ -394,6 +394,520 @@ void WaterDistributionSystem::load_EN_rules()
     }
 }
 
+auto WaterDistributionSystem::clone_EN_project() const -> EN_Project
+{
+    assert(ph_ != nullptr);
+
+    // EPANET does not provide a way to copy a project, so I start from an empty
+    // one and add everything through the API. This keeps the changes done at
+    // runtime (e.g., EN_addlink) and does not need to read the file again.
+    // The indices of patterns, curves, nodes and links are the same of the
+    // original project because they are added in the same order.
+    // Positional control valves can not be copied (their curve is not
+    // reachable through the API we use), so they are rejected before anything
+    // is built.
+    int n_links = 0;
+    int errorcode = EN_getcount(ph_, EN_LINKCOUNT, &n_links);
+    assert(errorcode <= 100);
+
+    for (int i = 1; i <= n_links; ++i)
+    {
+        int link_type = 0;
+        errorcode = EN_getlinktype(ph_, i, &link_type);
+        assert(errorcode <= 100);
+
+        beme_throw_if(link_type > EN_GPV, std::runtime_error,
+            "Impossible to clone the Water Distribution System.",
+            "The link type can not be cloned.",
+            "Link index: ", i,
+            "Link type: ", link_type);
+    }
+
+    int flow_units = 0;
+    errorcode = EN_getflowunits(ph_, &flow_units);
+    assert(errorcode <= 100);
+
+    double headloss_form = 0.0;
+    errorcode = EN_getoption(ph_, EN_HEADLOSSFORM, &headloss_form);
+    assert(errorcode <= 100);
+
+    EN_Project ph = nullptr;
+    errorcode = EN_createproject(&ph);
+    assert(errorcode <= 100);
+
+    errorcode = EN_init(ph, "", "", flow_units, static_cast<int>(headloss_form));
+    if (errorcode > 100)
+    {
+        EN_deleteproject(ph);
+
+        beme_throw(std::runtime_error,
+            "Impossible to clone the Water Distribution System.",
+            "Error initializing the EPANET project.",
+            "Error code: ", errorcode);
+    }
+
+    errorcode = EN_setreport(ph, "SUMMARY NO");
+    errorcode = EN_setreport(ph, "STATUS NO");
+    errorcode = EN_setreport(ph, "MESSAGES NO");
+
+    auto get_id = [](EN_Project a_ph, auto getter, int index) -> std::string
+    {
+        char id[EN_MAXID+1];
+        int errorcode = getter(a_ph, index, id);
+        assert(errorcode <= 100);
+        return std::string(id);
+    };
+
+    // Any failure from now on means the two projects are not the same, so we 
+    // can not return a partial copy.
+    auto check = [&ph](int errorcode, const char* what, const std::string& id)
+    {
+        if (errorcode <= 100)
+            return;
+
+        EN_deleteproject(ph);
+
+        beme_throw(std::runtime_error,
+            "Impossible to clone the Water Distribution System.",
+            what,
+            "Error code: ", errorcode,
+            "ID: ", id);
+    };
+
+    // 1. Patterns and curves
+    int n_patterns = 0;
+    errorcode = EN_getcount(ph_, EN_PATCOUNT, &n_patterns);
+    assert(errorcode <= 100);
+
+    for (int i = 1; i <= n_patterns; ++i)
+    {
+        const auto pattern_id = get_id(ph_, EN_getpatternid, i);
+
+        int len = 0;
+        errorcode = EN_getpatternlen(ph_, i, &len);
+        assert(errorcode <= 100);
+
+        std::vector<double> multipliers(len, 0.0);
+        for (int j = 0; j < len; ++j)
+        {
+            errorcode = EN_getpatternvalue(ph_, i, j+1, &multipliers[j]);
+            assert(errorcode <= 100);
+        }
+
+        check(EN_addpattern(ph, pattern_id.c_str()), "Error adding a pattern.", pattern_id);
+        check(EN_setpattern(ph, i, multipliers.data(), len), "Error setting the pattern multipliers.", pattern_id);
+    }
+
+    int n_curves = 0;
+    errorcode = EN_getcount(ph_, EN_CURVECOUNT, &n_curves);
+    assert(errorcode <= 100);
+
+    for (int i = 1; i <= n_curves; ++i)
+    {
+        int len = 0;
+        errorcode = EN_getcurvelen(ph_, i, &len);
+        assert(errorcode <= 100);
+
+        char curve_id[EN_MAXID+1];
+        int n_points = 0;
+        std::vector<double> xs(len, 0.0);
+        std::vector<double> ys(len, 0.0);
+        errorcode = EN_getcurve(ph_, i, curve_id, &n_points, xs.data(), ys.data());
+        assert(errorcode <= 100);
+
+        int curve_type = 0;
+        errorcode = EN_getcurvetype(ph_, i, &curve_type);
+        assert(errorcode <= 100);
+
+        check(EN_addcurve(ph, curve_id), "Error adding a curve.", curve_id);
+        check(EN_setcurve(ph, i, xs.data(), ys.data(), n_points), "Error setting the curve points.", curve_id);
+        check(EN_setcurvetype(ph, i, curve_type), "Error setting the curve type.", curve_id);
+    }
+
+    // 2. Nodes
+    int n_nodes = 0;
+    errorcode = EN_getcount(ph_, EN_NODECOUNT, &n_nodes);
+    assert(errorcode <= 100);
+
+    auto copy_node_value = [this, &ph, &check](int index, int property, const std::string& id)
+    {
+        double value = 0.0;
+        int errorcode = EN_getnodevalue(ph_, index, property, &value);
+        assert(errorcode <= 100);
+        check(EN_setnodevalue(ph, index, property, value), "Error setting a node property.", id);
+    };
+
+    for (int i = 1; i <= n_nodes; ++i)
+    {
+        const auto node_id = get_id(ph_, EN_getnodeid, i);
+
+        int node_type = 0;
+        errorcode = EN_getnodetype(ph_, i, &node_type);
+        assert(errorcode <= 100);
+
+        int index = 0;
+        check(EN_addnode(ph, node_id.c_str(), node_type, &index), "Error adding a node.", node_id);
+        assert(index == i);
+
+        double x = 0.0, y = 0.0;
+        if (EN_getcoord(ph_, i, &x, &y) == 0)
+            check(EN_setcoord(ph, i, x, y), "Error setting the node coordinates.", node_id);
+
+        switch (node_type)
+        {
+            case EN_JUNCTION:
+            {
+                copy_node_value(i, EN_ELEVATION, node_id);
+
+                // A new junction comes with a default (empty) demand, that I 
+                // overwrite with the first one, and then append the others.
+                int n_demands = 0;
+                errorcode = EN_getnumdemands(ph_, i, &n_demands);
+                assert(errorcode <= 100);
+
+                for (int d = 1; d <= n_demands; ++d)
+                {
+                    double base_demand = 0.0;
+                    errorcode = EN_getbasedemand(ph_, i, d, &base_demand);
+                    assert(errorcode <= 100);
+
+                    int pattern_idx = 0;
+                    errorcode = EN_getdemandpattern(ph_, i, d, &pattern_idx);
+                    assert(errorcode <= 100);
+
+                    char demand_name[EN_MAXID+1];
+                    errorcode = EN_getdemandname(ph_, i, d, demand_name);
+                    assert(errorcode <= 100);
+
+                    if (d > 1)
+                        check(EN_adddemand(ph, i, base_demand, "", demand_name), "Error adding a demand.", node_id);
+                    else
+                    {
+                        check(EN_setbasedemand(ph, i, d, base_demand), "Error setting the base demand.", node_id);
+                        check(EN_setdemandname(ph, i, d, demand_name), "Error setting the demand name.", node_id);
+                    }
+
+                    check(EN_setdemandpattern(ph, i, d, pattern_idx), "Error setting the demand pattern.", node_id);
+                }
+
+                if (n_demands == 0)
+                    check(EN_deletedemand(ph, i, 1), "Error deleting the default demand.", node_id);
+
+                copy_node_value(i, EN_EMITTER, node_id);
+                copy_node_value(i, EN_INITQUAL, node_id);
+                break;
+            }
+
+            case EN_RESERVOIR:
+                copy_node_value(i, EN_ELEVATION, node_id);
+                copy_node_value(i, EN_PATTERN, node_id);
+                copy_node_value(i, EN_INITQUAL, node_id);
+                break;
+
+            case EN_TANK:
+            {
+                double elev = 0.0, init_lvl = 0.0, min_lvl = 0.0, max_lvl = 0.0, diam = 0.0, min_vol = 0.0, vol_curve = 0.0;
+                errorcode = EN_getnodevalue(ph_, i, EN_ELEVATION, &elev);
+                assert(errorcode <= 100);
+                errorcode = EN_getnodevalue(ph_, i, EN_TANKLEVEL, &init_lvl);
+                assert(errorcode <= 100);
+                errorcode = EN_getnodevalue(ph_, i, EN_MINLEVEL, &min_lvl);
+                assert(errorcode <= 100);
+                errorcode = EN_getnodevalue(ph_, i, EN_MAXLEVEL, &max_lvl);
+                assert(errorcode <= 100);
+                errorcode = EN_getnodevalue(ph_, i, EN_TANKDIAM, &diam);
+                assert(errorcode <= 100);
+                errorcode = EN_getnodevalue(ph_, i, EN_MINVOLUME, &min_vol);
+                assert(errorcode <= 100);
+                errorcode = EN_getnodevalue(ph_, i, EN_VOLCURVE, &vol_curve);
+                assert(errorcode <= 100);
+
+                const int vol_curve_idx = static_cast<int>(vol_curve);
+                const auto vol_curve_id = vol_curve_idx > 0 ? get_id(ph_, EN_getcurveid, vol_curve_idx) : std::string();
+
+                check(EN_settankdata(ph, i, elev, init_lvl, min_lvl, max_lvl, diam, min_vol, vol_curve_id.c_str()), "Error setting the tank data.", node_id);
+
+                copy_node_value(i, EN_MIXMODEL, node_id);
+                copy_node_value(i, EN_MIXFRACTION, node_id);
+                copy_node_value(i, EN_TANK_KBULK, node_id);
+                copy_node_value(i, EN_CANOVERFLOW, node_id);
+                copy_node_value(i, EN_INITQUAL, node_id);
+                break;
+            }
+
+            default:
+                EN_deleteproject(ph);
+
+                beme_throw(std::runtime_error,
+                    "Unknown node type.",
+                    "The node type is not recognized by the system.",
+                    "Node ID: ", node_id,
+                    "Node type: ", node_type);
+        }
+    }
+
+    // 3. Links
+    auto copy_link_value = [this, &ph, &check](int index, int property, const std::string& id)
+    {
+        double value = 0.0;
+        int errorcode = EN_getlinkvalue(ph_, index, property, &value);
+        assert(errorcode <= 100);
+        check(EN_setlinkvalue(ph, index, property, value), "Error setting a link property.", id);
+    };
+
+    for (int i = 1; i <= n_links; ++i)
+    {
+        const auto link_id = get_id(ph_, EN_getlinkid, i);
+
+        int link_type = 0;
+        errorcode = EN_getlinktype(ph_, i, &link_type);
+        assert(errorcode <= 100);
+
+        int from_node_idx = 0, to_node_idx = 0;
+        errorcode = EN_getlinknodes(ph_, i, &from_node_idx, &to_node_idx);
+        assert(errorcode <= 100);
+
+        const auto from_node_id = get_id(ph_, EN_getnodeid, from_node_idx);
+        const auto to_node_id = get_id(ph_, EN_getnodeid, to_node_idx);
+
+        int index = 0;
+        check(EN_addlink(ph, link_id.c_str(), link_type, from_node_id.c_str(), to_node_id.c_str(), &index), "Error adding a link.", link_id);
+        assert(index == i);
+
+        switch (link_type)
+        {
+            case EN_CVPIPE:
+            case EN_PIPE:
+            {
+                double length = 0.0, diam = 0.0, rough = 0.0, mloss = 0.0;
+                errorcode = EN_getlinkvalue(ph_, i, EN_LENGTH, &length);
+                assert(errorcode <= 100);
+                errorcode = EN_getlinkvalue(ph_, i, EN_DIAMETER, &diam);
+                assert(errorcode <= 100);
+                errorcode = EN_getlinkvalue(ph_, i, EN_ROUGHNESS, &rough);
+                assert(errorcode <= 100);
+                errorcode = EN_getlinkvalue(ph_, i, EN_MINORLOSS, &mloss);
+                assert(errorcode <= 100);
+
+                check(EN_setpipedata(ph, i, length, diam, rough, mloss), "Error setting the pipe data.", link_id);
+
+                copy_link_value(i, EN_KBULK, link_id);
+                copy_link_value(i, EN_KWALL, link_id);
+                copy_link_value(i, EN_LEAK_AREA, link_id);
+                copy_link_value(i, EN_LEAK_EXPAN, link_id);
+                // The status of a check valve can not be set, it is always open.
+                if (link_type == EN_PIPE)
+                    copy_link_value(i, EN_INITSTATUS, link_id);
+                break;
+            }
+
+            case EN_PUMP:
+            {
+                int pump_type = 0;
+                errorcode = EN_getpumptype(ph_, i, &pump_type);
+                assert(errorcode <= 100);
+
+                if (pump_type == EN_CONST_HP)
+                {
+                    copy_link_value(i, EN_PUMP_POWER, link_id);
+                }
+                else
+                {
+                    int curve_idx = 0;
+                    errorcode = EN_getheadcurveindex(ph_, i, &curve_idx);
+                    assert(errorcode <= 100);
+                    check(EN_setheadcurveindex(ph, i, curve_idx), "Error setting the pump head curve.", link_id);
+                }
+
+                double effic_curve = 0.0;
+                errorcode = EN_getlinkvalue(ph_, i, EN_PUMP_ECURVE, &effic_curve);
+                assert(errorcode <= 100);
+                if (effic_curve > 0.0)
+                    check(EN_setlinkvalue(ph, i, EN_PUMP_ECURVE, effic_curve), "Error setting the pump efficiency curve.", link_id);
+
+                copy_link_value(i, EN_PUMP_ECOST, link_id);
+                copy_link_value(i, EN_PUMP_EPAT, link_id);
+                copy_link_value(i, EN_LINKPATTERN, link_id);
+                copy_link_value(i, EN_INITSETTING, link_id);
+                copy_link_value(i, EN_INITSTATUS, link_id);
+                break;
+            }
+
+            case EN_PRV:
+            case EN_PSV:
+            case EN_PBV:
+            case EN_FCV:
+            case EN_TCV:
+            {
+                copy_link_value(i, EN_DIAMETER, link_id);
+                copy_link_value(i, EN_MINORLOSS, link_id);
+
+                // A valve has either a setting (and it is active) or a fixed
+                // status: EPANET marks the latter with a negative (missing) setting.
+                double setting = 0.0;
+                errorcode = EN_getlinkvalue(ph_, i, EN_INITSETTING, &setting);
+                assert(errorcode <= 100);
+                if (setting >= 0.0)
+                    check(EN_setlinkvalue(ph, i, EN_INITSETTING, setting), "Error setting the valve setting.", link_id);
+                else
+                    copy_link_value(i, EN_INITSTATUS, link_id);
+                break;
+            }
+
+            case EN_GPV:
+                copy_link_value(i, EN_DIAMETER, link_id);
+                copy_link_value(i, EN_MINORLOSS, link_id);
+                copy_link_value(i, EN_GPV_CURVE, link_id);
+                copy_link_value(i, EN_INITSTATUS, link_id);
+                break;
+
+            default:
+                EN_deleteproject(ph);
+
+                beme_throw(std::runtime_error,
+                    "Unknown link type.",
+                    "The link type is not recognized by the system.",
+                    "Link ID: ", link_id,
+                    "Link type: ", link_type);
+        }
+    }
+
+    // 4. Controls and rules. They refer to nodes and links by index, which are
+    // the same in the two projects.
+    int n_controls = 0;
+    errorcode = EN_getcount(ph_, EN_CONTROLCOUNT, &n_controls);
+    assert(errorcode <= 100);
+
+    for (int i = 1; i <= n_controls; ++i)
+    {
+        int type = 0, link_idx = 0, node_idx = 0;
+        double setting = 0.0, level = 0.0;
+        errorcode = EN_getcontrol(ph_, i, &type, &link_idx, &setting, &node_idx, &level);
+        assert(errorcode <= 100);
+
+        int index = 0;
+        check(EN_addcontrol(ph, type, link_idx, setting, node_idx, level, &index), "Error adding a control.", std::to_string(i));
+
+        int enabled = 0;
+        errorcode = EN_getcontrolenabled(ph_, i, &enabled);
+        assert(errorcode <= 100);
+        check(EN_setcontrolenabled(ph, index, enabled), "Error enabling a control.", std::to_string(i));
+    }
+
+    // A rule can only be added as text, but its values are stored in internal
+    // units (e.g., seconds for the times). So I add a rule with the same number
+    // of premises and actions and then overwrite them with the raw values.
+    int n_rules = 0;
+    errorcode = EN_getcount(ph_, EN_RULECOUNT, &n_rules);
+    assert(errorcode <= 100);
+
+    for (int i = 1; i <= n_rules; ++i)
+    {
+        const auto rule_id = get_id(ph_, EN_getruleID, i);
+
+        int n_premises = 0, n_then_actions = 0, n_else_actions = 0;
+        double priority = 0.0;
+        errorcode = EN_getrule(ph_, i, &n_premises, &n_then_actions, &n_else_actions, &priority);
+        assert(errorcode <= 100);
+
+        auto action_link_id = [&](auto getter, int a) -> std::string
+        {
+            int link_idx = 0, status = 0;
+            double setting = 0.0;
+            int errorcode = getter(ph_, i, a, &link_idx, &status, &setting);
+            assert(errorcode <= 100);
+            return get_id(ph_, EN_getlinkid, link_idx);
+        };
+
+        std::ostringstream rule;
+        rule << "RULE " << rule_id << "\n";
+        for (int k = 1; k <= n_premises; ++k)
+            rule << (k == 1 ? "IF" : "AND") << " SYSTEM TIME = 0\n";
+        for (int a = 1; a <= n_then_actions; ++a)
+            rule << (a == 1 ? "THEN" : "AND") << " LINK " << action_link_id(EN_getthenaction, a) << " STATUS = OPEN\n";
+        for (int a = 1; a <= n_else_actions; ++a)
+            rule << (a == 1 ? "ELSE" : "AND") << " LINK " << action_link_id(EN_getelseaction, a) << " STATUS = OPEN\n";
+
+        auto rule_text = rule.str();
+        check(EN_addrule(ph, rule_text.data()), "Error adding a rule.", rule_id);
+
+        for (int k = 1; k <= n_premises; ++k)
+        {
+            int logop = 0, object = 0, obj_idx = 0, variable = 0, relop = 0, status = 0;
+            double value = 0.0;
+            errorcode = EN_getpremise(ph_, i, k, &logop, &object, &obj_idx, &variable, &relop, &status, &value);
+            assert(errorcode <= 100);
+            check(EN_setpremise(ph, i, k, logop, object, obj_idx, variable, relop, status, value), "Error setting a rule premise.", rule_id);
+        }
+
+        for (int a = 1; a <= n_then_actions; ++a)
+        {
+            int link_idx = 0, status = 0;
+            double setting = 0.0;
+            errorcode = EN_getthenaction(ph_, i, a, &link_idx, &status, &setting);
+            assert(errorcode <= 100);
+            check(EN_setthenaction(ph, i, a, link_idx, status, setting), "Error setting a rule action.", rule_id);
+        }
+
+        for (int a = 1; a <= n_else_actions; ++a)
+        {
+            int link_idx = 0, status = 0;
+            double setting = 0.0;
+            errorcode = EN_getelseaction(ph_, i, a, &link_idx, &status, &setting);
+            assert(errorcode <= 100);
+            check(EN_setelseaction(ph, i, a, link_idx, status, setting), "Error setting a rule action.", rule_id);
+        }
+
+        check(EN_setrulepriority(ph, i, priority), "Error setting the rule priority.", rule_id);
+
+        int enabled = 0;
+        errorcode = EN_getruleenabled(ph_, i, &enabled);
+        assert(errorcode <= 100);
+        check(EN_setruleenabled(ph, i, enabled), "Error enabling a rule.", rule_id);
+    }
+
+    // 5. Options, quality and times. Last, because some of them refer to 
+    // patterns and nodes (e.g., the global pattern or the trace node).
+    for (int option : {EN_TRIALS, EN_ACCURACY, EN_TOLERANCE, EN_EMITEXPON, EN_DEMANDMULT,
+                        EN_HEADERROR, EN_FLOWCHANGE, EN_GLOBALEFFIC, EN_GLOBALPRICE,
+                        EN_GLOBALPATTERN, EN_DEMANDCHARGE, EN_SP_GRAVITY, EN_SP_VISCOS,
+                        EN_UNBALANCED, EN_CHECKFREQ, EN_MAXCHECK, EN_DAMPLIMIT, EN_SP_DIFFUS,
+                        EN_BULKORDER, EN_WALLORDER, EN_TANKORDER, EN_CONCENLIMIT})
+    {
+        double value = 0.0;
+        errorcode = EN_getoption(ph_, option, &value);
+        assert(errorcode <= 100);
+        check(EN_setoption(ph, option, value), "Error setting an analysis option.", std::to_string(option));
+    }
+
+    int demand_model = 0;
+    double p_min = 0.0, p_req = 0.0, p_exp = 0.0;
+    errorcode = EN_getdemandmodel(ph_, &demand_model, &p_min, &p_req, &p_exp);
+    assert(errorcode <= 100);
+    check(EN_setdemandmodel(ph, demand_model, p_min, p_req, p_exp), "Error setting the demand model.", std::to_string(demand_model));
+
+    int qual_type = 0, trace_node_idx = 0;
+    char chem_name[EN_MAXID+1];
+    char chem_units[EN_MAXID+1];
+    errorcode = EN_getqualinfo(ph_, &qual_type, chem_name, chem_units, &trace_node_idx);
+    assert(errorcode <= 100);
+    const auto trace_node_id = (qual_type == EN_TRACE) ? get_id(ph_, EN_getnodeid, trace_node_idx) : std::string();
+    check(EN_setqualtype(ph, qual_type, chem_name, chem_units, trace_node_id.c_str()), "Error setting the quality analysis.", chem_name);
+
+    // The hydraulic step is clipped by the pattern and report steps, so it 
+    // must come after them.
+    for (int param : {EN_DURATION, EN_PATTERNSTEP, EN_PATTERNSTART, EN_REPORTSTEP, EN_REPORTSTART,
+                        EN_RULESTEP, EN_STATISTIC, EN_STARTTIME, EN_HYDSTEP, EN_QUALSTEP})
+    {
+        long value = 0;
+        errorcode = EN_gettimeparam(ph_, param, &value);
+        assert(errorcode <= 100);
+        check(EN_settimeparam(ph, param, value), "Error setting a time parameter.", std::to_string(param));
+    }
+
+    return ph;
+}
+
 void WaterDistributionSystem::cache_indices()
 {
     auto cache_index = [this](auto& container)
@@ -58,14 +58,34 @@ std::unique_ptr<WaterDistributionSystem> WaterDistributionSystem::clone() const
 {
     std::unique_ptr<WaterDistributionSystem> wds_clone = std::make_unique<WaterDistributionSystem>();
 
+    // The EPANET project is the source of truth for the properties of the 
+    // elements, so I duplicate it first and then load everything from the copy.
+    wds_clone->ph_ = this->clone_EN_project();
+    wds_clone->_inp_file_ = _inp_file_;
+
+    // The elements keep a reference to the time series, so the times must be in
+    // place before creating them. The results belong to this system only.
+    wds_clone->m__times = m__times;
+    wds_clone->m__times.results().reset();
+
     // Clone the elements
     // I start from curves and patterns since the other depende on them
+    wds_clone->load_EN_curves();
+    wds_clone->load_EN_patterns();
 
     // The nodes can be complitely defined thanks to curves and patterns, so it's
     // their moment.
+    wds_clone->load_EN_nodes();
 
     // Finally once everything is in place I can copy the links and connect the
     // the network.
+    wds_clone->load_EN_links();
+
+    wds_clone->load_EN_controls();
+    wds_clone->load_EN_rules();
+
+    for (const auto& [name, id_seq] : m__id_sequences)
+        wds_clone->m__id_sequences.emplace(name, id_seq);
 
     return wds_clone;
 }
@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <chrono>
 #include <iomanip>
 #include <iostream>
@@ -8,6 +9,7 @@ namespace fsys = std::filesystem;
 #include <stdexcept>
 #include <string>
 #include <utility>
+#include <vector>
 
 #include <pagmo/algorithm.hpp>
 #include <pagmo/population.hpp>
@@ -51,6 +53,47 @@ namespace other {
 static const std::string settings_file = "Settings file : "; // "Settings file : "
 }
 } // namespace io
+
+namespace {
+// The WDSProblem behind the pagmo problem, null if it is not one of ours.
+auto extract_wds_problem(const pagmo::problem &prob) -> const WDSProblem*
+{
+    if (prob.is<hanoi::fbiobj::Problem>())
+        return prob.extract<hanoi::fbiobj::Problem>();
+    if (prob.is<anytown::Problem>())
+        return prob.extract<anytown::Problem>();
+    if (prob.is<anytown_systol25::Problem>())
+        return prob.extract<anytown_systol25::Problem>();
+    return nullptr;
+}
+
+// True if the algorithm evaluates the generations on worker processes (see
+// ProcessPoolBFE), that fork the process running the island.
+auto uses_process_pool(const Json &jalgo) -> bool
+{
+    return jalgo.value(io::key::processes.as_in(jalgo), std::size_t{0}) > 0;
+}
+
+// True if the problem learns from (or counts) its evaluations in memory
+// shared by its copies: the fitness cache, the coarse screening, the
+// surrogate, the evaluation budget and the fireflow pruning. A worker process
+// only updates its own copy of that memory.
+auto has_shared_state(const pagmo::problem &prob) -> bool
+{
+    const auto* p_wds_prob = extract_wds_problem(prob);
+    if (p_wds_prob == nullptr)
+        return false;
+
+    if (p_wds_prob->fitness_cache() != nullptr ||
+        p_wds_prob->coarse_screening() != nullptr ||
+        p_wds_prob->surrogate() != nullptr ||
+        p_wds_prob->eval_budget__s() > 0.0)
+        return true;
+
+    return prob.is<anytown_systol25::Problem>() &&
+        prob.extract<anytown_systol25::Problem>()->prunes_fireflow();
+}
+} // namespace
     
 Experiment::Experiment(const fsys::path &settings_file) : 
     m__settings_file(settings_file),
@@ -253,6 +296,24 @@ void Experiment::build_island(const Json &config)
     jprob[io::key::lookup_paths()] = m__lookup_paths;
 
     auto p = jprob.get<pagmo::problem>();
+
+    // fork() duplicates only the calling thread, a worker process would wait
+    // forever for the fireflow threads of its copy of the problem.
+    beme_throw_if(uses_process_pool(jalgo) &&
+        p.is<anytown_systol25::Problem>() &&
+        p.extract<anytown_systol25::Problem>()->n_ff_threads() > 0,
+        std::runtime_error,
+        "Impossible to build the island.",
+        "The worker processes can not be used with a multi-threaded problem.",
+        "Remove either 'Processes' from the algorithm or 'Fireflow threads' from the problem.");
+
+    // What the workers learn and count is never sent back over the pipes, so
+    // the parent would not reuse it and would report zeros for this island.
+    beme_throw_if(uses_process_pool(jalgo) && has_shared_state(p),
+        std::runtime_error,
+        "Impossible to build the island.",
+        "The worker processes can not be used with a problem that learns from its evaluations.",
+        "Remove either 'Processes' from the algorithm or the fitness cache, coarse screening, surrogate, evaluation budget and fireflow pruning from the problem.");
     
     // Now that I have everything I can build the population and then the island
     check_mandatory_field(io::key::size, jpop);
@@ -333,6 +394,8 @@ void Experiment::build_islands(const Json &typconfig, const Json &specs, const s
     // If it is null or an object, I only have one specialisation (default typeconfig)
     std::size_t n_specs = (specs.empty() || specs.is_object()) ? 1 : specs.size();
 
+    std::vector<Json> configs;
+    configs.reserve(n_specs);
     for (std::size_t i = 0; i < n_specs; ++i)
     {
         Json config = typconfig;
@@ -344,7 +407,25 @@ void Experiment::build_islands(const Json &typconfig, const Json &specs, const s
             else
                 config.update(specs[i], /*merge_objects=*/ true);
         }
-        
+
+        configs.push_back(std::move(config));
+    }
+
+    // The islands evolve on their own threads, which may hold the locks of
+    // the shared replicas and caches while another island forks its worker
+    // processes: the copies of those locks would never be released.
+    const bool forks = std::any_of(configs.begin(), configs.end(), [](const Json &config) {
+        return io::key::algorithm.exists_in(config) &&
+            uses_process_pool(config.at(io::key::algorithm.as_in(config)));
+    });
+    beme_throw_if(forks && n_specs*rand_starts > 1, std::runtime_error,
+        "Impossible to create the islands.",
+        "The worker processes can only be used with a single island.",
+        "Use one island per experiment or remove 'Processes' from the algorithm.",
+        "\tNumber of islands : ", n_specs*rand_starts);
+
+    for (const auto &config : configs)
+    {
         for (std::size_t j = 0; j < rand_starts; ++j)
             build_island(config);
     }
@@ -553,6 +634,24 @@ void Experiment::freeze_isl_runtime_data(Json &jout, const pagmo::island &isl) c
     if (pop.get_problem().get_hevals() > 0)
         jcgen[io::key::hevals()] = pop.get_problem().get_hevals();
 
+    // Fitness evaluations of this island that were served by the shared cache
+    // instead of a simulation (the counters are cumulative, as the fevals).
+    auto p_wds_prob = extract_wds_problem(pop.get_problem());
+    if (p_wds_prob != nullptr && p_wds_prob->fitness_cache_stats() != nullptr)
+    {
+        const auto& stats = *p_wds_prob->fitness_cache_stats();
+        jcgen[io::key::fcache_hits()] = stats.hits.load();
+        jcgen[io::key::fcache_misses()] = stats.misses.load();
+        jcgen[io::key::fcache_hit_rate()] = stats.hit_rate();
+    }
+
+    // Fitness evaluations of this island that ran out of their time budget
+    // and got the failure penalty (cumulative, as the fevals).
+    if (p_wds_prob != nullptr && p_wds_prob->eval_budget__s() > 0.0)
+    {
+        jcgen[io::key::timeouts()] = p_wds_prob->n_timeouts();
+    }
+
     // Same as for append_static_info, but for the dynamic part
     /*
     As of version 25.01.0, the dynamic information is not saved in the JSON file 
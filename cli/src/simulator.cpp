@@ -203,6 +203,8 @@ void save_inp(Simulator& simr);
 
 void save_metrics(Simulator& simr);
 
+void evaluate_perspectives(Simulator& simr);
+
 void run_simulator(Simulator& simr);
 
 /*----------------------------------------------------------------------------*/
@@ -318,6 +320,14 @@ Simulator Simulator::parse(int argc, char *argv[])
             );
             second_run_needed = true;
         }
+        else if (arg == "--perspectives")
+        {
+            simulator.m__post_run_tasks.emplace_back(
+                "Evaluate perspectives",
+                evaluate_perspectives,
+                "Evaluate all the perspectives requested in the problem on a single EPS"
+            );
+        }
     }
 
     if (second_run_needed)
@@ -628,6 +638,29 @@ void save_metrics(Simulator& simr)
     );
 }
 
+void evaluate_perspectives(Simulator& simr)
+{
+    // Only Anytown SysTol25 has more than one perspective for the same individual.
+    auto* prob = simr.problem().extract<bevarmejo::anytown_systol25::Problem>();
+    beme_throw_if(prob == nullptr, std::runtime_error,
+        "Impossible to evaluate the perspectives of the problem.",
+        "This problem does not support this feature.",
+        "Problem type: ", simr.problem().get_name());
+
+    const auto names = prob->perspectives();
+    const auto fitv = prob->evaluate_perspectives(simr.decision_variables());
+
+    bevarmejo::io::stream_out(std::cout,
+        "Perspectives of the decision vector:\n",
+        "\tCost: ", fitv[0], "\n");
+    for (std::size_t i = 0; i < names.size(); ++i)
+    {
+        bevarmejo::io::stream_out(std::cout,
+            "\t", names[i], ": ", fitv[i+1], "\n");
+    }
+    bevarmejo::io::stream_out(std::cout, "\n");
+}
+
 void run_simulator(Simulator& simr)
 {
     simr.run();